@@ -25,6 +25,7 @@
 #include <april/RenderSystem.h>
 #include <april/SystemDelegate.h>
 #include <april/UpdateDelegate.h>
+#include <april/VertexBuffer.h>
 #include <april/Window.h>
 #include <hltypes/hlog.h>
 
@@ -33,6 +34,7 @@
 april::Cursor* cursor = NULL;
 april::Texture* texture = NULL;
 april::TexturedVertex v[14];
+april::VertexBuffer* vertexBuffer = NULL;
 
 #if !defined(_ANDROID) && !defined(_IOS) && !defined(_WINP8)
 grect drawRect(0.0f, 0.0f, 800.0f, 600.0f);
@@ -55,7 +57,7 @@ public:
 		april::rendersys->lookAt(gvec3(0.0f, 2.0f, 5.0f), gvec3(0.0f, 0.0f, 0.0f), gvec3(0.0f, 1.0f, 0.0f));
 		april::rendersys->rotate(this->angle, 0.0f, 1.0f, 0.0f);
 		april::rendersys->setTexture(texture);
-		april::rendersys->render(april::RO_TRIANGLE_STRIP, v, 14);
+		april::rendersys->render(april::RO_TRIANGLE_STRIP, vertexBuffer, 0, 14);
 		return true;
 	}
 
@@ -170,6 +172,8 @@ void april_init(const harray<hstr>& args)
 	v[11] = _v[7];
 	v[12] = _v[2];
 	v[13] = _v[3];
+	// the cube never changes so it's uploaded only once
+	vertexBuffer = april::rendersys->createVertexBuffer(v, 14);
 }
 
 void april_destroy()
@@ -177,6 +181,7 @@ void april_destroy()
 	april::window->setCursor(NULL);
 	delete cursor;
 	delete texture;
+	delete vertexBuffer;
 	april::destroy();
 	delete updateDelegate;
 	updateDelegate = NULL;
@@ -0,0 +1,325 @@
+/// @file
+/// @version 3.5
+///
+/// @section LICENSE
+///
+/// This program is free software; you can redistribute it and/or modify it under
+/// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
+///
+/// @section DESCRIPTION
+///
+/// Checks the optimized Image code paths against the scalar code and measures their performance. Without arguments only the checks
+/// are run. The argument "threads" additionally measures how image processing scales with the number of threads. With the argument
+/// "upload" a window is created and texture uploads are measured instead. All results are logged.
+
+#include <string.h>
+
+#include <april/april.h>
+#include <april/Image.h>
+#include <april/main.h>
+#include <april/RenderSystem.h>
+#include <april/Texture.h>
+#include <april/UpdateDelegate.h>
+#include <april/Window.h>
+#include <hltypes/harray.h>
+#include <hltypes/hlog.h>
+#include <hltypes/hltypesUtil.h>
+#include <hltypes/hstring.h>
+
+#define LOG_TAG "demo_image"
+
+static april::Image::Format formats[] =
+{
+	april::Image::FORMAT_RGBA,
+	april::Image::FORMAT_ARGB,
+	april::Image::FORMAT_BGRA,
+	april::Image::FORMAT_ABGR,
+	april::Image::FORMAT_RGBX,
+	april::Image::FORMAT_XRGB,
+	april::Image::FORMAT_BGRX,
+	april::Image::FORMAT_XBGR,
+	april::Image::FORMAT_RGB,
+	april::Image::FORMAT_BGR,
+	april::Image::FORMAT_ALPHA,
+	april::Image::FORMAT_GRAYSCALE
+};
+static int formatCount = sizeof(formats) / sizeof(april::Image::Format);
+static int failures = 0;
+
+struct UploadShape
+{
+	const char* name;
+	int w;
+	int h;
+};
+
+static UploadShape uploadShapes[] =
+{
+	{"full", 1024, 1024},
+	{"rows", 1024, 32},
+	{"columns", 32, 1024},
+	{"square", 256, 256},
+	{"tile", 64, 64}
+};
+static int uploadShapeCount = sizeof(uploadShapes) / sizeof(UploadShape);
+static int threadCounts[] = {1, 2, 4, 8};
+static int threadCountCount = sizeof(threadCounts) / sizeof(int);
+
+static void fillPattern(unsigned char* data, int size, unsigned int seed)
+{
+	for_iter (i, 0, size)
+	{
+		seed = seed * 1103515245 + 12345;
+		data[i] = (unsigned char)(seed >> 16);
+	}
+}
+
+static void checkResult(chstr operation, int level, april::Image::Format srcFormat, april::Image::Format destFormat,
+	bool expectedValid, unsigned char* expected, bool resultValid, unsigned char* result, int size)
+{
+	if (expectedValid != resultValid || (expectedValid && memcmp(expected, result, size) != 0))
+	{
+		hlog::errorf(LOG_TAG, "%s from format %d to %d at SIMD level %d differs from the scalar code!", operation.cStr(), (int)srcFormat, (int)destFormat, level);
+		++failures;
+	}
+}
+
+/// @brief Runs conversions, blending and resampling of every format pair at every supported SIMD level and compares the results bit
+/// for bit with SIMD level 0.
+/// @note Sizes are odd so the scalar remainders after the 16 pixel groups of the kernels are covered as well.
+static void testSimd()
+{
+	april::setMaxImageSimdLevel(-1);
+	int supportedLevel = april::getImageSimdLevel();
+	hlog::writef(LOG_TAG, "SIMD level supported by the CPU: %d", supportedLevel);
+	if (supportedLevel == 0)
+	{
+		hlog::warn(LOG_TAG, "No SIMD support, nothing to compare.");
+		return;
+	}
+	static const unsigned char alphas[] = {255, 160};
+	int w = 61;
+	int h = 7;
+	int stretchedWidth = 45;
+	int stretchedHeight = 5;
+	unsigned char* src = new unsigned char[w * h * 4];
+	unsigned char* expected = new unsigned char[w * h * 4];
+	unsigned char* result = new unsigned char[w * h * 4];
+	fillPattern(src, w * h * 4, 1);
+	bool expectedValid = false;
+	bool resultValid = false;
+	int size = 0;
+	int comparisons = 0;
+	for_iter (level, 1, supportedLevel + 1)
+	{
+		for_iter (i, 0, formatCount)
+		{
+			for_iter (j, 0, formatCount)
+			{
+				size = w * h * april::Image::getFormatBpp(formats[j]);
+				if (i != j)
+				{
+					april::setMaxImageSimdLevel(0);
+					expectedValid = april::Image::convertToFormat(w, h, src, formats[i], &expected, formats[j]);
+					april::setMaxImageSimdLevel(level);
+					resultValid = april::Image::convertToFormat(w, h, src, formats[i], &result, formats[j]);
+					checkResult("Conversion", level, formats[i], formats[j], expectedValid, expected, resultValid, result, size);
+					++comparisons;
+				}
+				for_iter (k, 0, 2)
+				{
+					fillPattern(expected, size, 2);
+					memcpy(result, expected, size);
+					april::setMaxImageSimdLevel(0);
+					expectedValid = april::Image::blit(0, 0, w, h, 0, 0, src, w, h, formats[i], expected, w, h, formats[j], alphas[k]);
+					april::setMaxImageSimdLevel(level);
+					resultValid = april::Image::blit(0, 0, w, h, 0, 0, src, w, h, formats[i], result, w, h, formats[j], alphas[k]);
+					checkResult("Blending", level, formats[i], formats[j], expectedValid, expected, resultValid, result, size);
+					++comparisons;
+				}
+			}
+			// only the vertical pass of the resampler has SIMD kernels
+			size = stretchedWidth * stretchedHeight * april::Image::getFormatBpp(formats[i]);
+			april::setMaxImageSimdLevel(0);
+			expectedValid = april::Image::writeStretch(0, 0, w, h, 0, 0, stretchedWidth, stretchedHeight, src, w, h, formats[i],
+				expected, stretchedWidth, stretchedHeight, formats[i]);
+			april::setMaxImageSimdLevel(level);
+			resultValid = april::Image::writeStretch(0, 0, w, h, 0, 0, stretchedWidth, stretchedHeight, src, w, h, formats[i],
+				result, stretchedWidth, stretchedHeight, formats[i]);
+			checkResult("Resampling", level, formats[i], formats[i], expectedValid, expected, resultValid, result, size);
+			++comparisons;
+		}
+	}
+	april::setMaxImageSimdLevel(-1);
+	delete[] src;
+	delete[] expected;
+	delete[] result;
+	hlog::writef(LOG_TAG, "SIMD: %d comparisons, %d failed.", comparisons, failures);
+}
+
+/// @brief Measures image operations on a large image with different numbers of image processing threads and logs the speedup.
+/// @note The downscaled results are also compared since the bands of all threads share the same filter tables.
+static void benchmarkThreads()
+{
+	int w = 2048;
+	int h = 2048;
+	int stretchedWidth = 1365;
+	int stretchedHeight = 1365;
+	int count = 4;
+	unsigned char* src = new unsigned char[w * h * 4];
+	unsigned char* dest = new unsigned char[w * h * 4];
+	unsigned char* canvas = new unsigned char[w * h * 4];
+	unsigned char* expected = new unsigned char[stretchedWidth * stretchedHeight * 4];
+	fillPattern(src, w * h * 4, 4);
+	fillPattern(canvas, w * h * 4, 5);
+	int previousThreads = april::getImageProcessingThreads();
+	int previousThreshold = april::getParallelImageProcessingThreshold();
+	april::setParallelImageProcessingThreshold(0);
+	int64_t times[3] = {0, 0, 0};
+	int64_t baseTimes[3] = {1, 1, 1};
+	int64_t time = 0;
+	for_iter (i, 0, threadCountCount)
+	{
+		april::setImageProcessingThreads(threadCounts[i]);
+		time = htickCount();
+		for_iter (j, 0, count)
+		{
+			april::Image::writeStretch(0, 0, w, h, 0, 0, stretchedWidth, stretchedHeight, src, w, h, april::Image::FORMAT_RGBA,
+				dest, stretchedWidth, stretchedHeight, april::Image::FORMAT_RGBA);
+		}
+		times[0] = hmax(htickCount() - time, (int64_t)1);
+		// row bands have to produce exactly the same result as a single pass
+		if (i == 0)
+		{
+			memcpy(expected, dest, stretchedWidth * stretchedHeight * 4);
+		}
+		else if (memcmp(expected, dest, stretchedWidth * stretchedHeight * 4) != 0)
+		{
+			hlog::errorf(LOG_TAG, "Downscaling with %d threads differs from the result with 1 thread!", threadCounts[i]);
+			++failures;
+		}
+		time = htickCount();
+		for_iter (j, 0, count)
+		{
+			april::Image::blitStretch(0, 0, stretchedWidth, stretchedHeight, 0, 0, w, h, dest, stretchedWidth, stretchedHeight, april::Image::FORMAT_RGBA,
+				canvas, w, h, april::Image::FORMAT_RGBA, 160);
+		}
+		times[1] = hmax(htickCount() - time, (int64_t)1);
+		time = htickCount();
+		for_iter (j, 0, count)
+		{
+			april::Image::blit(0, 0, w, h, 0, 0, src, w, h, april::Image::FORMAT_RGBA, canvas, w, h, april::Image::FORMAT_BGRA, 160);
+		}
+		times[2] = hmax(htickCount() - time, (int64_t)1);
+		if (i == 0)
+		{
+			memcpy(baseTimes, times, sizeof(times));
+		}
+		hlog::writef(LOG_TAG, "Threads %d: downscale %d ms (%.2fx), upscale blend %d ms (%.2fx), blend %d ms (%.2fx)", threadCounts[i],
+			(int)times[0], (double)baseTimes[0] / times[0], (int)times[1], (double)baseTimes[1] / times[1], (int)times[2], (double)baseTimes[2] / times[2]);
+	}
+	april::setImageProcessingThreads(previousThreads);
+	april::setParallelImageProcessingThreshold(previousThreshold);
+	delete[] src;
+	delete[] dest;
+	delete[] canvas;
+	delete[] expected;
+}
+
+/// @brief Writes rectangles of different shapes into a texture and logs the throughput.
+/// @note Except for full rows, the rectangles are taken from a wider source so the strided upload paths are measured as well. Only the
+/// submission is timed, so the results are closest to the actual upload cost on synchronous implementations like Mesa's software GL.
+static void benchmarkUpload(april::Texture::Type type, chstr typeName)
+{
+	int size = 1024;
+	// the native format avoids measuring a format conversion instead of the upload
+	april::Image::Format format = april::rendersys->getNativeTextureFormat(april::Image::FORMAT_RGBA);
+	int bpp = april::Image::getFormatBpp(format);
+	april::Texture* texture = april::rendersys->createTexture(size, size, april::Color::Clear, format, type);
+	if (texture == NULL)
+	{
+		hlog::errorf(LOG_TAG, "Could not create a %s texture!", typeName.cStr());
+		++failures;
+		return;
+	}
+	unsigned char* src = new unsigned char[size * size * bpp];
+	fillPattern(src, size * size * bpp, 3);
+	int w = 0;
+	int h = 0;
+	int count = 0;
+	int64_t time = 0;
+	for_iter (i, 0, uploadShapeCount)
+	{
+		w = uploadShapes[i].w;
+		h = uploadShapes[i].h;
+		count = hmax(16, 64 * 1048576 / (w * h * bpp));
+		time = htickCount();
+		for_iter (j, 0, count)
+		{
+			if (!texture->write((j * 7) % (size - w + 1), (j * 13) % (size - h + 1), w, h, (j * 5) % (size - w + 1), (j * 3) % (size - h + 1),
+				src, size, size, format))
+			{
+				hlog::errorf(LOG_TAG, "Upload of %s rectangle into %s texture failed!", uploadShapes[i].name, typeName.cStr());
+				++failures;
+				break;
+			}
+		}
+		time = hmax(htickCount() - time, (int64_t)1);
+		hlog::writef(LOG_TAG, "Upload %s %dx%d into %s texture: %d writes in %d ms, %.1f MB/s", uploadShapes[i].name, w, h, typeName.cStr(),
+			count, (int)time, (double)count * w * h * bpp * 1000.0 / (time * 1048576.0));
+	}
+	delete[] src;
+	delete texture;
+}
+
+class UpdateDelegate : public april::UpdateDelegate
+{
+	bool onUpdate(float timeDelta)
+	{
+		// the first frame is used because the rendering context is guaranteed to be current here
+		benchmarkUpload(april::Texture::TYPE_VOLATILE, "volatile");
+		benchmarkUpload(april::Texture::TYPE_MANAGED, "managed");
+		return false;
+	}
+
+};
+
+static UpdateDelegate* updateDelegate = NULL;
+
+void april_init(const harray<hstr>& args)
+{
+	if (args.has("upload"))
+	{
+		april::init(april::RS_DEFAULT, april::WS_DEFAULT);
+		april::createRenderSystem();
+		april::createWindow(640, 480, false, "APRIL: Image Demo");
+		updateDelegate = new UpdateDelegate();
+		april::window->setUpdateDelegate(updateDelegate);
+		return;
+	}
+	testSimd();
+	if (args.has("threads"))
+	{
+		benchmarkThreads();
+	}
+	if (failures > 0)
+	{
+		hlog::errorf(LOG_TAG, "%d checks failed!", failures);
+	}
+	else
+	{
+		hlog::write(LOG_TAG, "All checks passed.");
+	}
+}
+
+void april_destroy()
+{
+	if (april::window != NULL && failures > 0)
+	{
+		hlog::errorf(LOG_TAG, "%d uploads failed!", failures);
+	}
+	// also stops the image processing threads
+	april::destroy();
+	delete updateDelegate;
+	updateDelegate = NULL;
+}
@@ -15,7 +15,9 @@
 
 #include <gtypes/Rectangle.h>
 #include <gtypes/Vector2.h>
+#include <hltypes/harray.h>
 #include <hltypes/hmap.h>
+#include <hltypes/hmutex.h>
 #include <hltypes/hsbase.h>
 #include <hltypes/hstring.h>
 
@@ -48,6 +50,31 @@ namespace april
 			FORMAT_PALETTE
 		};
 
+		/// @brief Options that PNG and JPEG apply while decoding and other formats apply after loading.
+		struct aprilExport DecodeOptions
+		{
+		public:
+			/// @brief Format of the created image or FORMAT_INVALID to keep the format of the file.
+			Format format;
+			/// @brief Maximum width or 0 for no limit.
+			int maxWidth;
+			/// @brief Maximum height or 0 for no limit.
+			int maxHeight;
+			/// @brief Format of files with RGB channels if format is FORMAT_INVALID or FORMAT_INVALID to keep the format of the file.
+			Format rgbFormat;
+			/// @brief Format of files with RGBA channels if format is FORMAT_INVALID or FORMAT_INVALID to keep the format of the file.
+			Format rgbaFormat;
+
+			DecodeOptions();
+			DecodeOptions(Format format, int maxWidth, int maxHeight);
+			~DecodeOptions();
+
+			/// @param[in] fileFormat Format the file is decoded in by default.
+			/// @return Format the image should be created in or FORMAT_INVALID to keep the format of the file.
+			Format getFormat(Format fileFormat) const;
+
+		};
+
 		unsigned char* data;
 		int w;
 		int h;
@@ -105,14 +132,90 @@ namespace april
 		static Image* createFromFile(chstr filename, Format format);
 		static Image* createFromStream(hsbase& stream, chstr logicalExtension);
 		static Image* createFromStream(hsbase& stream, chstr logicalExtension, Format format);
+		/// @brief Creates an image from encoded file data in memory.
+		/// @param[in] data Encoded file data.
+		/// @param[in] size Size of the data in bytes.
+		/// @param[in] logicalExtension Extension used to determine the file format.
+		/// @note The data is not copied for PNG, JPEG and JPT so it can be e.g. a memory-mapped file.
+		static Image* createFromMemory(unsigned char* data, int size, chstr logicalExtension);
+		/// @brief Creates an image from encoded file data in memory and converts it to the given format.
+		/// @param[in] data Encoded file data.
+		/// @param[in] size Size of the data in bytes.
+		/// @param[in] logicalExtension Extension used to determine the file format.
+		/// @param[in] format Format of the created image.
+		/// @note The data is not copied for PNG, JPEG and JPT so it can be e.g. a memory-mapped file.
+		static Image* createFromMemory(unsigned char* data, int size, chstr logicalExtension, Format format);
+		/// @brief Creates an image reduced to fit into the given size while keeping the aspect ratio.
+		/// @param[in] filename Resource filename.
+		/// @param[in] maxWidth Maximum width or 0 for no limit.
+		/// @param[in] maxHeight Maximum height or 0 for no limit.
+		/// @param[in] format Format of the created image or FORMAT_INVALID to keep the format of the file.
+		/// @note JPEG is scaled down while decoding and non-interlaced PNG is downsampled row by row so the full-size image is never allocated. Other formats are decoded at full size first.
+		static Image* createFromResource(chstr filename, int maxWidth, int maxHeight, Format format = FORMAT_INVALID);
+		/// @brief Creates an image reduced to fit into the given size while keeping the aspect ratio.
+		/// @param[in] filename Filename.
+		/// @param[in] maxWidth Maximum width or 0 for no limit.
+		/// @param[in] maxHeight Maximum height or 0 for no limit.
+		/// @param[in] format Format of the created image or FORMAT_INVALID to keep the format of the file.
+		/// @note JPEG is scaled down while decoding and non-interlaced PNG is downsampled row by row so the full-size image is never allocated. Other formats are decoded at full size first.
+		static Image* createFromFile(chstr filename, int maxWidth, int maxHeight, Format format = FORMAT_INVALID);
+		/// @brief Creates an image reduced to fit into the given size while keeping the aspect ratio.
+		/// @param[in] stream Stream with the encoded file data.
+		/// @param[in] logicalExtension Extension used to determine the file format.
+		/// @param[in] maxWidth Maximum width or 0 for no limit.
+		/// @param[in] maxHeight Maximum height or 0 for no limit.
+		/// @param[in] format Format of the created image or FORMAT_INVALID to keep the format of the file.
+		static Image* createFromStream(hsbase& stream, chstr logicalExtension, int maxWidth, int maxHeight, Format format = FORMAT_INVALID);
+		/// @brief Creates an image reduced to fit into the given size while keeping the aspect ratio.
+		/// @param[in] data Encoded file data.
+		/// @param[in] size Size of the data in bytes.
+		/// @param[in] logicalExtension Extension used to determine the file format.
+		/// @param[in] maxWidth Maximum width or 0 for no limit.
+		/// @param[in] maxHeight Maximum height or 0 for no limit.
+		/// @param[in] format Format of the created image or FORMAT_INVALID to keep the format of the file.
+		static Image* createFromMemory(unsigned char* data, int size, chstr logicalExtension, int maxWidth, int maxHeight, Format format = FORMAT_INVALID);
+		static Image* createFromResource(chstr filename, const DecodeOptions& options);
+		static Image* createFromFile(chstr filename, const DecodeOptions& options);
+		static Image* createFromStream(hsbase& stream, chstr logicalExtension, const DecodeOptions& options);
+		/// @note The data is not copied for PNG, JPEG and JPT so it can be e.g. a memory-mapped file.
+		static Image* createFromMemory(unsigned char* data, int size, chstr logicalExtension, const DecodeOptions& options);
 		static Image* create(int w, int h, unsigned char* data, Format format);
 		static Image* create(int w, int h, Color color, Format format);
 		static Image* create(Image* other);
 		static Image* readMetaDataFromResource(chstr filename);
 		static Image* readMetaDataFromFile(chstr filename);
 		static Image* readMetaDataFromStream(hsbase& stream, chstr logicalExtension);
+		/// @brief Reads the metadata of several resource files using multiple threads.
+		/// @param[in] filenames Resource filenames.
+		/// @return Metadata in the same order as the filenames. Entries are NULL for files that couldn't be read.
+		/// @note The metadata is also added to the metadata index.
+		static harray<Image*> readMetaDataFromResources(harray<hstr> filenames);
+		/// @brief Reads the metadata of several files using multiple threads.
+		/// @param[in] filenames Filenames.
+		/// @return Metadata in the same order as the filenames. Entries are NULL for files that couldn't be read.
+		/// @note The metadata is also added to the metadata index.
+		static harray<Image*> readMetaDataFromFiles(harray<hstr> filenames);
+		/// @brief Loads a metadata index that was saved with saveMetaDataIndex().
+		/// @param[in] filename Filename of the index.
+		/// @return True if successful.
+		/// @note While files are in the index, readMetaDataFromResource() and readMetaDataFromFile() don't read them. Entries are only used while the size and modification time of a file are the same as when its metadata was read.
+		static bool loadMetaDataIndex(chstr filename);
+		/// @brief Saves the metadata index so it can be loaded on the next start.
+		/// @param[in] filename Filename of the index.
+		/// @return True if successful.
+		static bool saveMetaDataIndex(chstr filename);
+		static void clearMetaDataIndex();
 		
 		static int getFormatBpp(Format format);
+		/// @brief Calculates the size of an image reduced to fit into the given size while keeping the aspect ratio.
+		/// @param[in] w Width of the image.
+		/// @param[in] h Height of the image.
+		/// @param[in] maxWidth Maximum width or 0 for no limit.
+		/// @param[in] maxHeight Maximum height or 0 for no limit.
+		/// @param[out] reducedWidth Reduced width.
+		/// @param[out] reducedHeight Reduced height.
+		/// @note Images are never enlarged.
+		static void getReducedSize(int w, int h, int maxWidth, int maxHeight, int& reducedWidth, int& reducedHeight);
 
 		static Color getPixel(int x, int y, unsigned char* srcData, int srcWidth, int srcHeight, Format srcFormat);
 		static bool setPixel(int x, int y, Color color, unsigned char* destData, int destWidth, int destHeight, Format destFormat);
@@ -146,32 +249,97 @@ namespace april
 		DEPRECATED_ATTRIBUTE static inline Image* load(chstr filename, Format format) { return Image::createFromResource(filename, format); }
 
 	protected:
+		enum BlendChannel
+		{
+			BLEND_OPAQUE = -1,
+			BLEND_SKIP = -2
+		};
+
 		Image();
 
 		static hmap<hstr, Image* (*)(hsbase&)> customLoaders;
+		/// @brief Indexed metadata and the size and modification time the file had when the metadata was read.
+		struct MetaDataIndexEntry
+		{
+			Image* image;
+			int64_t size;
+			int64_t modificationTime;
+
+			MetaDataIndexEntry();
+
+		};
+
+		static hmap<hstr, MetaDataIndexEntry> resourceMetaDataIndex;
+		static hmap<hstr, MetaDataIndexEntry> fileMetaDataIndex;
+		static hmutex metaDataIndexMutex;
 
-		static Image* _loadPng(hsbase& stream, int size);
+		static Image* _loadPng(hsbase& stream, int size, const DecodeOptions& options = DecodeOptions());
 		static Image* _loadPng(hsbase& stream);
-		static Image* _loadJpg(hsbase& stream, int size);
+		/// @param[in] options The format is chosen from the color type of the file. The image is decoded in its own format if the format isn't supported by the decoder.
+		static Image* _loadPng(unsigned char* data, int size, const DecodeOptions& options = DecodeOptions());
+		static Image* _loadJpg(hsbase& stream, int size, const DecodeOptions& options = DecodeOptions());
 		static Image* _loadJpg(hsbase& stream);
+		/// @param[in] options The image is decoded as RGB if the format isn't supported by the decoder.
+		static Image* _loadJpg(unsigned char* data, int size, const DecodeOptions& options = DecodeOptions());
 		static Image* _loadJpt(hsbase& stream);
+		static Image* _loadJpt(unsigned char* data, int size);
 		static Image* _loadPvr(hsbase& stream);
 		static Image* _readMetaDataPng(hsbase& stream, int size);
 		static Image* _readMetaDataPng(hsbase& stream);
 		static Image* _readMetaDataJpg(hsbase& stream, int size);
 		static Image* _readMetaDataJpg(hsbase& stream);
+		static Image* _readMetaDataJpg(unsigned char* data, int size);
 		static Image* _readMetaDataJpt(hsbase& stream);
 		static Image* _readMetaDataPvr(hsbase& stream);
+		/// @brief Checks whether there is a built-in or custom loader for the filename's extension.
+		static bool _isSupportedExtension(chstr filename);
+		/// @brief Decodes from the stream or, if the stream is NULL, from the data and applies the options.
+		static Image* _create(hsbase* stream, unsigned char* data, int size, chstr logicalExtension, const DecodeOptions& options);
+		/// @brief Decodes a JPEG and writes only into the color channels of the destination.
+		static bool _decodeJpgColor(unsigned char* data, int size, unsigned char* destData, int destWidth, int destHeight, Format destFormat);
+		/// @brief Decodes a PNG and writes its first channel into the alpha channel of the destination.
+		/// @note Destination pixels that aren't covered by the PNG become opaque.
+		static bool _decodePngAlpha(unsigned char* data, int size, unsigned char* destData, int destWidth, int destHeight, Format destFormat);
+		/// @brief Decodes the JPEG (part 0) and the PNG (part 1) of a JPT file so both can be decoded at the same time.
+		static bool _processJptPart(void* args, int first, int count);
+		/// @brief Gets the size and modification time of a file that decide whether its indexed metadata is still valid.
+		static void _getMetaDataStamp(chstr filename, bool fromResources, int64_t& size, int64_t& modificationTime);
+		/// @return Copy of the indexed metadata or NULL if the file isn't in the index or has changed since.
+		static Image* _findIndexedMetaData(chstr filename, bool fromResources);
+		/// @note Resources and files are indexed separately since the same path can refer to both.
+		static hmap<hstr, MetaDataIndexEntry>& _getMetaDataIndex(bool fromResources);
+		static harray<Image*> _readMetaData(harray<hstr> filenames, bool fromResources);
+		/// @brief Reads the metadata of the files [first, first + count) of a batch.
+		static bool _processMetaDataBand(void* args, int first, int count);
+		/// @brief Reduces an image that is still larger than the given size and converts it to the given format.
+		static Image* _fitReduced(Image* image, int maxWidth, int maxHeight, Format format);
 
 		static void _getFormatIndices(Format format, int* red, int* green, int* blue, int* alpha);
 
 		static bool _convertFrom1Bpp(int w, int h, unsigned char* srcData, Format srcFormat, unsigned char** destData, Format destFormat);
 		static bool _convertFrom3Bpp(int w, int h, unsigned char* srcData, Format srcFormat, unsigned char** destData, Format destFormat);
 		static bool _convertFrom4Bpp(int w, int h, unsigned char* srcData, Format srcFormat, unsigned char** destData, Format destFormat);
+		/// @brief Converts pixels using runtime-dispatched SIMD kernels if the CPU supports them.
+		/// @return False if no SIMD path is available in which case the scalar conversion has to be used.
+		static bool _convertSimd(int count, unsigned char* srcData, Format srcFormat, unsigned char* destData, Format destFormat);
 
 		static bool _blitFrom1Bpp(int sx, int sy, int sw, int sh, int dx, int dy, unsigned char* srcData, int srcWidth, int srcHeight, Format srcFormat, unsigned char* destData, int destWidth, int destHeight, Format destFormat, unsigned char alpha);
 		static bool _blitFrom3Bpp(int sx, int sy, int sw, int sh, int dx, int dy, unsigned char* srcData, int srcWidth, int srcHeight, Format srcFormat, unsigned char* destData, int destWidth, int destHeight, Format destFormat, unsigned char alpha);
 		static bool _blitFrom4Bpp(int sx, int sy, int sw, int sh, int dx, int dy, unsigned char* srcData, int srcWidth, int srcHeight, Format srcFormat, unsigned char* destData, int destWidth, int destHeight, Format destFormat, unsigned char alpha);
+		/// @brief Resamples a rectangle with separable fixed point filters and writes or blends it row by row into the destination.
+		/// @note Only the destination rows [firstRow, firstRow + rowCount) are processed so the rectangle can be split into bands.
+		/// @note The filter tables are built once by the caller and only read here so all bands can share them.
+		static bool _stretch(int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh, unsigned char* srcData, int srcWidth, int srcHeight, Format srcFormat, unsigned char* destData, int destWidth, int destHeight, Format destFormat, bool blend, unsigned char alpha, void* tables, int firstRow, int rowCount);
+		/// @return Number of leading values of the vertical filter pass that were computed using SIMD kernels.
+		static int _resampleColumnsSimd(int count, short** rows, short* weights, int taps, int shift, unsigned char* dest);
+		/// @brief Blends rows of pixels into the destination.
+		/// @param[in] srcAlpha Index of the source alpha byte within a pixel or -1 if only the alpha multiplier should be used.
+		/// @param[in] channels For each destination byte the source byte index, BLEND_OPAQUE to blend 255 in or BLEND_SKIP to leave it untouched.
+		static void _blendRows(int w, int h, unsigned char* srcData, int srcStride, int srcBpp, int srcAlpha, unsigned char* destData, int destStride, int destBpp, int* channels, unsigned char alpha);
+		/// @return Number of leading pixels per row that were blended using SIMD kernels.
+		static int _blendRowsSimd(int w, int h, unsigned char* srcData, int srcStride, int srcBpp, int srcAlpha, unsigned char* destData, int destStride, int destBpp, int* channels, unsigned char alpha);
+		/// @brief Processes one row band of an operation that was split up for multi-threaded processing.
+		static bool _processBand(void* args, int first, int count);
 
 	};
 	
@@ -0,0 +1,93 @@
+/// @file
+/// @version 3.5
+/// 
+/// @section LICENSE
+/// 
+/// This program is free software; you can redistribute it and/or modify it under
+/// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
+/// 
+/// @section DESCRIPTION
+/// 
+/// Defines a generic index buffer.
+
+#ifndef APRIL_INDEX_BUFFER_H
+#define APRIL_INDEX_BUFFER_H
+
+#include <hltypes/hltypesUtil.h>
+
+#include "aprilExport.h"
+#include "aprilUtil.h"
+
+namespace april
+{
+	class RenderSystem;
+
+	/// @brief Defines a generic index buffer that keeps vertex indices between frames.
+	/// @note The indices are always kept in RAM as well. When the device context is lost, RenderSystem::unloadBuffers() releases the VRAM copy
+	/// and the buffer is restored from RAM the next time it's rendered.
+	class aprilExport IndexBuffer
+	{
+	public:
+		friend class RenderSystem;
+
+		/// @brief Index type stored in the buffer.
+		enum Format
+		{
+			FORMAT_16_BIT = 0,
+			FORMAT_32_BIT = 1
+		};
+
+		/// @brief Destructor.
+		virtual ~IndexBuffer();
+
+		HL_DEFINE_GET(Format, format, Format);
+		HL_DEFINE_GET(BufferUsage, usage, Usage);
+		HL_DEFINE_GET(int, count, Count);
+		/// @return Size of one index in bytes.
+		int getStride();
+		/// @return RAM used by the indices.
+		int getCurrentRamSize();
+		/// @return VRAM used by the indices.
+		int getCurrentVRamSize();
+
+		/// @brief Overwrites indices in the buffer.
+		/// @param[in] indices The indices.
+		/// @param[in] nIndices Number of indices.
+		/// @param[in] offset Position of the first index to overwrite.
+		/// @return True if successful.
+		/// @note Only dynamic buffers can be updated and the index type has to match the buffer format.
+		bool update(unsigned short* indices, int nIndices, int offset = 0);
+		bool update(unsigned int* indices, int nIndices, int offset = 0);
+
+	protected:
+		Format format;
+		BufferUsage usage;
+		int count;
+		/// @brief Indices in RAM, used for rendering when the indices aren't stored in VRAM and for restoring the VRAM copy.
+		unsigned char* data;
+		int vramSize;
+		/// @brief Whether the VRAM copy was released and has to be created again.
+		bool unloaded;
+
+		/// @brief Basic constructor.
+		IndexBuffer();
+
+		bool _create(Format format, const void* indices, int nIndices, BufferUsage usage);
+		bool _update(Format format, const void* indices, int nIndices, int offset);
+		/// @brief Releases the VRAM copy.
+		void _unload();
+		/// @brief Creates the VRAM copy again if it was released.
+		void _restore();
+
+		/// @brief Creates the buffer in VRAM and uploads the data.
+		/// @return False if the data has to be rendered from RAM instead.
+		/// @note Implementations have to adjust vramSize if the data is stored in a different size.
+		virtual bool _createInternalBuffer(const void* data, int size);
+		virtual bool _updateInternalBuffer(const void* data, int offset, int size);
+		virtual void _destroyInternalBuffer();
+
+	};
+
+}
+
+#endif
@@ -15,6 +15,7 @@
 
 #include <hltypes/harray.h>
 #include <hltypes/hltypesUtil.h>
+#include <hltypes/hmap.h>
 #include <hltypes/hstring.h>
 #include <gtypes/Matrix4.h>
 #include <gtypes/Rectangle.h>
@@ -25,8 +26,10 @@
 #include "aprilUtil.h"
 #include "Color.h"
 #include "Image.h"
+#include "IndexBuffer.h"
 #include "RenderState.h"
 #include "Texture.h"
+#include "VertexBuffer.h"
 
 #include "Window.h" // can be removed later
 
@@ -41,7 +44,9 @@ namespace april
 	class aprilExport RenderSystem
 	{
 	public:
+		friend class IndexBuffer;
 		friend class Texture;
+		friend class VertexBuffer;
 		friend class Window;
 
 		struct aprilExport DisplayMode
@@ -113,9 +118,24 @@ namespace april
 		/// @note This is the RAM consumed by only by the textures, not the entire process.
 		int64_t getRamConsumption();
 		int64_t getAsyncRamConsumption();
+		/// @note This is the VRAM consumed only by vertex and index buffers.
+		int64_t getBufferVRamConsumption();
+		/// @note This is the RAM consumed only by vertex and index buffers that could not be stored in VRAM.
+		int64_t getBufferRamConsumption();
 		bool hasAsyncTexturesQueued();
+		/// @return Number of textures waiting to be loaded asynchronously for each priority.
+		/// @note Textures that are currently being read or decoded are included until their decoding starts.
+		hmap<int, int> getAsyncTexturesQueuedCounts();
+		/// @param[in] timeout Max time to wait in seconds.
+		/// @return False if the timeout was reached.
 		/// @note A timeout value of 0.0 means indefinitely.
-		void waitForAsyncTextures(float timeout = 0.0f);
+		bool waitForAsyncTextures(float timeout = 0.0f);
+		/// @brief Waits until a group of textures is done loading asynchronously.
+		/// @param[in] textures The textures.
+		/// @param[in] timeout Max time to wait in seconds.
+		/// @return False if the timeout was reached.
+		/// @note A timeout value of 0.0 means indefinitely.
+		bool waitForAsyncTextures(harray<Texture*> textures, float timeout = 0.0f);
 
 		virtual float getPixelOffset() = 0;
 		virtual int getVRam() = 0;
@@ -142,11 +162,44 @@ namespace april
 		Texture* createTextureFromResource(chstr filename, Texture::Type type = Texture::TYPE_IMMUTABLE, Texture::LoadMode loadMode = Texture::LOAD_IMMEDIATE);
 		/// @note When a format is forced, it's best to use managed (but not necessary).
 		Texture* createTextureFromResource(chstr filename, Image::Format format, Texture::Type type = Texture::TYPE_MANAGED, Texture::LoadMode loadMode = Texture::LOAD_IMMEDIATE);
+		/// @brief Creates a texture that is reduced to fit into the given size when loaded.
+		/// @param[in] filename Resource filename.
+		/// @param[in] maxWidth Maximum width or 0 for no limit.
+		/// @param[in] maxHeight Maximum height or 0 for no limit.
+		/// @param[in] type Texture type.
+		/// @param[in] loadMode Texture load mode.
+		/// @note JPEG and PNG are reduced while decoding so the full-size image doesn't have to be kept in memory.
+		Texture* createTextureFromResource(chstr filename, int maxWidth, int maxHeight, Texture::Type type = Texture::TYPE_IMMUTABLE, Texture::LoadMode loadMode = Texture::LOAD_IMMEDIATE);
 		Texture* createTextureFromFile(chstr filename, Texture::Type type = Texture::TYPE_IMMUTABLE, Texture::LoadMode loadMode = Texture::LOAD_IMMEDIATE);
 		/// @note When a format is forced, it's best to use managed (but not necessary).
 		Texture* createTextureFromFile(chstr filename, Image::Format format, Texture::Type type = Texture::TYPE_MANAGED, Texture::LoadMode loadMode = Texture::LOAD_IMMEDIATE);
+		/// @brief Creates a texture that is reduced to fit into the given size when loaded.
+		/// @param[in] filename Filename.
+		/// @param[in] maxWidth Maximum width or 0 for no limit.
+		/// @param[in] maxHeight Maximum height or 0 for no limit.
+		/// @param[in] type Texture type.
+		/// @param[in] loadMode Texture load mode.
+		/// @note JPEG and PNG are reduced while decoding so the full-size image doesn't have to be kept in memory.
+		Texture* createTextureFromFile(chstr filename, int maxWidth, int maxHeight, Texture::Type type = Texture::TYPE_IMMUTABLE, Texture::LoadMode loadMode = Texture::LOAD_IMMEDIATE);
 		Texture* createTexture(int w, int h, unsigned char* data, Image::Format format, Texture::Type type = Texture::TYPE_MANAGED);
 		Texture* createTexture(int w, int h, Color color, Image::Format format, Texture::Type type = Texture::TYPE_MANAGED);
+		/// @brief Creates a vertex buffer so the vertices don't have to be sent again every frame.
+		/// @param[in] v The vertices.
+		/// @param[in] nVertices Number of vertices.
+		/// @param[in] usage Whether the vertices will be updated later.
+		/// @note Buffers that weren't deleted are deleted when the render system is destroyed.
+		VertexBuffer* createVertexBuffer(PlainVertex* v, int nVertices, BufferUsage usage = BU_IMMUTABLE);
+		VertexBuffer* createVertexBuffer(TexturedVertex* v, int nVertices, BufferUsage usage = BU_IMMUTABLE);
+		VertexBuffer* createVertexBuffer(ColoredVertex* v, int nVertices, BufferUsage usage = BU_IMMUTABLE);
+		VertexBuffer* createVertexBuffer(ColoredTexturedVertex* v, int nVertices, BufferUsage usage = BU_IMMUTABLE);
+		/// @brief Creates an index buffer that selects vertices from a vertex buffer.
+		/// @param[in] indices The indices.
+		/// @param[in] nIndices Number of indices.
+		/// @param[in] usage Whether the indices will be updated later.
+		/// @note Buffers that weren't deleted are deleted when the render system is destroyed.
+		IndexBuffer* createIndexBuffer(unsigned short* indices, int nIndices, BufferUsage usage = BU_IMMUTABLE);
+		/// @note OpenGL ES needs the OES_element_index_uint extension for 32 bit indices.
+		IndexBuffer* createIndexBuffer(unsigned int* indices, int nIndices, BufferUsage usage = BU_IMMUTABLE);
 		virtual PixelShader* createPixelShader();
 		virtual PixelShader* createPixelShader(chstr filename);
 		virtual VertexShader* createVertexShader();
@@ -168,15 +221,66 @@ namespace april
 		virtual void render(RenderOperation renderOperation, TexturedVertex* v, int nVertices, Color color) = 0;
 		virtual void render(RenderOperation renderOperation, ColoredVertex* v, int nVertices) = 0;
 		virtual void render(RenderOperation renderOperation, ColoredTexturedVertex* v, int nVertices) = 0;
+		/// @brief Renders vertices stored in a vertex buffer.
+		/// @param[in] renderOperation The render operation.
+		/// @param[in] vertexBuffer The vertex buffer.
+		/// @param[in] start Index of the first vertex.
+		/// @param[in] nVertices Number of vertices.
+		/// @param[in] color Color for vertices that don't have their own color.
+		virtual void render(RenderOperation renderOperation, VertexBuffer* vertexBuffer, int start, int nVertices, Color color = Color::White);
+		/// @brief Renders vertices stored in a vertex buffer in the order given by an index buffer.
+		/// @param[in] renderOperation The render operation.
+		/// @param[in] vertexBuffer The vertex buffer.
+		/// @param[in] indexBuffer The index buffer.
+		/// @param[in] start Position of the first index.
+		/// @param[in] nIndices Number of indices.
+		/// @param[in] color Color for vertices that don't have their own color.
+		virtual void render(RenderOperation renderOperation, VertexBuffer* vertexBuffer, IndexBuffer* indexBuffer, int start, int nIndices, Color color = Color::White);
+		/// @brief Renders vertices in the order given by 16 bit indices.
+		/// @param[in] renderOperation The render operation.
+		/// @param[in] v The vertices.
+		/// @param[in] nVertices Number of vertices.
+		/// @param[in] indices The indices.
+		/// @param[in] nIndices Number of indices.
+		/// @note This allows vertices shared by several primitives to be stored only once.
+		void render(RenderOperation renderOperation, PlainVertex* v, int nVertices, unsigned short* indices, int nIndices);
+		void render(RenderOperation renderOperation, PlainVertex* v, int nVertices, unsigned short* indices, int nIndices, Color color);
+		void render(RenderOperation renderOperation, TexturedVertex* v, int nVertices, unsigned short* indices, int nIndices);
+		void render(RenderOperation renderOperation, TexturedVertex* v, int nVertices, unsigned short* indices, int nIndices, Color color);
+		void render(RenderOperation renderOperation, ColoredVertex* v, int nVertices, unsigned short* indices, int nIndices);
+		void render(RenderOperation renderOperation, ColoredTexturedVertex* v, int nVertices, unsigned short* indices, int nIndices);
+		/// @brief Renders vertices in the order given by 32 bit indices.
+		/// @note OpenGL ES needs the OES_element_index_uint extension for 32 bit indices.
+		void render(RenderOperation renderOperation, PlainVertex* v, int nVertices, unsigned int* indices, int nIndices);
+		void render(RenderOperation renderOperation, PlainVertex* v, int nVertices, unsigned int* indices, int nIndices, Color color);
+		void render(RenderOperation renderOperation, TexturedVertex* v, int nVertices, unsigned int* indices, int nIndices);
+		void render(RenderOperation renderOperation, TexturedVertex* v, int nVertices, unsigned int* indices, int nIndices, Color color);
+		void render(RenderOperation renderOperation, ColoredVertex* v, int nVertices, unsigned int* indices, int nIndices);
+		void render(RenderOperation renderOperation, ColoredTexturedVertex* v, int nVertices, unsigned int* indices, int nIndices);
 		
 		void drawRect(grect rect, Color color);
 		void drawFilledRect(grect rect, Color color);
 		void drawTexturedRect(grect rect, grect src);
 		void drawTexturedRect(grect rect, grect src, Color color);
 
+		/// @brief Whether consecutive drawTexturedRect() calls with the same render state are rendered with a single draw call.
+		HL_DEFINE_IS(batching, Batching);
+		/// @note Not all render systems support batching.
+		void setBatching(bool value);
+		/// @brief Number of draw calls in the last frame as they were requested, before batching.
+		HL_DEFINE_GET(int, lastFrameDrawCalls, LastFrameDrawCalls);
+		/// @brief Number of draw calls in the last frame that were actually issued, after batching.
+		HL_DEFINE_GET(int, lastFrameIssuedDrawCalls, LastFrameIssuedDrawCalls);
+		/// @brief Renders all batched quads.
+		/// @note This happens automatically when the render state changes and in presentFrame(). It only has to be called manually when e.g. a texture is modified while it's still used by batched quads.
+		void flush();
+
 		hstr findTextureResource(chstr filename);
 		hstr findTextureFile(chstr filename);
 		void unloadTextures();
+		/// @brief Releases the VRAM copies of all vertex and index buffers.
+		/// @note Used together with unloadTextures() when the device context is lost. Buffers are restored from RAM when they are rendered the next time.
+		void unloadBuffers();
 		virtual Image::Format getNativeTextureFormat(Image::Format format) = 0;
 		virtual unsigned int getNativeColorUInt(const april::Color& color) = 0;
 		virtual Image* takeScreenshot(Image::Format format);
@@ -189,6 +293,8 @@ namespace april
 		bool created;
 		Options options;
 		harray<Texture*> textures;
+		harray<VertexBuffer*> vertexBuffers;
+		harray<IndexBuffer*> indexBuffers;
 		grect viewport;
 		bool depthBufferEnabled;
 		bool depthBufferWriteEnabled;
@@ -200,9 +306,33 @@ namespace april
 		grect orthoProjection;
 		Caps caps;
 		hmutex texturesMutex;
-
-		Texture* _createTextureFromSource(bool fromResource, chstr filename, Texture::Type type, Texture::LoadMode loadMode, Image::Format format = Image::FORMAT_INVALID);
+		bool batching;
+		TexturedVertex* batchVertices;
+		int batchVertexCount;
+		int batchVertexCapacity;
+		unsigned short* quadIndices;
+		int quadIndicesCapacity;
+		Color batchColor;
+		bool batchFlushing;
+		int drawCalls;
+		int issuedDrawCalls;
+		int lastFrameDrawCalls;
+		int lastFrameIssuedDrawCalls;
+
+		Texture* _createTextureFromSource(bool fromResource, chstr filename, Texture::Type type, Texture::LoadMode loadMode, Image::Format format = Image::FORMAT_INVALID, int maxWidth = 0, int maxHeight = 0);
 		virtual Texture* _createTexture(bool fromResource) = 0;
+		VertexBuffer* _createVertexBufferFromData(VertexBuffer::Format format, const void* v, int nVertices, BufferUsage usage);
+		virtual VertexBuffer* _createVertexBuffer();
+		IndexBuffer* _createIndexBufferFromData(IndexBuffer::Format format, const void* indices, int nIndices, BufferUsage usage);
+		virtual IndexBuffer* _createIndexBuffer();
+		/// @brief Renders vertex data of a buffer that is kept in RAM with the regular render() functions.
+		void _renderBufferData(RenderOperation renderOperation, VertexBuffer::Format format, unsigned char* data, int nVertices, Color color);
+		/// @brief Renders vertices in the order given by indices.
+		/// @note The default implementation gathers the indexed vertices and renders them with the regular render() functions.
+		virtual void _renderIndexed(RenderOperation renderOperation, VertexBuffer::Format format, unsigned char* v, int nVertices, const void* indices, IndexBuffer::Format indexFormat, int nIndices, Color color);
+		/// @return Shared indices that render quads of 4 vertices each as a triangle list.
+		/// @note The returned array is only valid until the next call.
+		unsigned short* _getQuadIndices(int nQuads);
 
 		void _registerTexture(Texture* texture);
 		void _unregisterTexture(Texture* texture);
@@ -213,6 +343,14 @@ namespace april
 		virtual void _setupCaps() = 0;
 		virtual void _setResolution(int w, int h, bool fullscreen);
 
+		virtual bool _isBatchingSupported();
+		void _addBatchQuad(grect rect, grect src, Color color);
+		/// @brief Renders batched quads and counts the draw call.
+		/// @note Has to be called at the beginning of every render() implementation.
+		void _prepareDrawCall();
+		/// @brief Makes the draw call counts of the current frame available and resets them.
+		void _finishFrameDrawCalls();
+
 		unsigned int _numPrimitives(RenderOperation renderOperation, int nVertices);
 		unsigned int _limitPrimitives(RenderOperation renderOperation, int nVertices);
 
@@ -27,6 +27,7 @@
 
 namespace april
 {
+	class FileBuffer;
 	class Image;
 	class RenderSystem;
 	class TextureAsync;
@@ -78,6 +79,10 @@ namespace april
 			LOAD_ASYNC_ON_DEMAND = 3
 		};
 
+		/// @brief Called on the main thread once an async load has finished.
+		/// @note Use isLoadedAsync() or isLoaded() to check whether loading succeeded.
+		typedef void (*AsyncLoadCallback)(Texture* texture);
+
 		DEPRECATED_ATTRIBUTE static Image::Format FORMAT_ALPHA;
 		DEPRECATED_ATTRIBUTE static Image::Format FORMAT_ARGB;
 
@@ -91,6 +96,19 @@ namespace april
 		HL_DEFINE_IS(locked, Locked);
 		HL_DEFINE_IS(dirty, Dirty);
 		HL_DEFINE_IS(fromResource, FromResource);
+		/// @brief Maximum width the image is reduced to when loading or 0 for no limit.
+		HL_DEFINE_GET(int, maxWidth, MaxWidth);
+		/// @brief Maximum height the image is reduced to when loading or 0 for no limit.
+		HL_DEFINE_GET(int, maxHeight, MaxHeight);
+		/// @brief Number of bytes uploaded from the RAM copy to the GPU.
+		HL_DEFINE_GET(int64_t, uploadedBytes, UploadedBytes);
+		/// @brief Number of bytes that did not have to be uploaded on unlock(), because only the modified regions were uploaded.
+		HL_DEFINE_GET(int64_t, savedUploadBytes, SavedUploadBytes);
+		HL_DEFINE_GETSET(AsyncLoadCallback, asyncLoadCallback, AsyncLoadCallback);
+		/// @brief Time in milliseconds it took to read the file during the last async load.
+		HL_DEFINE_GET(float, asyncReadTime, AsyncReadTime);
+		/// @brief Time in milliseconds it took to decode the file during the last async load.
+		HL_DEFINE_GET(float, asyncDecodeTime, AsyncDecodeTime);
 		int getWidth();
 		int getHeight();
 		int getBpp();
@@ -103,14 +121,25 @@ namespace april
 		bool isAsyncLoadQueued();
 
 		bool load();
-		bool loadAsync();
+		/// @param[in] priority Textures with a higher priority are loaded first.
+		/// @param[in] deadline Time in milliseconds within which the texture is needed. Among textures with the same priority, the one with the earliest deadline is loaded first. 0 means no deadline.
+		bool loadAsync(int priority = 0, float deadline = 0.0f);
+		/// @brief Changes the priority and deadline of a queued async load.
+		/// @param[in] priority Textures with a higher priority are loaded first.
+		/// @param[in] deadline Time in milliseconds within which the texture is needed. 0 means no deadline.
+		/// @return False if the texture isn't waiting to be loaded (e.g. it is already being decoded).
+		bool setAsyncLoadPriority(int priority, float deadline = 0.0f);
 		void unload();
 		bool loadMetaData();
+		/// @param[in] timeout Max time to wait in seconds.
+		/// @return False if the timeout was reached.
 		/// @note A timeout value of 0.0 means indefinitely.
-		void waitForAsyncLoad(float timeout = 0.0f);
+		bool waitForAsyncLoad(float timeout = 0.0f);
 
 		bool lock();
+		/// @note Only the regions modified while locked are uploaded to the GPU.
 		bool unlock();
+		void resetUploadStatistics();
 
 		bool clear();
 		Color getPixel(int x, int y);
@@ -199,15 +228,25 @@ namespace april
 		float effectiveWidth; // used only with software NPOT textures
 		float effectiveHeight; // used only with software NPOT textures
 		int compressedSize; // used in compressed textures only
+		int maxWidth;
+		int maxHeight;
 		Filter filter;
 		AddressMode addressMode;
 		bool locked;
 		bool dirty;
+		harray<grect> dirtyRects;
+		int64_t uploadedBytes;
+		int64_t savedUploadBytes;
 		unsigned char* data;
 		unsigned char* dataAsync;
 		bool asyncLoadQueued;
 		bool asyncLoadDiscarded;
 		hmutex asyncLoadMutex;
+		int asyncQueueIndex; // position in TextureAsync's queue, only accessed by TextureAsync
+		AsyncLoadCallback asyncLoadCallback;
+		int asyncUploadRows; // rows of dataAsync already uploaded when it's uploaded in slices across several frames
+		float asyncReadTime;
+		float asyncDecodeTime;
 		bool fromResource;
 		bool firstUpload; // required because of how some rendering systems work
 
@@ -219,11 +258,23 @@ namespace april
 		virtual bool _createInternalTexture(unsigned char* data, int size, Type type) = 0;
 		virtual bool _destroyInternalTexture() = 0;
 		virtual void _assignFormat() = 0;
+		/// @brief Whether an empty internal texture can be created and then filled in parts.
+		virtual bool _isUploadSlicingSupported();
 
-		hstream* _prepareAsyncStream();
-		void _decodeFromAsyncStream(hstream* stream);
+		/// @return Path of the file that can be accessed directly through the file system or an empty string if the file is packed in an archive.
+		hstr _getMappableFilename();
+		FileBuffer* _prepareAsyncBuffer();
+		void _decodeFromAsyncBuffer(FileBuffer* buffer);
+		/// @brief Uploads async data to the GPU in horizontal slices so large textures can be spread across several frames.
+		/// @param[in] maxBytes Max number of bytes to upload. 0 means no limit.
+		/// @return Number of bytes uploaded.
+		/// @note The texture counts as loaded after the first slice. The whole texture is uploaded at once if slicing is not supported.
+		int64_t _uploadAsyncSlice(int64_t maxBytes);
+		void _keepUploadedData(unsigned char* currentData);
 
 		hstr _getInternalName();
+		/// @return Options for decoding the image file.
+		Image::DecodeOptions _getDecodeOptions();
 
 		void _setupPot(int& outWidth, int& outHeight);
 		unsigned char* _createPotData(int& outWidth, int& outHeight, unsigned char* data);
@@ -232,6 +283,7 @@ namespace april
 		Lock _tryLock(int x, int y, int w, int h);
 		Lock _tryLock();
 		bool _unlock(Lock lock, bool update);
+		void _addDirtyRect(int x, int y, int w, int h);
 		virtual Lock _tryLockSystem(int x, int y, int w, int h) = 0;
 		virtual bool _unlockSystem(Lock& lock, bool update) = 0;
 		bool _uploadDataToGpu(int x, int y, int w, int h);
@@ -0,0 +1,100 @@
+/// @file
+/// @version 3.5
+/// 
+/// @section LICENSE
+/// 
+/// This program is free software; you can redistribute it and/or modify it under
+/// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
+/// 
+/// @section DESCRIPTION
+/// 
+/// Defines a generic vertex buffer.
+
+#ifndef APRIL_VERTEX_BUFFER_H
+#define APRIL_VERTEX_BUFFER_H
+
+#include <hltypes/hltypesUtil.h>
+
+#include "aprilExport.h"
+#include "aprilUtil.h"
+
+namespace april
+{
+	class RenderSystem;
+
+	/// @brief Defines a generic vertex buffer that keeps geometry between frames.
+	/// @note The vertices are always kept in RAM as well. When the device context is lost, RenderSystem::unloadBuffers() releases the VRAM copy
+	/// and the buffer is restored from RAM the next time it's rendered.
+	class aprilExport VertexBuffer
+	{
+	public:
+		friend class RenderSystem;
+
+		/// @brief Vertex type stored in the buffer.
+		enum Format
+		{
+			FORMAT_PLAIN = 0,
+			FORMAT_TEXTURED = 1,
+			FORMAT_COLORED = 2,
+			FORMAT_COLORED_TEXTURED = 3
+		};
+
+		/// @brief Destructor.
+		virtual ~VertexBuffer();
+
+		HL_DEFINE_GET(Format, format, Format);
+		HL_DEFINE_GET(BufferUsage, usage, Usage);
+		HL_DEFINE_GET(int, count, Count);
+		/// @return Size of one vertex in bytes.
+		int getStride();
+		/// @return RAM used by the vertex data.
+		int getCurrentRamSize();
+		/// @return VRAM used by the vertex data.
+		int getCurrentVRamSize();
+
+		/// @brief Overwrites vertices in the buffer.
+		/// @param[in] v The vertices.
+		/// @param[in] nVertices Number of vertices.
+		/// @param[in] offset Index of the first vertex to overwrite.
+		/// @return True if successful.
+		/// @note Only dynamic buffers can be updated and the vertex type has to match the buffer format.
+		bool update(PlainVertex* v, int nVertices, int offset = 0);
+		bool update(TexturedVertex* v, int nVertices, int offset = 0);
+		bool update(ColoredVertex* v, int nVertices, int offset = 0);
+		bool update(ColoredTexturedVertex* v, int nVertices, int offset = 0);
+
+		/// @return Size of one vertex of the given format in bytes.
+		static int getFormatStride(Format format);
+
+	protected:
+		Format format;
+		BufferUsage usage;
+		int count;
+		/// @brief Vertex data in RAM, used for rendering when the data isn't stored in VRAM and for restoring the VRAM copy.
+		unsigned char* data;
+		int vramSize;
+		/// @brief Whether the VRAM copy was released and has to be created again.
+		bool unloaded;
+
+		/// @brief Basic constructor.
+		VertexBuffer();
+
+		bool _create(Format format, const void* v, int nVertices, BufferUsage usage);
+		bool _update(Format format, const void* v, int nVertices, int offset);
+		/// @brief Releases the VRAM copy.
+		void _unload();
+		/// @brief Creates the VRAM copy again if it was released.
+		void _restore();
+
+		/// @brief Creates the buffer in VRAM and uploads the data.
+		/// @return False if the data has to be rendered from RAM instead.
+		/// @note Implementations have to adjust vramSize if the data is stored in a different size.
+		virtual bool _createInternalBuffer(const void* data, int size);
+		virtual bool _updateInternalBuffer(const void* data, int offset, int size);
+		virtual void _destroyInternalBuffer();
+
+	};
+
+}
+
+#endif
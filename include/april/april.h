@@ -213,6 +213,20 @@ namespace april
 	/// @param[in] value The max number of async textures uploaded to the GPU per frame.
 	/// @note A value of 0 or less indicates all currently loaded textures.
 	aprilFnExport void setMaxAsyncTextureUploadsPerFrame(int value);
+	/// @brief Gets the max number of bytes of async textures uploaded to the GPU per frame.
+	/// @return The max number of bytes of async textures uploaded to the GPU per frame.
+	aprilFnExport int getMaxAsyncTextureUploadBytesPerFrame();
+	/// @brief Sets the max number of bytes of async textures uploaded to the GPU per frame.
+	/// @param[in] value The max number of bytes of async textures uploaded to the GPU per frame.
+	/// @note A value of 0 or less indicates no limit. Textures larger than this are uploaded in slices across several frames if the render system supports it.
+	aprilFnExport void setMaxAsyncTextureUploadBytesPerFrame(int value);
+	/// @brief Gets the max time in milliseconds spent on uploading async textures to the GPU per frame.
+	/// @return The max time in milliseconds spent on uploading async textures to the GPU per frame.
+	aprilFnExport float getMaxAsyncTextureUploadTimePerFrame();
+	/// @brief Sets the max time in milliseconds spent on uploading async textures to the GPU per frame.
+	/// @param[in] value The max time in milliseconds spent on uploading async textures to the GPU per frame.
+	/// @note A value of 0 or less indicates no limit. The measured upload speed is used to split textures into slices that fit into this time.
+	aprilFnExport void setMaxAsyncTextureUploadTimePerFrame(float value);
 	/// @brief Gets the max number of async textures concurrently loaded in RAM and waiting for upload.
 	/// @return The max number of async textures concurrently loaded in RAM and waiting for upload.
 	aprilFnExport int getMaxWaitingAsyncTextures();
@@ -220,6 +234,41 @@ namespace april
 	/// @param[in] value The max number of async textures concurrently loaded in RAM and waiting for upload.
 	/// @note A value of 0 or less indicates no limit.
 	aprilFnExport void setMaxWaitingAsyncTextures(int value);
+	/// @brief Gets the max number of threads decoding async textures.
+	/// @return The max number of threads decoding async textures.
+	aprilFnExport int getMaxAsyncTextureDecoderThreads();
+	/// @brief Sets the max number of threads decoding async textures.
+	/// @param[in] value The max number of threads decoding async textures.
+	/// @note A value of 0 or less indicates SystemInfo::cpuCores which is the default.
+	aprilFnExport void setMaxAsyncTextureDecoderThreads(int value);
+	/// @brief Gets the number of threads used for large Image operations.
+	/// @return The number of threads used for large Image operations.
+	aprilFnExport int getImageProcessingThreads();
+	/// @brief Sets the number of threads used for large Image operations.
+	/// @param[in] value The number of threads used for large Image operations.
+	/// @note A value of 0 or 1 disables multi-threaded processing which is the default. A negative value uses SystemInfo::cpuCores.
+	/// @note Should be called from the main thread.
+	/// @note Worker threads are kept alive between operations until april::destroy() is called.
+	/// @note The JPEG and PNG parts of JPT images are always decoded at the same time, regardless of this setting.
+	aprilFnExport void setImageProcessingThreads(int value);
+	/// @brief Gets the minimum number of pixels an Image operation needs to have to be processed on multiple threads.
+	/// @return The minimum number of pixels an Image operation needs to have to be processed on multiple threads.
+	aprilFnExport int getParallelImageProcessingThreshold();
+	/// @brief Sets the minimum number of pixels an Image operation needs to have to be processed on multiple threads.
+	/// @param[in] value The minimum number of pixels an Image operation needs to have to be processed on multiple threads.
+	/// @note Smaller operations are not worth the overhead of starting threads.
+	aprilFnExport void setParallelImageProcessingThreshold(int value);
+	/// @brief Gets the max SIMD instruction set level used by Image operations.
+	/// @return The max SIMD instruction set level used by Image operations.
+	aprilFnExport int getMaxImageSimdLevel();
+	/// @brief Sets the max SIMD instruction set level used by Image operations.
+	/// @param[in] value The max SIMD instruction set level used by Image operations.
+	/// @note Levels are 0 for scalar code only, 1 for SSE2, 2 for SSSE3 and 3 for AVX2. A negative value indicates no limit which is the default.
+	/// @note Mainly intended for comparing the SIMD kernels with the scalar code. Must not be called while Image operations are running on other threads.
+	aprilFnExport void setMaxImageSimdLevel(int value);
+	/// @brief Gets the SIMD instruction set level Image operations currently use.
+	/// @return The level supported by the CPU limited by getMaxImageSimdLevel().
+	aprilFnExport int getImageSimdLevel();
 
 }
 
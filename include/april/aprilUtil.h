@@ -52,6 +52,12 @@ namespace april
 		CM_UNDEFINED = 0x7FFFFFFF
 	};
 
+	enum BufferUsage
+	{
+		BU_IMMUTABLE = 0,
+		BU_DYNAMIC = 1
+	};
+
 	DEPRECATED_ATTRIBUTE extern aprilExport RenderOperation TriangleList;
 	DEPRECATED_ATTRIBUTE extern aprilExport RenderOperation TriangleStrip;
 	DEPRECATED_ATTRIBUTE extern aprilExport RenderOperation TriangleFan;
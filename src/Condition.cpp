@@ -0,0 +1,143 @@
+/// @file
+/// @version 3.5
+/// 
+/// @section LICENSE
+/// 
+/// This program is free software; you can redistribute it and/or modify it under
+/// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <errno.h>
+#include <pthread.h>
+#include <sys/time.h>
+#endif
+
+#include "Condition.h"
+
+namespace april
+{
+	Condition::ScopeLock::ScopeLock(Condition* condition) : condition(NULL)
+	{
+		if (condition != NULL)
+		{
+			this->acquire(condition);
+		}
+	}
+
+	Condition::ScopeLock::~ScopeLock()
+	{
+		this->release();
+	}
+
+	void Condition::ScopeLock::acquire(Condition* condition)
+	{
+		this->release();
+		this->condition = condition;
+		this->condition->lock();
+	}
+
+	void Condition::ScopeLock::release()
+	{
+		if (this->condition != NULL)
+		{
+			this->condition->unlock();
+			this->condition = NULL;
+		}
+	}
+
+	Condition::Condition()
+	{
+#ifdef _WIN32
+		CRITICAL_SECTION* section = new CRITICAL_SECTION();
+		InitializeCriticalSectionEx(section, 0, 0);
+		this->mutex = section;
+		CONDITION_VARIABLE* conditionVariable = new CONDITION_VARIABLE();
+		InitializeConditionVariable(conditionVariable);
+		this->variable = conditionVariable;
+#else
+		pthread_mutex_t* pthreadMutex = new pthread_mutex_t();
+		pthread_mutex_init(pthreadMutex, NULL);
+		this->mutex = pthreadMutex;
+		pthread_cond_t* pthreadCondition = new pthread_cond_t();
+		pthread_cond_init(pthreadCondition, NULL);
+		this->variable = pthreadCondition;
+#endif
+	}
+
+	Condition::~Condition()
+	{
+#ifdef _WIN32
+		DeleteCriticalSection((CRITICAL_SECTION*)this->mutex);
+		delete (CRITICAL_SECTION*)this->mutex;
+		delete (CONDITION_VARIABLE*)this->variable; // Windows condition variables don't need to be destroyed
+#else
+		pthread_cond_destroy((pthread_cond_t*)this->variable);
+		delete (pthread_cond_t*)this->variable;
+		pthread_mutex_destroy((pthread_mutex_t*)this->mutex);
+		delete (pthread_mutex_t*)this->mutex;
+#endif
+	}
+
+	void Condition::lock()
+	{
+#ifdef _WIN32
+		EnterCriticalSection((CRITICAL_SECTION*)this->mutex);
+#else
+		pthread_mutex_lock((pthread_mutex_t*)this->mutex);
+#endif
+	}
+
+	void Condition::unlock()
+	{
+#ifdef _WIN32
+		LeaveCriticalSection((CRITICAL_SECTION*)this->mutex);
+#else
+		pthread_mutex_unlock((pthread_mutex_t*)this->mutex);
+#endif
+	}
+
+	void Condition::wait()
+	{
+#ifdef _WIN32
+		SleepConditionVariableCS((CONDITION_VARIABLE*)this->variable, (CRITICAL_SECTION*)this->mutex, INFINITE);
+#else
+		pthread_cond_wait((pthread_cond_t*)this->variable, (pthread_mutex_t*)this->mutex);
+#endif
+	}
+
+	bool Condition::wait(float timeout)
+	{
+#ifdef _WIN32
+		return (SleepConditionVariableCS((CONDITION_VARIABLE*)this->variable, (CRITICAL_SECTION*)this->mutex, (DWORD)timeout) != 0 || GetLastError() != ERROR_TIMEOUT);
+#else
+		timeval now;
+		gettimeofday(&now, NULL);
+		long long nanoseconds = (long long)now.tv_usec * 1000LL + (long long)(timeout * 1000000.0f);
+		timespec time;
+		time.tv_sec = now.tv_sec + (time_t)(nanoseconds / 1000000000LL);
+		time.tv_nsec = (long)(nanoseconds % 1000000000LL);
+		return (pthread_cond_timedwait((pthread_cond_t*)this->variable, (pthread_mutex_t*)this->mutex, &time) != ETIMEDOUT);
+#endif
+	}
+
+	void Condition::signal()
+	{
+#ifdef _WIN32
+		WakeConditionVariable((CONDITION_VARIABLE*)this->variable);
+#else
+		pthread_cond_signal((pthread_cond_t*)this->variable);
+#endif
+	}
+
+	void Condition::broadcast()
+	{
+#ifdef _WIN32
+		WakeAllConditionVariable((CONDITION_VARIABLE*)this->variable);
+#else
+		pthread_cond_broadcast((pthread_cond_t*)this->variable);
+#endif
+	}
+
+}
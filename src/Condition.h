@@ -0,0 +1,65 @@
+/// @file
+/// @version 3.5
+/// 
+/// @section LICENSE
+/// 
+/// This program is free software; you can redistribute it and/or modify it under
+/// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
+/// 
+/// @section DESCRIPTION
+/// 
+/// Defines a condition variable with its own mutex.
+
+#ifndef APRIL_CONDITION_H
+#define APRIL_CONDITION_H
+
+#include <stdlib.h>
+
+namespace april
+{
+	/// @brief Puts threads to sleep until another thread signals them.
+	/// @note State shared between the threads has to be protected by locking the condition.
+	class Condition
+	{
+	public:
+		class ScopeLock
+		{
+		public:
+			ScopeLock(Condition* condition = NULL);
+			~ScopeLock();
+
+			void acquire(Condition* condition);
+			void release();
+
+		protected:
+			Condition* condition;
+
+		};
+
+		Condition();
+		~Condition();
+
+		void lock();
+		void unlock();
+		/// @brief Waits until the condition is signaled.
+		/// @note The condition has to be locked. It is unlocked while waiting and locked again before this returns.
+		void wait();
+		/// @brief Waits until the condition is signaled or the timeout is reached.
+		/// @param[in] timeout Max time to wait in milliseconds.
+		/// @return False if the timeout was reached.
+		/// @note The condition has to be locked. It is unlocked while waiting and locked again before this returns.
+		bool wait(float timeout);
+		/// @brief Wakes up one waiting thread.
+		void signal();
+		/// @brief Wakes up all waiting threads.
+		void broadcast();
+
+	protected:
+		void* mutex;
+		void* variable;
+
+	};
+
+}
+
+#endif
@@ -0,0 +1,149 @@
+/// @file
+/// @version 3.5
+/// 
+/// @section LICENSE
+/// 
+/// This program is free software; you can redistribute it and/or modify it under
+/// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
+
+#include <hltypes/hplatform.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <hltypes/hltypesUtil.h>
+#include <hltypes/hsbase.h>
+#include <hltypes/hstring.h>
+
+#include "FileBuffer.h"
+
+namespace april
+{
+	FileBuffer::FileBuffer() : data(NULL), size(0), mapped(false)
+	{
+	}
+
+	FileBuffer::~FileBuffer()
+	{
+		this->clear();
+	}
+
+	bool FileBuffer::map(chstr filename)
+	{
+		this->clear();
+#ifndef _WIN32
+		int file = ::open(filename.cStr(), O_RDONLY);
+		if (file < 0)
+		{
+			return false;
+		}
+		struct stat info;
+		if (fstat(file, &info) != 0 || info.st_size <= 0 || info.st_size > 0x7FFFFFFF)
+		{
+			::close(file);
+			return false;
+		}
+		void* mapping = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+		::close(file); // the mapping keeps its own reference to the file
+		if (mapping == MAP_FAILED)
+		{
+			return false;
+		}
+		// decoders read the data front to back so the OS can start reading the pages ahead right away
+		madvise(mapping, (size_t)info.st_size, MADV_WILLNEED);
+		madvise(mapping, (size_t)info.st_size, MADV_SEQUENTIAL);
+		this->data = (unsigned char*)mapping;
+		this->size = (int)info.st_size;
+		this->mapped = true;
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	bool FileBuffer::read(hsbase& stream)
+	{
+		this->clear();
+		int size = (int)(stream.size() - stream.position());
+		if (size <= 0)
+		{
+			return false;
+		}
+		this->data = new unsigned char[size];
+		this->size = stream.readRaw(this->data, size);
+		if (this->size != size)
+		{
+			this->clear();
+			return false;
+		}
+		return true;
+	}
+
+	void FileBuffer::fetch()
+	{
+#ifndef _WIN32
+		if (!this->mapped)
+		{
+			return;
+		}
+		volatile unsigned char value = 0; // prevents the compiler from optimizing away the reads
+		int pageSize = (int)sysconf(_SC_PAGESIZE);
+		for_iter_step (i, 0, this->size, pageSize)
+		{
+			value += this->data[i];
+		}
+#endif
+	}
+
+	void FileBuffer::clear()
+	{
+		if (this->data != NULL)
+		{
+			if (!this->mapped)
+			{
+				delete[] this->data;
+			}
+#ifndef _WIN32
+			else
+			{
+				munmap(this->data, (size_t)this->size);
+			}
+#endif
+			this->data = NULL;
+		}
+		this->size = 0;
+		this->mapped = false;
+	}
+
+	bool FileBuffer::prefetch(chstr filename)
+	{
+#ifndef _WIN32
+		int file = ::open(filename.cStr(), O_RDONLY);
+		if (file < 0)
+		{
+			return false;
+		}
+#ifndef __APPLE__
+		bool result = (posix_fadvise(file, 0, 0, POSIX_FADV_WILLNEED) == 0);
+#else
+		bool result = false;
+		struct stat info;
+		if (fstat(file, &info) == 0 && info.st_size > 0 && info.st_size <= 0x7FFFFFFF)
+		{
+			struct radvisory advisory;
+			advisory.ra_offset = 0;
+			advisory.ra_count = (int)info.st_size;
+			result = (fcntl(file, F_RDADVISE, &advisory) != -1);
+		}
+#endif
+		::close(file);
+		return result;
+#else
+		return false;
+#endif
+	}
+
+}
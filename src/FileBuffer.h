@@ -0,0 +1,64 @@
+/// @file
+/// @version 3.5
+/// 
+/// @section LICENSE
+/// 
+/// This program is free software; you can redistribute it and/or modify it under
+/// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
+/// 
+/// @section DESCRIPTION
+/// 
+/// Defines a read-only buffer with the contents of a file.
+
+#ifndef APRIL_FILE_BUFFER_H
+#define APRIL_FILE_BUFFER_H
+
+#include <hltypes/hltypesUtil.h>
+#include <hltypes/hsbase.h>
+#include <hltypes/hstring.h>
+
+namespace april
+{
+	/// @brief Holds the contents of a file, memory-mapped where possible so no copy of the file has to be kept in RAM.
+	class FileBuffer
+	{
+	public:
+		FileBuffer();
+		~FileBuffer();
+
+		HL_DEFINE_GET(unsigned char*, data, Data);
+		HL_DEFINE_GET(int, size, Size);
+		HL_DEFINE_IS(mapped, Mapped);
+
+		/// @brief Maps a file into memory.
+		/// @param[in] filename Path of the file.
+		/// @return True if successful.
+		/// @note Only available on Posix platforms. Pages are read ahead asynchronously by the OS.
+		bool map(chstr filename);
+		/// @brief Reads the remaining data of a stream into RAM.
+		/// @param[in] stream The stream.
+		/// @return True if successful.
+		/// @note Used for files that cannot be mapped (e.g. packed resources).
+		bool read(hsbase& stream);
+		/// @brief Makes sure a mapped file has been read from the disk.
+		/// @note Accessing pages that weren't read yet blocks on I/O so this allows I/O to be done before the data is used.
+		void fetch();
+		/// @brief Releases the data and unmaps the file if it was mapped.
+		void clear();
+
+		/// @brief Hints the OS to start reading a file in the background.
+		/// @param[in] filename Path of the file.
+		/// @return True if successful.
+		/// @note Only available on Posix platforms. Doesn't block on I/O so it can be used for files that are needed soon.
+		static bool prefetch(chstr filename);
+
+	protected:
+		unsigned char* data;
+		int size;
+		bool mapped;
+
+	};
+
+}
+
+#endif
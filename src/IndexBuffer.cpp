@@ -0,0 +1,157 @@
+/// @file
+/// @version 3.5
+///
+/// @section LICENSE
+///
+/// This program is free software; you can redistribute it and/or modify it under
+/// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
+
+#include <string.h>
+
+#include <hltypes/hlog.h>
+
+#include "april.h"
+#include "IndexBuffer.h"
+#include "RenderSystem.h"
+
+namespace april
+{
+	IndexBuffer::IndexBuffer()
+	{
+		this->format = FORMAT_16_BIT;
+		this->usage = BU_IMMUTABLE;
+		this->count = 0;
+		this->data = NULL;
+		this->vramSize = 0;
+		this->unloaded = false;
+	}
+
+	IndexBuffer::~IndexBuffer()
+	{
+		if (april::rendersys != NULL)
+		{
+			april::rendersys->indexBuffers -= this;
+		}
+		if (this->data != NULL)
+		{
+			delete[] this->data;
+		}
+	}
+
+	int IndexBuffer::getStride()
+	{
+		return (this->format == FORMAT_32_BIT ? sizeof(unsigned int) : sizeof(unsigned short));
+	}
+
+	int IndexBuffer::getCurrentRamSize()
+	{
+		return this->count * this->getStride();
+	}
+
+	int IndexBuffer::getCurrentVRamSize()
+	{
+		return this->vramSize;
+	}
+
+	bool IndexBuffer::update(unsigned short* indices, int nIndices, int offset)
+	{
+		return this->_update(FORMAT_16_BIT, indices, nIndices, offset);
+	}
+
+	bool IndexBuffer::update(unsigned int* indices, int nIndices, int offset)
+	{
+		return this->_update(FORMAT_32_BIT, indices, nIndices, offset);
+	}
+
+	bool IndexBuffer::_create(Format format, const void* indices, int nIndices, BufferUsage usage)
+	{
+		if (nIndices <= 0)
+		{
+			hlog::error(logTag, "Cannot create an empty index buffer!");
+			return false;
+		}
+		this->format = format;
+		this->usage = usage;
+		this->count = nIndices;
+		int size = nIndices * this->getStride();
+		// the RAM copy is kept so the buffer can be restored when the device context is lost
+		this->data = new unsigned char[size];
+		memcpy(this->data, indices, size);
+		this->vramSize = size;
+		if (!this->_createInternalBuffer(indices, size))
+		{
+			this->vramSize = 0;
+		}
+		april::rendersys->indexBuffers += this;
+		return true;
+	}
+
+	bool IndexBuffer::_update(Format format, const void* indices, int nIndices, int offset)
+	{
+		if (this->usage != BU_DYNAMIC)
+		{
+			hlog::error(logTag, "Cannot update an immutable index buffer!");
+			return false;
+		}
+		if (format != this->format)
+		{
+			hlog::error(logTag, "Cannot update index buffer, index type does not match the buffer format!");
+			return false;
+		}
+		if (offset < 0 || nIndices < 0 || offset + nIndices > this->count)
+		{
+			hlog::errorf(logTag, "Cannot update index buffer, range %d+%d is outside of %d indices!", offset, nIndices, this->count);
+			return false;
+		}
+		if (nIndices == 0)
+		{
+			return true;
+		}
+		int stride = this->getStride();
+		memcpy(&this->data[offset * stride], indices, nIndices * stride);
+		if (this->vramSize > 0)
+		{
+			return this->_updateInternalBuffer(indices, offset * stride, nIndices * stride);
+		}
+		return true;
+	}
+
+	void IndexBuffer::_unload()
+	{
+		if (this->vramSize > 0)
+		{
+			this->_destroyInternalBuffer();
+			this->vramSize = 0;
+			this->unloaded = true;
+		}
+	}
+
+	void IndexBuffer::_restore()
+	{
+		if (this->unloaded)
+		{
+			this->unloaded = false;
+			int size = this->count * this->getStride();
+			this->vramSize = size;
+			if (!this->_createInternalBuffer(this->data, size))
+			{
+				this->vramSize = 0;
+			}
+		}
+	}
+
+	bool IndexBuffer::_createInternalBuffer(const void* data, int size)
+	{
+		return false;
+	}
+
+	bool IndexBuffer::_updateInternalBuffer(const void* data, int offset, int size)
+	{
+		return false;
+	}
+
+	void IndexBuffer::_destroyInternalBuffer()
+	{
+	}
+
+}
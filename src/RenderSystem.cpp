@@ -7,6 +7,7 @@
 /// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
 
 #include <stdio.h>
+#include <string.h>
 #include <algorithm>
 #ifdef __APPLE__
 #include <TargetConditionals.h>
@@ -23,12 +24,17 @@
 #include "april.h"
 #include "aprilUtil.h"
 #include "Image.h"
+#include "IndexBuffer.h"
 #include "RenderSystem.h"
 #include "Platform.h"
 #include "Texture.h"
 #include "TextureAsync.h"
+#include "VertexBuffer.h"
 #include "Window.h"
 
+#define APRIL_BATCH_QUADS 256 // initial capacity of the batch
+#define APRIL_BATCH_MAX_VERTICES 65536 // limit of 16 bit indices
+
 namespace april
 {
 	// optimizations, but they are not thread-safe
@@ -120,6 +126,18 @@ namespace april
 		this->depthBufferWriteEnabled = false;
 		this->textureFilter = Texture::FILTER_UNDEFINED;
 		this->textureAddressMode = Texture::ADDRESS_UNDEFINED;
+		this->batching = false;
+		this->batchVertices = NULL;
+		this->batchVertexCount = 0;
+		this->batchVertexCapacity = 0;
+		this->quadIndices = NULL;
+		this->quadIndicesCapacity = 0;
+		this->batchColor = Color::White;
+		this->batchFlushing = false;
+		this->drawCalls = 0;
+		this->issuedDrawCalls = 0;
+		this->lastFrameDrawCalls = 0;
+		this->lastFrameIssuedDrawCalls = 0;
 	}
 	
 	RenderSystem::~RenderSystem()
@@ -138,6 +156,14 @@ namespace april
 		}
 		this->destroy();
 		delete this->state;
+		if (this->batchVertices != NULL)
+		{
+			delete[] this->batchVertices;
+		}
+		if (this->quadIndices != NULL)
+		{
+			delete[] this->quadIndices;
+		}
 	}
 	
 	bool RenderSystem::create(RenderSystem::Options options)
@@ -160,12 +186,24 @@ namespace april
 		if (this->created)
 		{
 			hlog::writef(logTag, "Destroying rendersystem '%s'.", this->name.cStr());
+			this->batchVertexCount = 0; // batched quads can't be rendered anymore
 			// creating a copy, because deleting a texture modifies this->textures
 			harray<Texture*> textures = this->getTextures();
 			foreach (Texture*, it, textures)
 			{
 				delete (*it);
 			}
+			// creating copies, because deleting a buffer modifies these arrays
+			harray<VertexBuffer*> vertexBuffers = this->vertexBuffers;
+			foreach (VertexBuffer*, it, vertexBuffers)
+			{
+				delete (*it);
+			}
+			harray<IndexBuffer*> indexBuffers = this->indexBuffers;
+			foreach (IndexBuffer*, it, indexBuffers)
+			{
+				delete (*it);
+			}
 			// TODOa - uncomment
 			//this->state->reset();
 			this->created = false;
@@ -206,11 +244,13 @@ namespace april
 	
 	void RenderSystem::setViewport(grect value)
 	{
+		this->flush();
 		this->viewport = value;
 	}
 
 	void RenderSystem::setDepthBuffer(bool enabled, bool writeEnabled)
 	{
+		this->flush();
 		if (this->options.depthBuffer)
 		{
 			this->depthBufferEnabled = enabled;
@@ -224,6 +264,7 @@ namespace april
 
 	void RenderSystem::setOrthoProjection(grect rect)
 	{
+		this->flush();
 		// TODOaa - change and improve this implementation
 		// also: this variable needs to be updated in ::setProjectionMatrix() as well in order to prevent a stale value when using getOrthoProjection()
 		this->orthoProjection = rect;
@@ -234,6 +275,7 @@ namespace april
 
 	void RenderSystem::setOrthoProjection(grect rect, float nearZ, float farZ)
 	{
+		this->flush();
 		// TODOaa - change and improve this implementation
 		// also: this variable needs to be updated in ::setProjectionMatrix() as well in order to prevent a stale value when using getOrthoProjection()
 		this->orthoProjection = rect;
@@ -254,12 +296,20 @@ namespace april
 
 	void RenderSystem::setModelviewMatrix(gmat4 matrix)
 	{
+		if (this->modelviewMatrix != matrix)
+		{
+			this->flush();
+		}
 		this->modelviewMatrix = matrix;
 		this->_setModelviewMatrix(this->modelviewMatrix);
 	}
 	
 	void RenderSystem::setProjectionMatrix(gmat4 matrix)
 	{
+		if (this->projectionMatrix != matrix)
+		{
+			this->flush();
+		}
 		this->projectionMatrix = matrix;
 		this->_setProjectionMatrix(this->projectionMatrix);
 	}
@@ -297,11 +347,44 @@ namespace april
 		return result;
 	}
 
+	int64_t RenderSystem::getBufferVRamConsumption()
+	{
+		int64_t result = 0LL;
+		foreach (VertexBuffer*, it, this->vertexBuffers)
+		{
+			result += (int64_t)(*it)->getCurrentVRamSize();
+		}
+		foreach (IndexBuffer*, it, this->indexBuffers)
+		{
+			result += (int64_t)(*it)->getCurrentVRamSize();
+		}
+		return result;
+	}
+
+	int64_t RenderSystem::getBufferRamConsumption()
+	{
+		int64_t result = 0LL;
+		foreach (VertexBuffer*, it, this->vertexBuffers)
+		{
+			result += (int64_t)(*it)->getCurrentRamSize();
+		}
+		foreach (IndexBuffer*, it, this->indexBuffers)
+		{
+			result += (int64_t)(*it)->getCurrentRamSize();
+		}
+		return result;
+	}
+
 	bool RenderSystem::hasAsyncTexturesQueued()
 	{
 		return TextureAsync::isRunning();
 	}
 
+	hmap<int, int> RenderSystem::getAsyncTexturesQueuedCounts()
+	{
+		return TextureAsync::getQueuedCounts();
+	}
+
 	Texture* RenderSystem::getRenderTarget()
 	{
 		hlog::warnf(logTag, "Render targets are not implemented in render system '%s'!", this->name.cStr());
@@ -310,6 +393,7 @@ namespace april
 
 	void RenderSystem::setRenderTarget(Texture* texture)
 	{
+		this->flush();
 		hlog::warnf(logTag, "Render targets are not implemented in render system '%s'!", this->name.cStr());
 	}
 
@@ -347,15 +431,18 @@ namespace april
 		return NULL;
 	}
 
-	void RenderSystem::waitForAsyncTextures(float timeout)
+	bool RenderSystem::waitForAsyncTextures(float timeout)
+	{
+		return TextureAsync::waitForLoads(harray<Texture*>(), timeout);
+	}
+
+	bool RenderSystem::waitForAsyncTextures(harray<Texture*> textures, float timeout)
 	{
-		float time = timeout;
-		while ((time > 0.0f || timeout <= 0.0f) && this->hasAsyncTexturesQueued())
+		if (textures.size() == 0)
 		{
-			hthread::sleep(0.1f);
-			time -= 0.0001f;
-			TextureAsync::update();
+			return true;
 		}
+		return TextureAsync::waitForLoads(textures, timeout);
 	}
 
 	Texture* RenderSystem::createTextureFromResource(chstr filename, Texture::Type type, Texture::LoadMode loadMode)
@@ -368,6 +455,11 @@ namespace april
 		return this->_createTextureFromSource(true, filename, type, loadMode, format);
 	}
 
+	Texture* RenderSystem::createTextureFromResource(chstr filename, int maxWidth, int maxHeight, Texture::Type type, Texture::LoadMode loadMode)
+	{
+		return this->_createTextureFromSource(true, filename, type, loadMode, Image::FORMAT_INVALID, maxWidth, maxHeight);
+	}
+
 	Texture* RenderSystem::createTextureFromFile(chstr filename, Texture::Type type, Texture::LoadMode loadMode)
 	{
 		return this->_createTextureFromSource(false, filename, type, loadMode);
@@ -378,7 +470,12 @@ namespace april
 		return this->_createTextureFromSource(false, filename, type, loadMode, format);
 	}
 
-	Texture* RenderSystem::_createTextureFromSource(bool fromResource, chstr filename, Texture::Type type, Texture::LoadMode loadMode, Image::Format format)
+	Texture* RenderSystem::createTextureFromFile(chstr filename, int maxWidth, int maxHeight, Texture::Type type, Texture::LoadMode loadMode)
+	{
+		return this->_createTextureFromSource(false, filename, type, loadMode, Image::FORMAT_INVALID, maxWidth, maxHeight);
+	}
+
+	Texture* RenderSystem::_createTextureFromSource(bool fromResource, chstr filename, Texture::Type type, Texture::LoadMode loadMode, Image::Format format, int maxWidth, int maxHeight)
 	{
 		if (format != Image::FORMAT_INVALID && !this->getCaps().textureFormats.has(format))
 		{
@@ -394,6 +491,8 @@ namespace april
 		bool result = (format == Image::FORMAT_INVALID ? texture->_create(name, type, loadMode) : texture->_create(name, format, type, loadMode));
 		if (result)
 		{
+			texture->maxWidth = maxWidth;
+			texture->maxHeight = maxHeight;
 			if (loadMode == Texture::LOAD_IMMEDIATE)
 			{
 				result = texture->load();
@@ -433,8 +532,71 @@ namespace april
 		return texture;
 	}
 
+	VertexBuffer* RenderSystem::createVertexBuffer(PlainVertex* v, int nVertices, BufferUsage usage)
+	{
+		return this->_createVertexBufferFromData(VertexBuffer::FORMAT_PLAIN, v, nVertices, usage);
+	}
+
+	VertexBuffer* RenderSystem::createVertexBuffer(TexturedVertex* v, int nVertices, BufferUsage usage)
+	{
+		return this->_createVertexBufferFromData(VertexBuffer::FORMAT_TEXTURED, v, nVertices, usage);
+	}
+
+	VertexBuffer* RenderSystem::createVertexBuffer(ColoredVertex* v, int nVertices, BufferUsage usage)
+	{
+		return this->_createVertexBufferFromData(VertexBuffer::FORMAT_COLORED, v, nVertices, usage);
+	}
+
+	VertexBuffer* RenderSystem::createVertexBuffer(ColoredTexturedVertex* v, int nVertices, BufferUsage usage)
+	{
+		return this->_createVertexBufferFromData(VertexBuffer::FORMAT_COLORED_TEXTURED, v, nVertices, usage);
+	}
+
+	VertexBuffer* RenderSystem::_createVertexBufferFromData(VertexBuffer::Format format, const void* v, int nVertices, BufferUsage usage)
+	{
+		VertexBuffer* vertexBuffer = this->_createVertexBuffer();
+		if (!vertexBuffer->_create(format, v, nVertices, usage))
+		{
+			delete vertexBuffer;
+			vertexBuffer = NULL;
+		}
+		return vertexBuffer;
+	}
+
+	VertexBuffer* RenderSystem::_createVertexBuffer()
+	{
+		return new VertexBuffer();
+	}
+
+	IndexBuffer* RenderSystem::createIndexBuffer(unsigned short* indices, int nIndices, BufferUsage usage)
+	{
+		return this->_createIndexBufferFromData(IndexBuffer::FORMAT_16_BIT, indices, nIndices, usage);
+	}
+
+	IndexBuffer* RenderSystem::createIndexBuffer(unsigned int* indices, int nIndices, BufferUsage usage)
+	{
+		return this->_createIndexBufferFromData(IndexBuffer::FORMAT_32_BIT, indices, nIndices, usage);
+	}
+
+	IndexBuffer* RenderSystem::_createIndexBufferFromData(IndexBuffer::Format format, const void* indices, int nIndices, BufferUsage usage)
+	{
+		IndexBuffer* indexBuffer = this->_createIndexBuffer();
+		if (!indexBuffer->_create(format, indices, nIndices, usage))
+		{
+			delete indexBuffer;
+			indexBuffer = NULL;
+		}
+		return indexBuffer;
+	}
+
+	IndexBuffer* RenderSystem::_createIndexBuffer()
+	{
+		return new IndexBuffer();
+	}
+
 	void RenderSystem::unloadTextures()
 	{
+		this->flush(); // batched quads still use the textures
 		harray<Texture*> textures = this->getTextures();
 		foreach (Texture*, it, textures)
 		{
@@ -442,48 +604,187 @@ namespace april
 		}
 	}
 	
+	void RenderSystem::unloadBuffers()
+	{
+		foreach (VertexBuffer*, it, this->vertexBuffers)
+		{
+			(*it)->_unload();
+		}
+		foreach (IndexBuffer*, it, this->indexBuffers)
+		{
+			(*it)->_unload();
+		}
+	}
+	
 	void RenderSystem::setIdentityTransform()
 	{
+		this->flush();
 		this->modelviewMatrix.setIdentity();
 		this->_setModelviewMatrix(this->modelviewMatrix);
 	}
 	
 	void RenderSystem::translate(float x, float y, float z)
 	{
+		this->flush();
 		this->modelviewMatrix.translate(x, y, z);
 		this->_setModelviewMatrix(this->modelviewMatrix);
 	}
 	
 	void RenderSystem::rotate(float angle, float ax, float ay, float az)
 	{
+		this->flush();
 		this->modelviewMatrix.rotate(ax, ay, az, angle);
 		this->_setModelviewMatrix(this->modelviewMatrix);
 	}	
 	
 	void RenderSystem::scale(float s)
 	{
+		this->flush();
 		this->modelviewMatrix.scale(s);
 		this->_setModelviewMatrix(this->modelviewMatrix);
 	}
 	
 	void RenderSystem::scale(float sx, float sy, float sz)
 	{
+		this->flush();
 		this->modelviewMatrix.scale(sx, sy, sz);
 		this->_setModelviewMatrix(this->modelviewMatrix);
 	}
 	
 	void RenderSystem::lookAt(const gvec3& eye, const gvec3& target, const gvec3& up)
 	{
+		this->flush();
 		this->modelviewMatrix.lookAt(eye, target, up);
 		this->_setModelviewMatrix(this->modelviewMatrix);
 	}
 		
 	void RenderSystem::setPerspective(float fov, float aspect, float nearClip, float farClip)
 	{
+		this->flush();
 		this->projectionMatrix.setPerspective(fov, aspect, nearClip, farClip);
 		this->_setProjectionMatrix(this->projectionMatrix);
 	}
 	
+	void RenderSystem::render(RenderOperation renderOperation, VertexBuffer* vertexBuffer, int start, int nVertices, Color color)
+	{
+		if (start < 0 || nVertices < 0 || start + nVertices > vertexBuffer->count)
+		{
+			hlog::errorf(logTag, "Cannot render vertex buffer, range %d+%d is outside of %d vertices!", start, nVertices, vertexBuffer->count);
+			return;
+		}
+		this->_renderBufferData(renderOperation, vertexBuffer->format, &vertexBuffer->data[start * vertexBuffer->getStride()], nVertices, color);
+	}
+
+	void RenderSystem::render(RenderOperation renderOperation, VertexBuffer* vertexBuffer, IndexBuffer* indexBuffer, int start, int nIndices, Color color)
+	{
+		if (start < 0 || nIndices < 0 || start + nIndices > indexBuffer->count)
+		{
+			hlog::errorf(logTag, "Cannot render index buffer, range %d+%d is outside of %d indices!", start, nIndices, indexBuffer->count);
+			return;
+		}
+		this->_renderIndexed(renderOperation, vertexBuffer->format, vertexBuffer->data, vertexBuffer->count, &indexBuffer->data[start * indexBuffer->getStride()], indexBuffer->format, nIndices, color);
+	}
+
+	void RenderSystem::render(RenderOperation renderOperation, PlainVertex* v, int nVertices, unsigned short* indices, int nIndices)
+	{
+		this->_renderIndexed(renderOperation, VertexBuffer::FORMAT_PLAIN, (unsigned char*)v, nVertices, indices, IndexBuffer::FORMAT_16_BIT, nIndices, Color::White);
+	}
+
+	void RenderSystem::render(RenderOperation renderOperation, PlainVertex* v, int nVertices, unsigned short* indices, int nIndices, Color color)
+	{
+		this->_renderIndexed(renderOperation, VertexBuffer::FORMAT_PLAIN, (unsigned char*)v, nVertices, indices, IndexBuffer::FORMAT_16_BIT, nIndices, color);
+	}
+
+	void RenderSystem::render(RenderOperation renderOperation, TexturedVertex* v, int nVertices, unsigned short* indices, int nIndices)
+	{
+		this->_renderIndexed(renderOperation, VertexBuffer::FORMAT_TEXTURED, (unsigned char*)v, nVertices, indices, IndexBuffer::FORMAT_16_BIT, nIndices, Color::White);
+	}
+
+	void RenderSystem::render(RenderOperation renderOperation, TexturedVertex* v, int nVertices, unsigned short* indices, int nIndices, Color color)
+	{
+		this->_renderIndexed(renderOperation, VertexBuffer::FORMAT_TEXTURED, (unsigned char*)v, nVertices, indices, IndexBuffer::FORMAT_16_BIT, nIndices, color);
+	}
+
+	void RenderSystem::render(RenderOperation renderOperation, ColoredVertex* v, int nVertices, unsigned short* indices, int nIndices)
+	{
+		this->_renderIndexed(renderOperation, VertexBuffer::FORMAT_COLORED, (unsigned char*)v, nVertices, indices, IndexBuffer::FORMAT_16_BIT, nIndices, Color::White);
+	}
+
+	void RenderSystem::render(RenderOperation renderOperation, ColoredTexturedVertex* v, int nVertices, unsigned short* indices, int nIndices)
+	{
+		this->_renderIndexed(renderOperation, VertexBuffer::FORMAT_COLORED_TEXTURED, (unsigned char*)v, nVertices, indices, IndexBuffer::FORMAT_16_BIT, nIndices, Color::White);
+	}
+
+	void RenderSystem::render(RenderOperation renderOperation, PlainVertex* v, int nVertices, unsigned int* indices, int nIndices)
+	{
+		this->_renderIndexed(renderOperation, VertexBuffer::FORMAT_PLAIN, (unsigned char*)v, nVertices, indices, IndexBuffer::FORMAT_32_BIT, nIndices, Color::White);
+	}
+
+	void RenderSystem::render(RenderOperation renderOperation, PlainVertex* v, int nVertices, unsigned int* indices, int nIndices, Color color)
+	{
+		this->_renderIndexed(renderOperation, VertexBuffer::FORMAT_PLAIN, (unsigned char*)v, nVertices, indices, IndexBuffer::FORMAT_32_BIT, nIndices, color);
+	}
+
+	void RenderSystem::render(RenderOperation renderOperation, TexturedVertex* v, int nVertices, unsigned int* indices, int nIndices)
+	{
+		this->_renderIndexed(renderOperation, VertexBuffer::FORMAT_TEXTURED, (unsigned char*)v, nVertices, indices, IndexBuffer::FORMAT_32_BIT, nIndices, Color::White);
+	}
+
+	void RenderSystem::render(RenderOperation renderOperation, TexturedVertex* v, int nVertices, unsigned int* indices, int nIndices, Color color)
+	{
+		this->_renderIndexed(renderOperation, VertexBuffer::FORMAT_TEXTURED, (unsigned char*)v, nVertices, indices, IndexBuffer::FORMAT_32_BIT, nIndices, color);
+	}
+
+	void RenderSystem::render(RenderOperation renderOperation, ColoredVertex* v, int nVertices, unsigned int* indices, int nIndices)
+	{
+		this->_renderIndexed(renderOperation, VertexBuffer::FORMAT_COLORED, (unsigned char*)v, nVertices, indices, IndexBuffer::FORMAT_32_BIT, nIndices, Color::White);
+	}
+
+	void RenderSystem::render(RenderOperation renderOperation, ColoredTexturedVertex* v, int nVertices, unsigned int* indices, int nIndices)
+	{
+		this->_renderIndexed(renderOperation, VertexBuffer::FORMAT_COLORED_TEXTURED, (unsigned char*)v, nVertices, indices, IndexBuffer::FORMAT_32_BIT, nIndices, Color::White);
+	}
+
+	void RenderSystem::_renderIndexed(RenderOperation renderOperation, VertexBuffer::Format format, unsigned char* v, int nVertices, const void* indices, IndexBuffer::Format indexFormat, int nIndices, Color color)
+	{
+		// the indexed vertices are gathered and rendered with the regular render() functions
+		int stride = VertexBuffer::getFormatStride(format);
+		unsigned char* data = new unsigned char[hmax(nIndices, 1) * stride];
+		unsigned int index = 0;
+		for_iter (i, 0, nIndices)
+		{
+			index = (indexFormat == IndexBuffer::FORMAT_32_BIT ? ((const unsigned int*)indices)[i] : ((const unsigned short*)indices)[i]);
+			if (index >= (unsigned int)nVertices)
+			{
+				hlog::errorf(logTag, "Cannot render indexed vertices, index %u is outside of %d vertices!", index, nVertices);
+				delete[] data;
+				return;
+			}
+			memcpy(&data[i * stride], &v[index * stride], stride);
+		}
+		this->_renderBufferData(renderOperation, format, data, nIndices, color);
+		delete[] data;
+	}
+
+	void RenderSystem::_renderBufferData(RenderOperation renderOperation, VertexBuffer::Format format, unsigned char* data, int nVertices, Color color)
+	{
+		switch (format)
+		{
+		case VertexBuffer::FORMAT_PLAIN:
+			this->render(renderOperation, (PlainVertex*)data, nVertices, color);
+			break;
+		case VertexBuffer::FORMAT_TEXTURED:
+			this->render(renderOperation, (TexturedVertex*)data, nVertices, color);
+			break;
+		case VertexBuffer::FORMAT_COLORED:
+			this->render(renderOperation, (ColoredVertex*)data, nVertices);
+			break;
+		case VertexBuffer::FORMAT_COLORED_TEXTURED:
+			this->render(renderOperation, (ColoredTexturedVertex*)data, nVertices);
+			break;
+		}
+	}
+
 	void RenderSystem::drawRect(grect rect, Color color)
 	{
 		pv[0].x = rect.x;			pv[0].y = rect.y;			pv[0].z = 0.0f;
@@ -505,6 +806,11 @@ namespace april
 	
 	void RenderSystem::drawTexturedRect(grect rect, grect src)
 	{
+		if (this->batching)
+		{
+			this->_addBatchQuad(rect, src, Color::White);
+			return;
+		}
 		tv[0].x = rect.x;			tv[0].y = rect.y;			tv[0].z = 0.0f;	tv[0].u = src.x;			tv[0].v = src.y;
 		tv[1].x = rect.x + rect.w;	tv[1].y = rect.y;			tv[1].z = 0.0f;	tv[1].u = src.x + src.w;	tv[1].v = src.y;
 		tv[2].x = rect.x;			tv[2].y = rect.y + rect.h;	tv[2].z = 0.0f;	tv[2].u = src.x;			tv[2].v = src.y + src.h;
@@ -514,6 +820,11 @@ namespace april
 	
 	void RenderSystem::drawTexturedRect(grect rect, grect src, Color color)
 	{
+		if (this->batching)
+		{
+			this->_addBatchQuad(rect, src, color);
+			return;
+		}
 		tv[0].x = rect.x;			tv[0].y = rect.y;			tv[0].z = 0.0f;	tv[0].u = src.x;			tv[0].v = src.y;
 		tv[1].x = rect.x + rect.w;	tv[1].y = rect.y;			tv[1].z = 0.0f;	tv[1].u = src.x + src.w;	tv[1].v = src.y;
 		tv[2].x = rect.x;			tv[2].y = rect.y + rect.h;	tv[2].z = 0.0f;	tv[2].u = src.x;			tv[2].v = src.y + src.h;
@@ -521,8 +832,124 @@ namespace april
 		this->render(RO_TRIANGLE_STRIP, tv, 4, color);
 	}
 	
+	void RenderSystem::setBatching(bool value)
+	{
+		if (value && !this->_isBatchingSupported())
+		{
+			hlog::warnf(logTag, "Batching is not implemented in render system '%s'!", this->name.cStr());
+			return;
+		}
+		if (!value)
+		{
+			this->flush();
+		}
+		this->batching = value;
+	}
+
+	bool RenderSystem::_isBatchingSupported()
+	{
+		return false;
+	}
+
+	void RenderSystem::_addBatchQuad(grect rect, grect src, Color color)
+	{
+		// the color is applied to all vertices of a draw call so it's part of the render state
+		if (this->batchVertexCount > 0 && this->batchColor != color)
+		{
+			this->flush();
+		}
+		this->batchColor = color;
+		if (this->batchVertexCount + 4 > APRIL_BATCH_MAX_VERTICES)
+		{
+			this->flush();
+		}
+		if (this->batchVertexCount + 4 > this->batchVertexCapacity)
+		{
+			this->batchVertexCapacity = hmin(hmax(this->batchVertexCapacity * 2, 4 * APRIL_BATCH_QUADS), APRIL_BATCH_MAX_VERTICES);
+			TexturedVertex* vertices = new TexturedVertex[this->batchVertexCapacity];
+			if (this->batchVertices != NULL)
+			{
+				memcpy(vertices, this->batchVertices, this->batchVertexCount * sizeof(TexturedVertex));
+				delete[] this->batchVertices;
+			}
+			this->batchVertices = vertices;
+		}
+		// strips can't be joined so each quad is rendered as two indexed triangles
+		TexturedVertex* v = &this->batchVertices[this->batchVertexCount];
+		v[0].x = rect.x;			v[0].y = rect.y;			v[0].z = 0.0f;	v[0].u = src.x;				v[0].v = src.y;
+		v[1].x = rect.x + rect.w;	v[1].y = rect.y;			v[1].z = 0.0f;	v[1].u = src.x + src.w;		v[1].v = src.y;
+		v[2].x = rect.x;			v[2].y = rect.y + rect.h;	v[2].z = 0.0f;	v[2].u = src.x;				v[2].v = src.y + src.h;
+		v[3].x = rect.x + rect.w;	v[3].y = rect.y + rect.h;	v[3].z = 0.0f;	v[3].u = src.x + src.w;		v[3].v = src.y + src.h;
+		this->batchVertexCount += 4;
+		++this->drawCalls;
+	}
+
+	void RenderSystem::flush()
+	{
+		if (this->batchVertexCount == 0 || this->batchFlushing)
+		{
+			return;
+		}
+		this->batchFlushing = true;
+		int quads = this->batchVertexCount / 4;
+		this->render(RO_TRIANGLE_LIST, this->batchVertices, this->batchVertexCount, this->_getQuadIndices(quads), quads * 6, this->batchColor);
+		this->batchVertexCount = 0;
+		this->batchFlushing = false;
+	}
+
+	unsigned short* RenderSystem::_getQuadIndices(int nQuads)
+	{
+		if (nQuads > this->quadIndicesCapacity)
+		{
+			int capacity = hmax(nQuads, hmin(hmax(this->quadIndicesCapacity * 2, APRIL_BATCH_QUADS), APRIL_BATCH_MAX_VERTICES / 4));
+			unsigned short* indices = new unsigned short[capacity * 6];
+			if (this->quadIndices != NULL)
+			{
+				memcpy(indices, this->quadIndices, this->quadIndicesCapacity * 6 * sizeof(unsigned short));
+				delete[] this->quadIndices;
+			}
+			// same winding as a triangle strip of the 4 vertices
+			unsigned short* index = &indices[this->quadIndicesCapacity * 6];
+			unsigned short vertex = 0;
+			for_iter (i, this->quadIndicesCapacity, capacity)
+			{
+				vertex = (unsigned short)(i * 4);
+				index[0] = vertex;
+				index[1] = vertex + 1;
+				index[2] = vertex + 2;
+				index[3] = vertex + 1;
+				index[4] = vertex + 3;
+				index[5] = vertex + 2;
+				index += 6;
+			}
+			this->quadIndices = indices;
+			this->quadIndicesCapacity = capacity;
+		}
+		return this->quadIndices;
+	}
+
+	void RenderSystem::_prepareDrawCall()
+	{
+		if (!this->batchFlushing)
+		{
+			this->flush();
+			++this->drawCalls;
+		}
+		++this->issuedDrawCalls;
+	}
+
+	void RenderSystem::_finishFrameDrawCalls()
+	{
+		this->lastFrameDrawCalls = this->drawCalls;
+		this->lastFrameIssuedDrawCalls = this->issuedDrawCalls;
+		this->drawCalls = 0;
+		this->issuedDrawCalls = 0;
+	}
+
 	void RenderSystem::presentFrame()
 	{
+		this->flush();
+		this->_finishFrameDrawCalls();
 		april::window->presentFrame();
 	}
 	
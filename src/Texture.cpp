@@ -7,6 +7,7 @@
 /// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
 
 #include <hltypes/harray.h>
+#include <hltypes/hdir.h>
 #include <hltypes/hfile.h>
 #include <hltypes/hlog.h>
 #include <hltypes/hltypesUtil.h>
@@ -15,6 +16,7 @@
 
 #include "april.h"
 #include "Color.h"
+#include "FileBuffer.h"
 #include "Image.h"
 #include "Texture.h"
 #include "TextureAsync.h"
@@ -22,6 +24,7 @@
 
 #define HROUND_GRECT(rect) hround(rect.x), hround(rect.y), hround(rect.w), hround(rect.h)
 #define HROUND_GVEC2(vec2) hround(vec2.x), hround(vec2.y)
+#define MAX_DIRTY_RECTS 8
 
 namespace april
 {
@@ -104,14 +107,23 @@ namespace april
 		this->effectiveWidth = 1.0f; // used only with software NPOT textures
 		this->effectiveHeight = 1.0f; // used only with software NPOT textures
 		this->compressedSize = 0; // used in compressed textures only
+		this->maxWidth = 0;
+		this->maxHeight = 0;
 		this->filter = FILTER_LINEAR;
 		this->addressMode = ADDRESS_CLAMP;
 		this->locked = false;
 		this->dirty = false;
+		this->uploadedBytes = 0;
+		this->savedUploadBytes = 0;
 		this->data = NULL;
 		this->dataAsync = NULL;
 		this->asyncLoadQueued = false;
 		this->asyncLoadDiscarded = false;
+		this->asyncQueueIndex = -1;
+		this->asyncLoadCallback = NULL;
+		this->asyncUploadRows = 0;
+		this->asyncReadTime = 0.0f;
+		this->asyncDecodeTime = 0.0f;
 		this->fromResource = fromResource;
 		this->firstUpload = true;
 		hmutex::ScopeLock lock(&april::rendersys->texturesMutex);
@@ -252,6 +264,7 @@ namespace april
 			hlog::error(logTag, "Texture implementation does not call unload() in destructor! This cause problems and memory leaks!");
 		}
 		this->waitForAsyncLoad(); // waiting for all async stuff to finish
+		TextureAsync::removeTexture(this);
 		hmutex::ScopeLock lock(&april::rendersys->texturesMutex);
 		april::rendersys->textures -= this;
 		lock.release();
@@ -398,6 +411,18 @@ namespace april
 		return result;
 	}
 
+	Image::DecodeOptions Texture::_getDecodeOptions()
+	{
+		Image::DecodeOptions options(this->format, this->maxWidth, this->maxHeight);
+		// the native layout matching the file's channels is decoded directly, but only if the data isn't kept in RAM where the smaller original format is preferred
+		if (this->format == Image::FORMAT_INVALID && (this->type == TYPE_VOLATILE || this->type == TYPE_IMMUTABLE))
+		{
+			options.rgbFormat = april::rendersys->getNativeTextureFormat(Image::FORMAT_RGB);
+			options.rgbaFormat = april::rendersys->getNativeTextureFormat(Image::FORMAT_RGBA);
+		}
+		return options;
+	}
+
 	bool Texture::load()
 	{
 		hmutex::ScopeLock lock(&this->asyncLoadMutex);
@@ -406,6 +431,12 @@ namespace april
 			return true;
 		}
 		this->asyncLoadDiscarded = false; // a possible previous unload call must be canceled
+		if (this->asyncUploadRows > 0) // the texture is needed now so the remaining slices are uploaded right away
+		{
+			lock.release();
+			this->_uploadAsyncSlice(0LL);
+			return this->isLoaded();
+		}
 		if (this->asyncLoadQueued)
 		{
 			lock.release();
@@ -439,15 +470,8 @@ namespace april
 				hlog::error(logTag, "No filename for texture specified!");
 				return false;
 			}
-			Image* image = NULL;
-			if (this->format == Image::FORMAT_INVALID)
-			{
-				image = (this->fromResource ? Image::createFromResource(this->filename) : Image::createFromFile(this->filename));
-			}
-			else
-			{
-				image = (this->fromResource ? Image::createFromResource(this->filename, this->format) : Image::createFromFile(this->filename, this->format));
-			}
+			Image::DecodeOptions options = this->_getDecodeOptions();
+			Image* image = (this->fromResource ? Image::createFromResource(this->filename, options) : Image::createFromFile(this->filename, options));
 			if (image == NULL)
 			{
 				hlog::error(logTag, "Failed to load texture: " + this->_getInternalName());
@@ -489,32 +513,37 @@ namespace april
 				this->write(0, 0, this->width, this->height, 0, 0, currentData, this->width, this->height, format);
 				this->type = type;
 			}
-			if (this->type != TYPE_VOLATILE && this->type != TYPE_RENDER_TARGET && (this->type != TYPE_IMMUTABLE || this->filename == ""))
+			this->_keepUploadedData(currentData);
+		}
+		else if (this->type == TYPE_VOLATILE) // when recreating a texture, it is important that it is created empty to avoid problems (e.g. DX9 creates a white initial texture)
+		{
+			this->clear();
+		}
+		return true;
+	}
+
+	void Texture::_keepUploadedData(unsigned char* currentData)
+	{
+		if (this->type != TYPE_VOLATILE && this->type != TYPE_RENDER_TARGET && (this->type != TYPE_IMMUTABLE || this->filename == ""))
+		{
+			if (this->data != currentData)
 			{
-				if (this->data != currentData)
+				if (this->data != NULL)
 				{
-					if (this->data != NULL)
-					{
-						delete[] this->data;
-					}
-					this->data = currentData;
+					delete[] this->data;
 				}
-			}
-			else
-			{
-				delete[] currentData;
-				// the used format will be the native format, because there is no intermediate data
-				this->format = april::rendersys->getNativeTextureFormat(this->format);
+				this->data = currentData;
 			}
 		}
-		else if (this->type == TYPE_VOLATILE) // when recreating a texture, it is important that it is created empty to avoid problems (e.g. DX9 creates a white initial texture)
+		else
 		{
-			this->clear();
+			delete[] currentData;
+			// the used format will be the native format, because there is no intermediate data
+			this->format = april::rendersys->getNativeTextureFormat(this->format);
 		}
-		return true;
 	}
 
-	bool Texture::loadAsync()
+	bool Texture::loadAsync(int priority, float deadline)
 	{
 		this->unlock();
 		hmutex::ScopeLock lock(&this->asyncLoadMutex);
@@ -556,11 +585,16 @@ namespace april
 		this->asyncLoadDiscarded = false;
 		if (!this->asyncLoadQueued) // this check is down here to allow the upper error messages to be displayed
 		{
-			this->asyncLoadQueued = TextureAsync::queueLoad(this);
+			this->asyncLoadQueued = TextureAsync::queueLoad(this, priority, deadline);
 		}
 		return this->asyncLoadQueued;
 	}
 
+	bool Texture::setAsyncLoadPriority(int priority, float deadline)
+	{
+		return TextureAsync::setLoadPriority(this, priority, deadline);
+	}
+
 	void Texture::unload()
 	{
 		if (this->_destroyInternalTexture())
@@ -578,6 +612,7 @@ namespace april
 			delete[] this->dataAsync;
 			this->dataAsync = NULL;
 		}
+		this->asyncUploadRows = 0;
 		this->firstUpload = true;
 		lock.release();
 		this->unlock();
@@ -613,31 +648,38 @@ namespace april
 			{
 				this->compressedSize = image->compressedSize;
 			}
+			else if (this->maxWidth > 0 || this->maxHeight > 0)
+			{
+				Image::getReducedSize(image->w, image->h, this->maxWidth, this->maxHeight, this->width, this->height);
+			}
 			delete image;
 		}
 		return true;
 	}
 
-	void Texture::waitForAsyncLoad(float timeout)
+	bool Texture::waitForAsyncLoad(float timeout)
+	{
+		harray<Texture*> textures;
+		textures += this;
+		return TextureAsync::waitForLoads(textures, timeout);
+	}
+
+	hstr Texture::_getMappableFilename()
 	{
-		TextureAsync::prioritizeLoad(this);
-		float time = timeout;
-		hmutex::ScopeLock lock;
-		while (time > 0.0f || timeout <= 0.0f)
+		if (!this->fromResource)
 		{
-			lock.acquire(&this->asyncLoadMutex);
-			if (!this->asyncLoadQueued)
-			{
-				break;
-			}
-			lock.release();
-			hthread::sleep(0.1f);
-			time -= 0.0001f;
-			TextureAsync::update();
+			return this->filename;
+		}
+		// resources can be accessed directly only if they are not packed in an archive
+		if (hresource::hasZip())
+		{
+			return "";
 		}
+		hstr archive = hresource::getArchive();
+		return (archive != "" ? hdir::joinPath(archive, this->filename) : this->filename);
 	}
 
-	hstream* Texture::_prepareAsyncStream()
+	FileBuffer* Texture::_prepareAsyncBuffer()
 	{
 		hmutex::ScopeLock lock(&this->asyncLoadMutex);
 		if (!this->asyncLoadQueued || this->asyncLoadDiscarded)
@@ -647,32 +689,44 @@ namespace april
 			return NULL;
 		}
 		lock.release();
-		hstream* stream = new hstream();
-		if (this->fromResource)
+		int64_t time = htickCount();
+		FileBuffer* buffer = new FileBuffer();
+		bool success = true;
+		hstr mappableFilename = this->_getMappableFilename();
+		if (mappableFilename != "" && buffer->map(mappableFilename))
+		{
+			// the pages are read here so the decoder doesn't stall on I/O later
+			buffer->fetch();
+		}
+		else if (this->fromResource)
 		{
 			hresource file;
 			file.open(this->filename);
-			stream->writeRaw(file);
+			success = buffer->read(file);
 		}
 		else
 		{
 			hfile file;
 			file.open(this->filename);
-			stream->writeRaw(file);
+			success = buffer->read(file);
+		}
+		this->asyncReadTime = (float)(htickCount() - time);
+		if (!success)
+		{
+			hlog::error(logTag, "Failed to read async texture: " + this->_getInternalName());
 		}
-		stream->rewind();
 		lock.acquire(&this->asyncLoadMutex);
-		if (!this->asyncLoadQueued || this->asyncLoadDiscarded)
+		if (!success || !this->asyncLoadQueued || this->asyncLoadDiscarded)
 		{
 			this->asyncLoadQueued = false;
 			this->asyncLoadDiscarded = false;
-			delete stream;
+			delete buffer;
 			return NULL;
 		}
-		return stream;
+		return buffer;
 	}
 
-	void Texture::_decodeFromAsyncStream(hstream* stream)
+	void Texture::_decodeFromAsyncBuffer(FileBuffer* buffer)
 	{
 		hmutex::ScopeLock lock(&this->asyncLoadMutex);
 		if (!this->asyncLoadQueued || this->asyncLoadDiscarded || this->dataAsync != NULL || this->loaded)
@@ -683,15 +737,12 @@ namespace april
 		}
 		lock.release();
 		hlog::write(logTag, "Loading async texture: " + this->_getInternalName());
-		Image* image = NULL;
-		if (this->format == Image::FORMAT_INVALID)
-		{
-			image = Image::createFromStream(*(hsbase*)stream, "." + hfile::extensionOf(this->filename));
-		}
-		else
-		{
-			image = Image::createFromStream(*(hsbase*)stream, "." + hfile::extensionOf(this->filename), this->format);
-		}
+		int64_t time = htickCount();
+		Image::DecodeOptions options = this->_getDecodeOptions();
+		Image* image = Image::createFromMemory(buffer->getData(), buffer->getSize(), "." + hfile::extensionOf(this->filename), options);
+		this->asyncDecodeTime = (float)(htickCount() - time);
+		// helps telling apart stalls caused by slow I/O and stalls caused by slow decoding
+		hlog::debugf(logTag, "Async texture '%s' read in %.0f ms, decoded in %.0f ms.", this->_getInternalName().cStr(), this->asyncReadTime, this->asyncDecodeTime);
 		if (image == NULL)
 		{
 			hlog::error(logTag, "Failed to load async texture: " + this->_getInternalName());
@@ -720,6 +771,77 @@ namespace april
 		delete image;
 	}
 
+	bool Texture::_isUploadSlicingSupported()
+	{
+		return false;
+	}
+
+	int64_t Texture::_uploadAsyncSlice(int64_t maxBytes)
+	{
+		hmutex::ScopeLock lock(&this->asyncLoadMutex);
+		unsigned char* currentData = this->dataAsync;
+		if (currentData == NULL || this->asyncLoadQueued || (this->loaded && this->asyncUploadRows == 0))
+		{
+			this->asyncUploadRows = 0;
+			return 0LL;
+		}
+		lock.release();
+		int64_t size = (int64_t)this->getByteSize();
+		if (this->asyncUploadRows == 0)
+		{
+			if (maxBytes <= 0LL || size <= maxBytes || this->height <= 1 || !this->_isUploadSlicingSupported())
+			{
+				return (this->load() ? size : 0LL);
+			}
+			hlog::write(logTag, "Uploading async texture in slices: " + this->_getInternalName());
+			this->_assignFormat();
+			// the texture only counts as loaded once the last slice has been uploaded
+			if (!this->_createInternalTexture(NULL, 0, this->type))
+			{
+				return 0LL;
+			}
+		}
+		int rowSize = this->width * Image::getFormatBpp(this->format);
+		int rows = this->height - this->asyncUploadRows;
+		if (maxBytes > 0LL)
+		{
+			rows = hclamp((int)(maxBytes / rowSize), 1, rows);
+		}
+		// the rows are uploaded directly since write() doesn't accept textures that aren't loaded yet
+		unsigned char* sliceData = &currentData[this->asyncUploadRows * rowSize];
+		Image::Format sliceFormat = this->format;
+		Image::Format nativeFormat = april::rendersys->getNativeTextureFormat(this->format);
+		unsigned char* convertedData = NULL;
+		if (Image::needsConversion(this->format, nativeFormat) && Image::convertToFormat(this->width, rows, sliceData, this->format, &convertedData, nativeFormat, false))
+		{
+			sliceData = convertedData;
+			sliceFormat = nativeFormat;
+		}
+		bool result = (!Image::needsConversion(sliceFormat, nativeFormat) &&
+			this->_uploadToGpu(0, 0, this->width, rows, 0, this->asyncUploadRows, sliceData, this->width, rows, sliceFormat));
+		if (convertedData != NULL)
+		{
+			delete[] convertedData;
+		}
+		if (!result)
+		{
+			hlog::error(logTag, "Failed to upload async texture slice: " + this->_getInternalName());
+			this->unload();
+			return 0LL;
+		}
+		this->asyncUploadRows += rows;
+		if (this->asyncUploadRows >= this->height)
+		{
+			this->asyncUploadRows = 0;
+			lock.acquire(&this->asyncLoadMutex);
+			this->dataAsync = NULL; // not needed anymore
+			this->loaded = true;
+			lock.release();
+			this->_keepUploadedData(currentData);
+		}
+		return (int64_t)rows * rowSize;
+	}
+
 	bool Texture::lock()
 	{
 		if (this->type != TYPE_MANAGED)
@@ -744,12 +866,35 @@ namespace april
 		this->locked = false;
 		if (this->isLoaded() && this->dirty)
 		{
-			this->_uploadDataToGpu(0, 0, this->getWidth(), this->getHeight());
+			int64_t size = (int64_t)this->width * this->height;
+			int64_t dirtySize = 0;
+			foreach (grect, it, this->dirtyRects)
+			{
+				dirtySize += hround((*it).w) * hround((*it).h);
+			}
+			if (dirtySize >= size) // overlapping regions would upload more than the whole texture
+			{
+				this->dirtyRects.clear();
+				this->dirtyRects += grect(0.0f, 0.0f, (float)this->width, (float)this->height);
+				dirtySize = size;
+			}
+			foreach (grect, it, this->dirtyRects)
+			{
+				this->_uploadDataToGpu(HROUND_GRECT((*it)));
+			}
+			this->savedUploadBytes += (size - dirtySize) * Image::getFormatBpp(this->format);
 		}
 		this->dirty = false;
+		this->dirtyRects.clear();
 		return true;
 	}
 
+	void Texture::resetUploadStatistics()
+	{
+		this->uploadedBytes = 0;
+		this->savedUploadBytes = 0;
+	}
+
 	bool Texture::clear()
 	{
 		if (this->type == TYPE_IMMUTABLE)
@@ -1389,15 +1534,86 @@ namespace april
 			else
 			{
 				this->dirty = true;
+				this->_addDirtyRect(lock.dx, lock.dy, lock.w, lock.h);
 			}
 		}
+		else if (lock.failed) // the system buffer was lost before its data could be uploaded
+		{
+			update = false;
+		}
 		return update;
 	}
 
+	static grect _uniteRects(const grect& a, const grect& b)
+	{
+		grect result;
+		result.x = hmin(a.x, b.x);
+		result.y = hmin(a.y, b.y);
+		result.w = hmax(a.x + a.w, b.x + b.w) - result.x;
+		result.h = hmax(a.y + a.h, b.y + b.h) - result.y;
+		return result;
+	}
+
+	void Texture::_addDirtyRect(int x, int y, int w, int h)
+	{
+		if (!Image::correctRect(x, y, w, h, this->width, this->height))
+		{
+			return;
+		}
+		grect rect((float)x, (float)y, (float)w, (float)h);
+		grect other;
+		grect united;
+		// absorb all regions that can be uploaded together without uploading more than separately
+		int index = 0;
+		while (index >= 0)
+		{
+			index = -1;
+			for_iter (i, 0, this->dirtyRects.size())
+			{
+				other = this->dirtyRects[i];
+				united = _uniteRects(rect, other);
+				if (united.w * united.h <= rect.w * rect.h + other.w * other.h)
+				{
+					index = i;
+					break;
+				}
+			}
+			if (index >= 0)
+			{
+				rect = united;
+				this->dirtyRects.removeAt(index);
+			}
+		}
+		// too many separate regions, the one that grows the least is merged
+		if (this->dirtyRects.size() >= MAX_DIRTY_RECTS)
+		{
+			float growth = 0.0f;
+			float minGrowth = -1.0f;
+			for_iter (i, 0, this->dirtyRects.size())
+			{
+				other = this->dirtyRects[i];
+				united = _uniteRects(rect, other);
+				growth = united.w * united.h - other.w * other.h;
+				if (minGrowth < 0.0f || growth < minGrowth)
+				{
+					minGrowth = growth;
+					index = i;
+				}
+			}
+			rect = _uniteRects(rect, this->dirtyRects.removeAt(index));
+		}
+		this->dirtyRects += rect;
+	}
+
 	bool Texture::_uploadDataToGpu(int x, int y, int w, int h)
 	{
-		if ((!Image::needsConversion(this->format, april::rendersys->getNativeTextureFormat(this->format)) &&
-			this->_uploadToGpu(x, y, w, h, x, y, this->data, this->width, this->height, this->format)) || this->locked)
+		if (!Image::needsConversion(this->format, april::rendersys->getNativeTextureFormat(this->format)) &&
+			this->_uploadToGpu(x, y, w, h, x, y, this->data, this->width, this->height, this->format))
+		{
+			this->uploadedBytes += (int64_t)w * h * Image::getFormatBpp(this->format);
+			return true;
+		}
+		if (this->locked)
 		{
 			return true;
 		}
@@ -1409,6 +1625,14 @@ namespace april
 		}
 		bool result = Image::write(x, y, w, h, lock.x, lock.y, this->data, this->width, this->height, this->format, lock.data, lock.dataWidth, lock.dataHeight, lock.format);
 		this->_unlockSystem(lock, true);
+		if (lock.failed)
+		{
+			result = false;
+		}
+		if (result)
+		{
+			this->uploadedBytes += (int64_t)w * h * Image::getFormatBpp(this->format);
+		}
 		return result;
 	}
 
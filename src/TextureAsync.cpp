@@ -6,217 +6,546 @@
 /// This program is free software; you can redistribute it and/or modify it under
 /// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
 
+#include <limits.h>
+
 #include <gtypes/Rectangle.h>
 #include <gtypes/Vector2.h>
 #include <hltypes/harray.h>
+#include <hltypes/hltypesUtil.h>
 #include <hltypes/hmap.h>
 #include <hltypes/hmutex.h>
-#include <hltypes/hstream.h>
 #include <hltypes/hstring.h>
+#include <hltypes/hthread.h>
 
 #include "april.h"
+#include "Condition.h"
+#include "FileBuffer.h"
 #include "Platform.h"
 #include "Texture.h"
 #include "TextureAsync.h"
 
 namespace april
 {
-	harray<Texture*> TextureAsync::textures;
-	harray<hstream*> TextureAsync::streams;
-	hmutex TextureAsync::queueMutex;
+	const int TextureAsync::PRIORITY_IMMEDIATE = INT_MAX;
+	const int TextureAsync::PREFETCH_COUNT = 8;
 
-	hthread TextureAsync::readerThread(&TextureAsync::_read, "APRIL async loader");
-	bool TextureAsync::readerRunning = false;
+	TextureAsync::Queue TextureAsync::textures;
+	TextureAsync::Queue TextureAsync::readTextures;
+	hmap<int, int> TextureAsync::priorityCounts;
+	int64_t TextureAsync::nextOrder = 0;
+	int TextureAsync::readingCount = 0;
+	int TextureAsync::decodingCount = 0;
+	harray<Texture*> TextureAsync::activeTextures;
+	harray<Texture*> TextureAsync::uploadTextures;
+	float TextureAsync::uploadSpeed = 0.0f;
+	harray<Texture*> TextureAsync::completedTextures;
+	Condition TextureAsync::queueCondition;
+	Condition TextureAsync::completionCondition;
 
-	harray<hthread*> TextureAsync::decoderThreads;
+	harray<hthread*> TextureAsync::workerThreads;
+	bool TextureAsync::workersRunning = true;
 
 	static int cpus = 0; // needed, because certain calls are made when fetching SystemInfo that are not allowed to be made in secondary threads on some platforms
 
-	void TextureAsync::update()
+	static int _getMaxDecoderThreads()
+	{
+		int result = april::getMaxAsyncTextureDecoderThreads();
+		return (result > 0 ? result : hmax(cpus, 1));
+	}
+
+	static int64_t _makeDeadline(float deadline)
+	{
+		return (deadline > 0.0f ? htickCount() + hmax((int64_t)deadline, (int64_t)1) : 0LL);
+	}
+
+	TextureAsync::Queue::Queue()
+	{
+	}
+
+	TextureAsync::Queue::~Queue()
 	{
-		hmutex::ScopeLock lock(&TextureAsync::queueMutex);
-		if (TextureAsync::readerRunning && !TextureAsync::readerThread.isRunning())
+	}
+
+	int TextureAsync::Queue::size()
+	{
+		return this->entries.size();
+	}
+
+	bool TextureAsync::Queue::has(Texture* texture)
+	{
+		int index = texture->asyncQueueIndex;
+		return (index >= 0 && index < this->entries.size() && this->entries[index].texture == texture);
+	}
+
+	TextureAsync::Entry& TextureAsync::Queue::get(Texture* texture)
+	{
+		return this->entries[texture->asyncQueueIndex];
+	}
+
+	TextureAsync::Entry& TextureAsync::Queue::at(int index)
+	{
+		return this->entries[index];
+	}
+
+	void TextureAsync::Queue::add(const Entry& entry)
+	{
+		this->entries += entry;
+		this->_moveUp(this->entries.size() - 1);
+	}
+
+	TextureAsync::Entry TextureAsync::Queue::removeFirst()
+	{
+		Entry result = this->entries.first();
+		Entry last = this->entries.removeLast();
+		if (this->entries.size() > 0)
 		{
-			TextureAsync::readerThread.join();
-			TextureAsync::readerRunning = false;
+			this->entries[0] = last;
+			this->_moveDown(0);
 		}
-		if (!TextureAsync::readerRunning && TextureAsync::textures.size() > 0) // new textures got queued in the meantime
+		result.texture->asyncQueueIndex = -1;
+		return result;
+	}
+
+	void TextureAsync::Queue::update(Texture* texture, int priority, int64_t deadline)
+	{
+		Entry& entry = this->entries[texture->asyncQueueIndex];
+		entry.priority = priority;
+		entry.deadline = deadline;
+		this->_moveUp(texture->asyncQueueIndex);
+		this->_moveDown(texture->asyncQueueIndex);
+	}
+
+	void TextureAsync::Queue::clear()
+	{
+		foreach (Entry, it, this->entries)
 		{
-			TextureAsync::readerRunning = true;
-			TextureAsync::readerThread.start();
+			(*it).texture->asyncQueueIndex = -1;
+			if ((*it).buffer != NULL)
+			{
+				delete (*it).buffer;
+			}
 		}
-		lock.release();
-		// upload all ready textures to the GPU
+		this->entries.clear();
+	}
+
+	bool TextureAsync::Queue::_isBefore(const Entry& a, const Entry& b)
+	{
+		if (a.priority != b.priority)
+		{
+			return (a.priority > b.priority);
+		}
+		if (a.deadline != b.deadline) // entries without a deadline come last
+		{
+			return (b.deadline == 0 || (a.deadline != 0 && a.deadline < b.deadline));
+		}
+		return (a.order < b.order);
+	}
+
+	void TextureAsync::Queue::_set(int index, const Entry& entry)
+	{
+		this->entries[index] = entry;
+		entry.texture->asyncQueueIndex = index;
+	}
+
+	void TextureAsync::Queue::_moveUp(int index)
+	{
+		Entry entry = this->entries[index];
+		int parent = 0;
+		while (index > 0)
+		{
+			parent = (index - 1) / 2;
+			if (!this->_isBefore(entry, this->entries[parent]))
+			{
+				break;
+			}
+			this->_set(index, this->entries[parent]);
+			index = parent;
+		}
+		this->_set(index, entry);
+	}
+
+	void TextureAsync::Queue::_moveDown(int index)
+	{
+		Entry entry = this->entries[index];
+		int size = this->entries.size();
+		int child = 0;
+		while (true)
+		{
+			child = index * 2 + 1;
+			if (child >= size)
+			{
+				break;
+			}
+			if (child + 1 < size && this->_isBefore(this->entries[child + 1], this->entries[child]))
+			{
+				++child;
+			}
+			if (!this->_isBefore(this->entries[child], entry))
+			{
+				break;
+			}
+			this->_set(index, this->entries[child]);
+			index = child;
+		}
+		this->_set(index, entry);
+	}
+
+	void TextureAsync::update()
+	{
+		// upload ready textures to the GPU within this frame's budget
 		int maxCount = april::getMaxAsyncTextureUploadsPerFrame();
+		int64_t maxBytes = (int64_t)april::getMaxAsyncTextureUploadBytesPerFrame();
+		float maxTime = april::getMaxAsyncTextureUploadTimePerFrame();
+		int64_t start = htickCount();
+		int64_t time = 0LL;
+		int64_t bytes = 0LL;
+		int64_t sliceBytes = 0LL;
 		int count = 0;
-		harray<Texture*> textures = april::rendersys->getTextures();
-		foreach (Texture*, it, textures)
+		Texture* texture = NULL;
+		Condition::ScopeLock lock(&TextureAsync::queueCondition);
+		while (TextureAsync::uploadTextures.size() > 0)
 		{
-			// only async on-demand textures shouldn't be loaded
-			if ((*it)->getLoadMode() != Texture::LOAD_ASYNC_ON_DEMAND && (*it)->isLoadedAsync())
+			time = htickCount() - start;
+			if ((maxCount > 0 && count >= maxCount) || (maxBytes > 0LL && bytes >= maxBytes) || (maxTime > 0.0f && time >= maxTime))
+			{
+				break;
+			}
+			sliceBytes = (maxBytes > 0LL ? maxBytes - bytes : 0LL);
+			if (maxTime > 0.0f && TextureAsync::uploadSpeed > 0.0f) // the slice has to fit into the remaining time as well
 			{
-				(*it)->load();
-				++count;
-				if (maxCount > 0 && count >= maxCount)
+				int64_t timeBytes = hmax((int64_t)((maxTime - time) * TextureAsync::uploadSpeed), (int64_t)1);
+				sliceBytes = (sliceBytes > 0LL ? hmin(sliceBytes, timeBytes) : timeBytes);
+			}
+			texture = TextureAsync::uploadTextures.first();
+			lock.release();
+			bytes += texture->_uploadAsyncSlice(sliceBytes);
+			++count;
+			lock.acquire(&TextureAsync::queueCondition);
+			// a texture stays in the list while there are slices left to upload
+			if (texture->asyncUploadRows == 0 && TextureAsync::uploadTextures.has(texture))
+			{
+				TextureAsync::uploadTextures -= texture;
+			}
+		}
+		lock.release();
+		time = htickCount() - start;
+		if (bytes > 0LL && time > 0LL)
+		{
+			float speed = (float)bytes / time;
+			TextureAsync::uploadSpeed = (TextureAsync::uploadSpeed > 0.0f ? TextureAsync::uploadSpeed * 0.75f + speed * 0.25f : speed);
+		}
+		// callbacks are taken out one by one, because a callback could destroy other completed textures
+		Texture::AsyncLoadCallback callback = NULL;
+		lock.acquire(&TextureAsync::queueCondition);
+		while (true)
+		{
+			// textures that are uploaded in slices are only completed after their last slice
+			texture = NULL;
+			foreach (Texture*, it, TextureAsync::completedTextures)
+			{
+				if ((*it)->asyncUploadRows == 0)
 				{
-					break; // only 'maxCount' textures per frame!
+					texture = (*it);
+					break;
 				}
 			}
+			if (texture == NULL)
+			{
+				break;
+			}
+			TextureAsync::completedTextures -= texture;
+			callback = texture->asyncLoadCallback;
+			lock.release();
+			if (callback != NULL)
+			{
+				(*callback)(texture);
+			}
+			lock.acquire(&TextureAsync::queueCondition);
 		}
 	}
 
-	bool TextureAsync::queueLoad(Texture* texture)
+	bool TextureAsync::queueLoad(Texture* texture, int priority, float deadline)
 	{
 		if (cpus == 0)
 		{
 			cpus = april::getSystemInfo().cpuCores;
 		}
-		hmutex::ScopeLock lock(&TextureAsync::queueMutex);
-		if (TextureAsync::textures.has(texture))
+		Condition::ScopeLock lock(&TextureAsync::queueCondition);
+		if (TextureAsync::textures.has(texture) || TextureAsync::readTextures.has(texture))
 		{
 			return false;
 		}
-		TextureAsync::textures += texture;
-		if (!TextureAsync::readerRunning)
+		Entry entry;
+		entry.texture = texture;
+		entry.buffer = NULL;
+		entry.priority = priority;
+		entry.deadline = _makeDeadline(deadline);
+		entry.order = TextureAsync::nextOrder;
+		entry.prefetched = false;
+		++TextureAsync::nextOrder;
+		TextureAsync::textures.add(entry);
+		TextureAsync::_updatePriorityCount(priority, 1);
+		// workers are kept alive, one more than decoders so reading from disk can overlap with decoding
+		TextureAsync::workersRunning = true;
+		int size = _getMaxDecoderThreads() + 1 - TextureAsync::workerThreads.size();
+		for_iter (i, 0, size)
 		{
-			TextureAsync::readerRunning = true;
-			TextureAsync::readerThread.start();
+			TextureAsync::workerThreads += new hthread(&TextureAsync::_work, "APRIL async loader");
+			TextureAsync::workerThreads.last()->start();
 		}
+		TextureAsync::queueCondition.signal();
 		return true;
 	}
 
 	bool TextureAsync::prioritizeLoad(Texture* texture)
 	{
-		hmutex::ScopeLock lock(&TextureAsync::queueMutex);
-		if (!TextureAsync::textures.has(texture))
+		return TextureAsync::setLoadPriority(texture, PRIORITY_IMMEDIATE);
+	}
+
+	bool TextureAsync::setLoadPriority(Texture* texture, int priority, float deadline)
+	{
+		Condition::ScopeLock lock(&TextureAsync::queueCondition);
+		Queue* queue = NULL;
+		if (TextureAsync::textures.has(texture))
 		{
-			return false;
+			queue = &TextureAsync::textures;
 		}
-		int index = TextureAsync::textures.indexOf(texture);
-		if (index >= TextureAsync::streams.size()) // if not loaded from disk yet
+		else if (TextureAsync::readTextures.has(texture)) // if data was already loaded in RAM, but not decoded
 		{
-			if (index > TextureAsync::streams.size()) // if not already at the front
-			{
-				TextureAsync::textures.removeAt(index);
-				TextureAsync::textures.insertAt(TextureAsync::streams.size(), texture);
-			}
+			queue = &TextureAsync::readTextures;
 		}
-		else if (index > 0) // if data was already loaded in RAM, but not decoded and not already at the front
+		else
 		{
-			TextureAsync::textures.removeAt(index);
-			TextureAsync::textures.addFirst(texture);
-			TextureAsync::streams.addFirst(TextureAsync::streams.removeAt(index));
+			return false;
 		}
+		TextureAsync::_updatePriorityCount(queue->get(texture).priority, -1);
+		TextureAsync::_updatePriorityCount(priority, 1);
+		queue->update(texture, priority, _makeDeadline(deadline));
 		return true;
 	}
 
+	hmap<int, int> TextureAsync::getQueuedCounts()
+	{
+		Condition::ScopeLock lock(&TextureAsync::queueCondition);
+		return TextureAsync::priorityCounts;
+	}
+
 	bool TextureAsync::isRunning()
 	{
-		hmutex::ScopeLock lock(&TextureAsync::queueMutex);
-		return TextureAsync::readerRunning;
+		return TextureAsync::_isLoading(harray<Texture*>());
 	}
 
-	void TextureAsync::_read(hthread* thread)
+	bool TextureAsync::waitForLoads(harray<Texture*> textures, float timeout)
 	{
-		Texture* texture = NULL;
-		hstream* stream = NULL;
-		hthread* decoderThread = NULL;
-		int index = 0;
-		int size = 0;
-		bool running = true;
-		hmutex::ScopeLock lock;
-		int maxWaitingCount = 0;
-		while (running)
+		foreach (Texture*, it, textures)
+		{
+			TextureAsync::prioritizeLoad(*it);
+		}
+		int64_t end = (timeout > 0.0f ? htickCount() + (int64_t)(timeout * 1000.0f) : 0LL);
+		int64_t remaining = 0;
+		bool loading = true;
+		bool timedOut = false;
+		Condition::ScopeLock lock;
+		while (true)
 		{
-			running = false;
-			maxWaitingCount = getMaxWaitingAsyncTextures(); // keep this value up to date in every iteration
-			// check for new queued textures
-			lock.acquire(&TextureAsync::queueMutex);
-			if (TextureAsync::textures.size() > TextureAsync::streams.size())
+			lock.acquire(&TextureAsync::completionCondition);
+			loading = TextureAsync::_isLoading(textures);
+			if (loading)
 			{
-				running = true;
-				if (maxWaitingCount <= 0 || TextureAsync::streams.size() < maxWaitingCount)
+				if (end == 0LL)
 				{
-					texture = TextureAsync::textures[TextureAsync::streams.size()];
-					lock.release();
-					stream = texture->_prepareAsyncStream();
-					lock.acquire(&TextureAsync::queueMutex);
-					index = TextureAsync::textures.indexOf(texture); // it's possible that the queue was rearranged in the meantime
-					if (stream != NULL)
-					{
-						if (index >= TextureAsync::streams.size())
-						{
-							if (index > TextureAsync::streams.size()) // if texture was moved towards the back of the queue
-							{
-								// put it back to the current decoder position
-								TextureAsync::textures.removeAt(index);
-								TextureAsync::textures.insertAt(TextureAsync::streams.size(), texture);
-							}
-							TextureAsync::streams += stream;
-						}
-						else // the texture was moved forward in the queue
-						{
-							TextureAsync::streams.insertAt(index, stream);
-						}
-					}
-					else // it was canceled
-					{
-						TextureAsync::textures.removeAt(index);
-					}
+					TextureAsync::completionCondition.wait();
 				}
 				else
 				{
-					lock.release();
-					hthread::sleep(1.0f);
-					lock.acquire(&TextureAsync::queueMutex);
+					remaining = end - htickCount();
+					timedOut = (remaining <= 0LL || !TextureAsync::completionCondition.wait((float)remaining));
 				}
+				loading = TextureAsync::_isLoading(textures);
 			}
-			size = TextureAsync::streams.size();
 			lock.release();
-			// create new worker threads if needed
-			if (size > 0)
+			TextureAsync::update(); // textures that became ready in the meantime are uploaded
+			if (!loading)
+			{
+				// the remaining slices of textures that are waited for can't be left for later frames
+				foreach (Texture*, it, textures)
+				{
+					if ((*it)->asyncUploadRows > 0)
+					{
+						(*it)->load();
+					}
+				}
+				return true;
+			}
+			if (timedOut)
+			{
+				return false;
+			}
+		}
+	}
+
+	void TextureAsync::removeTexture(Texture* texture)
+	{
+		Condition::ScopeLock lock(&TextureAsync::queueCondition);
+		if (TextureAsync::uploadTextures.has(texture))
+		{
+			TextureAsync::uploadTextures -= texture;
+		}
+		if (TextureAsync::completedTextures.has(texture))
+		{
+			TextureAsync::completedTextures -= texture;
+		}
+	}
+
+	void TextureAsync::destroy()
+	{
+		Condition::ScopeLock lock(&TextureAsync::queueCondition);
+		TextureAsync::workersRunning = false;
+		TextureAsync::queueCondition.broadcast();
+		lock.release();
+		foreach (hthread*, it, TextureAsync::workerThreads)
+		{
+			(*it)->join();
+			delete (*it);
+		}
+		lock.acquire(&TextureAsync::queueCondition);
+		TextureAsync::workerThreads.clear();
+		TextureAsync::readTextures.clear();
+		TextureAsync::textures.clear();
+		TextureAsync::priorityCounts.clear();
+		TextureAsync::uploadTextures.clear();
+		TextureAsync::completedTextures.clear();
+	}
+
+	void TextureAsync::_work(hthread* thread)
+	{
+		Entry entry;
+		bool finished = false;
+		bool ready = false;
+		int maxWaitingCount = 0;
+		harray<hstr> prefetchFilenames;
+		Condition::ScopeLock lock(&TextureAsync::queueCondition);
+		while (TextureAsync::workersRunning)
+		{
+			maxWaitingCount = april::getMaxWaitingAsyncTextures(); // keep this value up to date in every iteration
+			// decoding goes first so data read from disk doesn't pile up in RAM
+			if (TextureAsync::readTextures.size() > 0 && TextureAsync::decodingCount < _getMaxDecoderThreads())
 			{
-				running = true;
-				size = hmin(size, cpus) - TextureAsync::decoderThreads.size();
-				for_iter (i, 0, size)
+				entry = TextureAsync::readTextures.removeFirst();
+				TextureAsync::_updatePriorityCount(entry.priority, -1);
+				TextureAsync::activeTextures += entry.texture;
+				++TextureAsync::decodingCount;
+				lock.release();
+				entry.texture->_decodeFromAsyncBuffer(entry.buffer);
+				delete entry.buffer;
+				// only async on-demand textures shouldn't be uploaded right away
+				ready = (entry.texture->getLoadMode() != Texture::LOAD_ASYNC_ON_DEMAND && entry.texture->isLoadedAsync());
+				lock.acquire(&TextureAsync::queueCondition);
+				--TextureAsync::decodingCount;
+				if (ready && !TextureAsync::uploadTextures.has(entry.texture))
 				{
-					decoderThread = new hthread(&TextureAsync::_decode, "APRIL async decoder");
-					TextureAsync::decoderThreads += decoderThread;
-					decoderThread->start();
+					TextureAsync::uploadTextures += entry.texture;
 				}
+				finished = true;
 			}
-			// check current worker threads' status
-			if (TextureAsync::decoderThreads.size() > 0)
+			else if (TextureAsync::textures.size() > 0 && (maxWaitingCount <= 0 || TextureAsync::readTextures.size() + TextureAsync::readingCount < maxWaitingCount))
 			{
-				running = true;
-				for_iter (i, 0, TextureAsync::decoderThreads.size())
+				entry = TextureAsync::textures.removeFirst();
+				TextureAsync::activeTextures += entry.texture;
+				++TextureAsync::readingCount;
+				prefetchFilenames = TextureAsync::_getPrefetchFilenames();
+				lock.release();
+				// the OS can read upcoming files in the background while this one is being read
+				foreach (hstr, it, prefetchFilenames)
 				{
-					if (!TextureAsync::decoderThreads[i]->isRunning())
-					{
-						decoderThread = TextureAsync::decoderThreads.removeAt(i);
-						decoderThread->join();
-						delete decoderThread;
-						--i;
-					}
+					FileBuffer::prefetch(*it);
+				}
+				entry.buffer = entry.texture->_prepareAsyncBuffer();
+				lock.acquire(&TextureAsync::queueCondition);
+				--TextureAsync::readingCount;
+				if (entry.buffer != NULL)
+				{
+					TextureAsync::readTextures.add(entry);
+				}
+				else // it was canceled
+				{
+					TextureAsync::_updatePriorityCount(entry.priority, -1);
+					finished = true;
 				}
 			}
+			else
+			{
+				TextureAsync::queueCondition.wait();
+				continue;
+			}
+			// the texture can be destroyed as soon as it's not active anymore
+			TextureAsync::activeTextures -= entry.texture;
+			// a finished job can allow idle workers to continue (e.g. a decoder slot became available or there is new data to decode)
+			TextureAsync::queueCondition.broadcast();
+			if (finished)
+			{
+				finished = false;
+				if (entry.texture->asyncLoadCallback != NULL)
+				{
+					TextureAsync::completedTextures += entry.texture;
+				}
+				lock.release();
+				lock.acquire(&TextureAsync::completionCondition);
+				TextureAsync::completionCondition.broadcast();
+				lock.acquire(&TextureAsync::queueCondition);
+			}
 		}
 	}
 
-	void TextureAsync::_decode(hthread* thread)
+	harray<hstr> TextureAsync::_getPrefetchFilenames()
 	{
-		Texture* texture = NULL;
-		hstream* stream = NULL;
-		hmutex::ScopeLock lock(&TextureAsync::queueMutex);
-		while (TextureAsync::streams.size() > 0)
+		harray<hstr> result;
+		hstr filename;
+		int count = hmin(TextureAsync::textures.size(), TextureAsync::PREFETCH_COUNT);
+		for_iter (i, 0, count)
 		{
-			texture = TextureAsync::textures.removeFirst();
-			stream = TextureAsync::streams.removeFirst();
-			lock.release();
-			texture->_decodeFromAsyncStream(stream);
-			delete stream;
-			lock.acquire(&TextureAsync::queueMutex);
+			Entry& entry = TextureAsync::textures.at(i);
+			if (!entry.prefetched)
+			{
+				entry.prefetched = true;
+				filename = entry.texture->_getMappableFilename();
+				if (filename != "")
+				{
+					result += filename;
+				}
+			}
+		}
+		return result;
+	}
+
+	void TextureAsync::_updatePriorityCount(int priority, int amount)
+	{
+		int count = TextureAsync::priorityCounts.tryGet(priority, 0) + amount;
+		if (count > 0)
+		{
+			TextureAsync::priorityCounts[priority] = count;
+		}
+		else
+		{
+			TextureAsync::priorityCounts.removeKey(priority);
+		}
+	}
+
+	bool TextureAsync::_isLoading(harray<Texture*> textures)
+	{
+		Condition::ScopeLock lock(&TextureAsync::queueCondition);
+		if (textures.size() == 0)
+		{
+			return (TextureAsync::textures.size() > 0 || TextureAsync::readTextures.size() > 0 || TextureAsync::activeTextures.size() > 0);
+		}
+		foreach (Texture*, it, textures)
+		{
+			if (TextureAsync::textures.has(*it) || TextureAsync::readTextures.has(*it) || TextureAsync::activeTextures.has(*it))
+			{
+				return true;
+			}
 		}
+		return false;
 	}
 
 }
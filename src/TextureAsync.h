@@ -19,36 +19,120 @@
 #include <hltypes/hlist.h>
 #include <hltypes/hmap.h>
 #include <hltypes/hmutex.h>
-#include <hltypes/hstream.h>
 #include <hltypes/hthread.h>
 #include <hltypes/hstring.h>
 
 #include "aprilExport.h"
+#include "Condition.h"
 
 namespace april
 {
+	class FileBuffer;
 	class Texture;
 
 	class TextureAsync
 	{
 	public:
+		/// @brief Priority used for textures that are being waited for.
+		static const int PRIORITY_IMMEDIATE;
+
 		static void update();
-		static bool queueLoad(Texture* texture);
+		/// @param[in] texture The texture.
+		/// @param[in] priority Textures with a higher priority are loaded first.
+		/// @param[in] deadline Time in milliseconds within which the texture is needed. Among textures with the same priority, the one with the earliest deadline is loaded first. 0 means no deadline.
+		static bool queueLoad(Texture* texture, int priority = 0, float deadline = 0.0f);
 		static bool prioritizeLoad(Texture* texture);
+		/// @brief Changes the priority and deadline of a queued texture.
+		/// @return False if the texture isn't waiting in the queue (e.g. it is currently being read or decoded).
+		static bool setLoadPriority(Texture* texture, int priority, float deadline = 0.0f);
+		/// @return Number of textures waiting to be loaded for each priority.
+		static hmap<int, int> getQueuedCounts();
 		static bool isRunning();
+		/// @brief Waits until the given textures are done loading asynchronously.
+		/// @param[in] textures Textures to wait for. If empty, all queued textures are waited for.
+		/// @param[in] timeout Max time to wait in seconds. 0 means indefinitely.
+		/// @return False if the timeout was reached.
+		/// @note Textures that are ready in the meantime are uploaded to the GPU so this has to be called on the main thread.
+		static bool waitForLoads(harray<Texture*> textures, float timeout = 0.0f);
+		/// @brief Removes all references to a texture that is being destroyed.
+		static void removeTexture(Texture* texture);
+		/// @brief Stops and joins all worker threads.
+		/// @note Textures that are still queued are not loaded.
+		static void destroy();
 
 	protected:
-		static harray<Texture*> textures;
-		static harray<hstream*> streams;
-		static hmutex queueMutex;
+		struct Entry
+		{
+			Texture* texture;
+			FileBuffer* buffer;
+			int priority;
+			int64_t deadline;
+			int64_t order;
+			bool prefetched;
+		};
+
+		/// @brief Binary heap of entries that keeps each texture's position in the heap up to date.
+		/// @note Since a texture can only be in one queue at a time, the position is stored in Texture::asyncQueueIndex.
+		class Queue
+		{
+		public:
+			Queue();
+			~Queue();
+
+			int size();
+			bool has(Texture* texture);
+			Entry& get(Texture* texture);
+			/// @note Entries are in heap order so the first entries are only roughly the next ones to be removed.
+			Entry& at(int index);
+			void add(const Entry& entry);
+			Entry removeFirst();
+			void update(Texture* texture, int priority, int64_t deadline);
+			void clear();
+
+		protected:
+			harray<Entry> entries;
+
+			bool _isBefore(const Entry& a, const Entry& b);
+			void _set(int index, const Entry& entry);
+			void _moveUp(int index);
+			void _moveDown(int index);
+
+		};
+
+		/// @brief Textures that still have to be read from disk.
+		static Queue textures;
+		/// @brief Textures that were read from disk and are waiting to be decoded.
+		static Queue readTextures;
+		static hmap<int, int> priorityCounts;
+		static int64_t nextOrder;
+		static int readingCount;
+		static int decodingCount;
+		/// @brief Textures that are currently being read or decoded.
+		static harray<Texture*> activeTextures;
+		/// @brief Textures with decoded data that still has to be uploaded to the GPU.
+		static harray<Texture*> uploadTextures;
+		/// @brief Measured upload speed in bytes per millisecond.
+		static float uploadSpeed;
+		/// @brief Textures with a completion callback that still has to be called.
+		static harray<Texture*> completedTextures;
+		/// @brief Protects the queues and wakes up idle workers.
+		static Condition queueCondition;
+		/// @brief Wakes up threads waiting for textures to finish loading.
+		/// @note Locked before queueCondition when both are needed.
+		static Condition completionCondition;
 
-		static hthread readerThread;
-		static bool readerRunning;
+		/// @brief Number of queued textures the OS is asked to read ahead in the background.
+		static const int PREFETCH_COUNT;
 
-		static harray<hthread*> decoderThreads;
+		static harray<hthread*> workerThreads;
+		static bool workersRunning;
 
-		static void _read(hthread* thread);
-		static void _decode(hthread* thread);
+		static void _work(hthread* thread);
+		static void _updatePriorityCount(int priority, int amount);
+		static bool _isLoading(harray<Texture*> textures);
+		/// @brief Marks the next queued textures as prefetched.
+		/// @return Filenames of the textures that weren't prefetched yet.
+		static harray<hstr> _getPrefetchFilenames();
 
 	private: // prevents inheritance and instantiation
 		TextureAsync() { }
@@ -0,0 +1,179 @@
+/// @file
+/// @version 3.5
+/// 
+/// @section LICENSE
+/// 
+/// This program is free software; you can redistribute it and/or modify it under
+/// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
+
+#include <string.h>
+
+#include <hltypes/hlog.h>
+
+#include "april.h"
+#include "RenderSystem.h"
+#include "VertexBuffer.h"
+
+namespace april
+{
+	VertexBuffer::VertexBuffer()
+	{
+		this->format = FORMAT_PLAIN;
+		this->usage = BU_IMMUTABLE;
+		this->count = 0;
+		this->data = NULL;
+		this->vramSize = 0;
+		this->unloaded = false;
+	}
+
+	VertexBuffer::~VertexBuffer()
+	{
+		if (april::rendersys != NULL)
+		{
+			april::rendersys->vertexBuffers -= this;
+		}
+		if (this->data != NULL)
+		{
+			delete[] this->data;
+		}
+	}
+
+	int VertexBuffer::getStride()
+	{
+		return VertexBuffer::getFormatStride(this->format);
+	}
+
+	int VertexBuffer::getCurrentRamSize()
+	{
+		return this->count * this->getStride();
+	}
+
+	int VertexBuffer::getCurrentVRamSize()
+	{
+		return this->vramSize;
+	}
+
+	int VertexBuffer::getFormatStride(Format format)
+	{
+		switch (format)
+		{
+		case FORMAT_PLAIN:				return sizeof(PlainVertex);
+		case FORMAT_TEXTURED:			return sizeof(TexturedVertex);
+		case FORMAT_COLORED:			return sizeof(ColoredVertex);
+		case FORMAT_COLORED_TEXTURED:	return sizeof(ColoredTexturedVertex);
+		}
+		return 0;
+	}
+
+	bool VertexBuffer::update(PlainVertex* v, int nVertices, int offset)
+	{
+		return this->_update(FORMAT_PLAIN, v, nVertices, offset);
+	}
+
+	bool VertexBuffer::update(TexturedVertex* v, int nVertices, int offset)
+	{
+		return this->_update(FORMAT_TEXTURED, v, nVertices, offset);
+	}
+
+	bool VertexBuffer::update(ColoredVertex* v, int nVertices, int offset)
+	{
+		return this->_update(FORMAT_COLORED, v, nVertices, offset);
+	}
+
+	bool VertexBuffer::update(ColoredTexturedVertex* v, int nVertices, int offset)
+	{
+		return this->_update(FORMAT_COLORED_TEXTURED, v, nVertices, offset);
+	}
+
+	bool VertexBuffer::_create(Format format, const void* v, int nVertices, BufferUsage usage)
+	{
+		if (nVertices <= 0)
+		{
+			hlog::error(logTag, "Cannot create an empty vertex buffer!");
+			return false;
+		}
+		this->format = format;
+		this->usage = usage;
+		this->count = nVertices;
+		int size = nVertices * this->getStride();
+		// the RAM copy is kept so the buffer can be restored when the device context is lost
+		this->data = new unsigned char[size];
+		memcpy(this->data, v, size);
+		this->vramSize = size;
+		if (!this->_createInternalBuffer(v, size))
+		{
+			this->vramSize = 0;
+		}
+		april::rendersys->vertexBuffers += this;
+		return true;
+	}
+
+	bool VertexBuffer::_update(Format format, const void* v, int nVertices, int offset)
+	{
+		if (this->usage != BU_DYNAMIC)
+		{
+			hlog::error(logTag, "Cannot update an immutable vertex buffer!");
+			return false;
+		}
+		if (format != this->format)
+		{
+			hlog::error(logTag, "Cannot update vertex buffer, vertex type does not match the buffer format!");
+			return false;
+		}
+		if (offset < 0 || nVertices < 0 || offset + nVertices > this->count)
+		{
+			hlog::errorf(logTag, "Cannot update vertex buffer, range %d+%d is outside of %d vertices!", offset, nVertices, this->count);
+			return false;
+		}
+		if (nVertices == 0)
+		{
+			return true;
+		}
+		int stride = this->getStride();
+		memcpy(&this->data[offset * stride], v, nVertices * stride);
+		if (this->vramSize > 0)
+		{
+			return this->_updateInternalBuffer(v, offset * stride, nVertices * stride);
+		}
+		return true;
+	}
+
+	void VertexBuffer::_unload()
+	{
+		if (this->vramSize > 0)
+		{
+			this->_destroyInternalBuffer();
+			this->vramSize = 0;
+			this->unloaded = true;
+		}
+	}
+
+	void VertexBuffer::_restore()
+	{
+		if (this->unloaded)
+		{
+			this->unloaded = false;
+			int size = this->count * this->getStride();
+			this->vramSize = size;
+			if (!this->_createInternalBuffer(this->data, size))
+			{
+				this->vramSize = 0;
+			}
+		}
+	}
+
+	bool VertexBuffer::_createInternalBuffer(const void* data, int size)
+	{
+		return false;
+	}
+
+	bool VertexBuffer::_updateInternalBuffer(const void* data, int offset, int size)
+	{
+		return false;
+	}
+
+	void VertexBuffer::_destroyInternalBuffer()
+	{
+	}
+
+}
@@ -25,8 +25,10 @@
 #include <hltypes/hstring.h>
 
 #include "april.h"
+#include "images/ImageParallel.h"
 #include "Platform.h"
 #include "RenderSystem.h"
+#include "TextureAsync.h"
 #ifdef _DIRECTX9
 #include "DirectX9_RenderSystem.h"
 #endif
@@ -182,7 +184,13 @@ namespace april
 
 	static harray<hstr> extensions;
 	static int maxAsyncTextureUploadsPerFrame = 0;
+	static int maxAsyncTextureUploadBytesPerFrame = 0;
+	static float maxAsyncTextureUploadTimePerFrame = 0.0f;
 	static int maxWaitingAsyncTextures = 0;
+	static int maxAsyncTextureDecoderThreads = 0;
+	static int imageProcessingThreads = 0;
+	static int parallelImageProcessingThreshold = 262144;
+	static int maxImageSimdLevel = -1;
 
 	void _startInit()
 	{
@@ -395,6 +403,8 @@ namespace april
 			april::rendersys->destroy();
 			april::window->destroy();
 		}
+		TextureAsync::destroy();
+		ImageParallel::destroy();
 		if (april::window != NULL)
 		{
 			delete april::window;
@@ -439,6 +449,26 @@ namespace april
 		maxAsyncTextureUploadsPerFrame = value;
 	}
 
+	int getMaxAsyncTextureUploadBytesPerFrame()
+	{
+		return maxAsyncTextureUploadBytesPerFrame;
+	}
+
+	void setMaxAsyncTextureUploadBytesPerFrame(int value)
+	{
+		maxAsyncTextureUploadBytesPerFrame = value;
+	}
+
+	float getMaxAsyncTextureUploadTimePerFrame()
+	{
+		return maxAsyncTextureUploadTimePerFrame;
+	}
+
+	void setMaxAsyncTextureUploadTimePerFrame(float value)
+	{
+		maxAsyncTextureUploadTimePerFrame = value;
+	}
+
 	int getMaxWaitingAsyncTextures()
 	{
 		return maxWaitingAsyncTextures;
@@ -449,4 +479,48 @@ namespace april
 		maxWaitingAsyncTextures = value;
 	}
 
+	int getMaxAsyncTextureDecoderThreads()
+	{
+		return maxAsyncTextureDecoderThreads;
+	}
+
+	void setMaxAsyncTextureDecoderThreads(int value)
+	{
+		maxAsyncTextureDecoderThreads = value;
+	}
+
+	int getImageProcessingThreads()
+	{
+		return imageProcessingThreads;
+	}
+
+	void setImageProcessingThreads(int value)
+	{
+		if (value < 0)
+		{
+			value = april::getSystemInfo().cpuCores; // resolved here, because fetching SystemInfo is not allowed in secondary threads on some platforms
+		}
+		imageProcessingThreads = value;
+	}
+
+	int getParallelImageProcessingThreshold()
+	{
+		return parallelImageProcessingThreshold;
+	}
+
+	void setParallelImageProcessingThreshold(int value)
+	{
+		parallelImageProcessingThreshold = value;
+	}
+
+	int getMaxImageSimdLevel()
+	{
+		return maxImageSimdLevel;
+	}
+
+	void setMaxImageSimdLevel(int value)
+	{
+		maxImageSimdLevel = value;
+	}
+
 }
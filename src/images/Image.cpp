@@ -6,6 +6,7 @@
 /// This program is free software; you can redistribute it and/or modify it under
 /// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
 
+#include <stdlib.h>
 #include <string.h>
 
 #include <hltypes/hfile.h>
@@ -13,11 +14,13 @@
 #include <hltypes/hltypesUtil.h>
 #include <hltypes/hmap.h>
 #include <hltypes/hresource.h>
+#include <hltypes/hstream.h>
 #include <hltypes/hstring.h>
 
 #include "april.h"
 #include "Color.h"
 #include "Image.h"
+#include "ImageParallel.h"
 #include "RenderSystem.h"
 
 #ifdef __APPLE__
@@ -97,12 +100,74 @@
 #define INVERTED_LEFT_SHIFT(value) (_INVERTED_LEFT_SHIFT(value) | _L_ALPHA)
 #define INVERTED_LEFT_SHIFT_WITH_ALPHA(value) (_INVERTED_LEFT_SHIFT(value) | _L_SHIFT_ALPHA(value))
 
+// exact integer division by 255 for all values that fit into 16 bits, avoids the expensive division
+#define DIV255(value) (((value) * 0x8081) >> 23)
+
+#define RESAMPLE_WEIGHT_BITS 14
+#define RESAMPLE_ONE (1 << RESAMPLE_WEIGHT_BITS)
+#define RESAMPLE_ROW_SHIFT (RESAMPLE_WEIGHT_BITS - 7)
+#define RESAMPLE_ROW_HALF (1 << (RESAMPLE_ROW_SHIFT - 1))
+#define RESAMPLE_SHIFT (RESAMPLE_WEIGHT_BITS + 7)
+#define RESAMPLE_HALF (1 << (RESAMPLE_SHIFT - 1))
+
+// reading headers is bound by I/O latency so several files are read at the same time even on slow devices
+#define META_DATA_READER_THREADS 4
+
 #define HROUND_GRECT(rect) hround(rect.x), hround(rect.y), hround(rect.w), hround(rect.h)
 #define HROUND_GVEC2(vec2) hround(vec2.x), hround(vec2.y)
 
 namespace april
 {
 	hmap<hstr, Image* (*)(hsbase&)> Image::customLoaders;
+	hmap<hstr, Image::MetaDataIndexEntry> Image::resourceMetaDataIndex;
+	hmap<hstr, Image::MetaDataIndexEntry> Image::fileMetaDataIndex;
+	hmutex Image::metaDataIndexMutex;
+
+	Image::MetaDataIndexEntry::MetaDataIndexEntry()
+	{
+		this->image = NULL;
+		this->size = -1;
+		this->modificationTime = -1;
+	}
+
+	Image::DecodeOptions::DecodeOptions()
+	{
+		this->format = FORMAT_INVALID;
+		this->maxWidth = 0;
+		this->maxHeight = 0;
+		this->rgbFormat = FORMAT_INVALID;
+		this->rgbaFormat = FORMAT_INVALID;
+	}
+
+	Image::DecodeOptions::DecodeOptions(Image::Format format, int maxWidth, int maxHeight)
+	{
+		this->format = format;
+		this->maxWidth = maxWidth;
+		this->maxHeight = maxHeight;
+		this->rgbFormat = FORMAT_INVALID;
+		this->rgbaFormat = FORMAT_INVALID;
+	}
+
+	Image::DecodeOptions::~DecodeOptions()
+	{
+	}
+
+	Image::Format Image::DecodeOptions::getFormat(Image::Format fileFormat) const
+	{
+		if (this->format != FORMAT_INVALID)
+		{
+			return this->format;
+		}
+		if (CHECK_ALPHA_FORMAT(fileFormat))
+		{
+			return this->rgbaFormat;
+		}
+		if (Image::getFormatBpp(fileFormat) >= 3)
+		{
+			return this->rgbFormat;
+		}
+		return FORMAT_INVALID;
+	}
 
 	Image::Image()
 	{
@@ -313,106 +378,66 @@ namespace april
 
 	Image* Image::createFromResource(chstr filename)
 	{
-		hresource file;
-		if (filename.lowered().endsWith(".png"))
+		if (!Image::_isSupportedExtension(filename))
 		{
-			file.open(filename);
-			return Image::_loadPng(file);
+			return NULL;
 		}
-		if (filename.lowered().endsWith(".jpg") || filename.lowered().endsWith(".jpeg"))
-		{
-			file.open(filename);
-			return Image::_loadJpg(file);
-		}
-		if (filename.lowered().endsWith(".jpt"))
-		{
-			file.open(filename);
-			return Image::_loadJpt(file);
-		}
-#if _IMAGE_PVR
-		if (filename.lowered().endsWith(".pvr"))
-		{
-			file.open(filename);
-			return Image::_loadPvr(file);
-		}
-#endif
-		foreach_m (Image* (*)(hsbase&), it, Image::customLoaders)
-		{
-			if (filename.lowered().endsWith(it->first.lowered()))
-			{
-				file.open(filename);
-				return (*it->second)(file);
-			}
-		}
-		return NULL;
+		hresource file;
+		file.open(filename);
+		return Image::createFromStream(file, filename);
 	}
 
 	Image* Image::createFromResource(chstr filename, Image::Format format)
 	{
-		Image* image = Image::createFromResource(filename);
-		if (image != NULL && Image::needsConversion(image->format, format))
+		return Image::createFromResource(filename, DecodeOptions(format, 0, 0));
+	}
+
+	Image* Image::createFromResource(chstr filename, int maxWidth, int maxHeight, Image::Format format)
+	{
+		return Image::createFromResource(filename, DecodeOptions(format, maxWidth, maxHeight));
+	}
+
+	Image* Image::createFromResource(chstr filename, const DecodeOptions& options)
+	{
+		if (!Image::_isSupportedExtension(filename))
 		{
-			unsigned char* data = NULL;
-			if (Image::convertToFormat(image->w, image->h, image->data, image->format, &data, format))
-			{
-				delete[] image->data;
-				image->format = format;
-				image->data = data;
-			}
+			return NULL;
 		}
-		return image;
+		hresource file;
+		file.open(filename);
+		return Image::_create(&file, NULL, 0, filename, options);
 	}
 
 	Image* Image::createFromFile(chstr filename)
 	{
-		hfile file;
-		if (filename.lowered().endsWith(".png"))
-		{
-			file.open(filename);
-			return Image::_loadPng(file);
-		}
-		if (filename.lowered().endsWith(".jpg") || filename.lowered().endsWith(".jpeg"))
-		{
-			file.open(filename);
-			return Image::_loadJpg(file);
-		}
-		if (filename.lowered().endsWith(".jpt"))
-		{
-			file.open(filename);
-			return Image::_loadJpt(file);
-		}
-#if _IMAGE_PVR
-		if (filename.lowered().endsWith(".pvr"))
-		{
-			file.open(filename);
-			return Image::_loadPvr(file);
-		}
-#endif
-		foreach_m (Image* (*)(hsbase&), it, Image::customLoaders)
+		if (!Image::_isSupportedExtension(filename))
 		{
-			if (filename.lowered().endsWith(it->first.lowered()))
-			{
-				file.open(filename);
-				return (*it->second)(file);
-			}
+			return NULL;
 		}
-		return NULL;
+		hfile file;
+		file.open(filename);
+		return Image::createFromStream(file, filename);
 	}
 
 	Image* Image::createFromFile(chstr filename, Image::Format format)
 	{
-		Image* image = Image::createFromFile(filename);
-		if (image != NULL && Image::needsConversion(image->format, format))
+		return Image::createFromFile(filename, DecodeOptions(format, 0, 0));
+	}
+
+	Image* Image::createFromFile(chstr filename, int maxWidth, int maxHeight, Image::Format format)
+	{
+		return Image::createFromFile(filename, DecodeOptions(format, maxWidth, maxHeight));
+	}
+
+	Image* Image::createFromFile(chstr filename, const DecodeOptions& options)
+	{
+		if (!Image::_isSupportedExtension(filename))
 		{
-			unsigned char* data = NULL;
-			if (Image::convertToFormat(image->w, image->h, image->data, image->format, &data, format))
-			{
-				delete[] image->data;
-				image->format = format;
-				image->data = data;
-			}
+			return NULL;
 		}
-		return image;
+		hfile file;
+		file.open(filename);
+		return Image::_create(&file, NULL, 0, filename, options);
 	}
 
 	Image* Image::createFromStream(hsbase& stream, chstr logicalExtension)
@@ -447,18 +472,53 @@ namespace april
 
 	Image* Image::createFromStream(hsbase& stream, chstr logicalExtension, Image::Format format)
 	{
-		Image* image = Image::createFromStream(stream, logicalExtension);
-		if (image != NULL && Image::needsConversion(image->format, format))
+		return Image::_create(&stream, NULL, 0, logicalExtension, DecodeOptions(format, 0, 0));
+	}
+
+	Image* Image::createFromStream(hsbase& stream, chstr logicalExtension, int maxWidth, int maxHeight, Image::Format format)
+	{
+		return Image::_create(&stream, NULL, 0, logicalExtension, DecodeOptions(format, maxWidth, maxHeight));
+	}
+
+	Image* Image::createFromStream(hsbase& stream, chstr logicalExtension, const DecodeOptions& options)
+	{
+		return Image::_create(&stream, NULL, 0, logicalExtension, options);
+	}
+
+	Image* Image::createFromMemory(unsigned char* data, int size, chstr logicalExtension)
+	{
+		if (logicalExtension.lowered().endsWith(".png"))
 		{
-			unsigned char* data = NULL;
-			if (Image::convertToFormat(image->w, image->h, image->data, image->format, &data, format))
-			{
-				delete[] image->data;
-				image->format = format;
-				image->data = data;
-			}
+			return Image::_loadPng(data, size);
 		}
-		return image;
+		if (logicalExtension.lowered().endsWith(".jpg") || logicalExtension.lowered().endsWith(".jpeg"))
+		{
+			return Image::_loadJpg(data, size);
+		}
+		if (logicalExtension.lowered().endsWith(".jpt"))
+		{
+			return Image::_loadJpt(data, size);
+		}
+		// other loaders only work with streams
+		hstream stream;
+		stream.writeRaw(data, size);
+		stream.rewind();
+		return Image::createFromStream(stream, logicalExtension);
+	}
+
+	Image* Image::createFromMemory(unsigned char* data, int size, chstr logicalExtension, Image::Format format)
+	{
+		return Image::_create(NULL, data, size, logicalExtension, DecodeOptions(format, 0, 0));
+	}
+
+	Image* Image::createFromMemory(unsigned char* data, int size, chstr logicalExtension, int maxWidth, int maxHeight, Image::Format format)
+	{
+		return Image::_create(NULL, data, size, logicalExtension, DecodeOptions(format, maxWidth, maxHeight));
+	}
+
+	Image* Image::createFromMemory(unsigned char* data, int size, chstr logicalExtension, const DecodeOptions& options)
+	{
+		return Image::_create(NULL, data, size, logicalExtension, options);
 	}
 
 	Image* Image::create(int w, int h, unsigned char* data, Image::Format format)
@@ -517,104 +577,401 @@ namespace april
 
 	Image* Image::readMetaDataFromResource(chstr filename)
 	{
+		Image* image = Image::_findIndexedMetaData(filename, true);
+		if (image != NULL)
+		{
+			return image;
+		}
+		if (!Image::_isSupportedExtension(filename))
+		{
+			return NULL;
+		}
 		hresource file;
-		if (filename.lowered().endsWith(".png"))
+		file.open(filename);
+		return Image::readMetaDataFromStream(file, filename);
+	}
+
+	Image* Image::readMetaDataFromFile(chstr filename)
+	{
+		Image* image = Image::_findIndexedMetaData(filename, false);
+		if (image != NULL)
 		{
-			file.open(filename);
-			return Image::_readMetaDataPng(file);
+			return image;
 		}
-		if (filename.lowered().endsWith(".jpg") || filename.lowered().endsWith(".jpeg"))
+		if (!Image::_isSupportedExtension(filename))
 		{
-			file.open(filename);
-			return Image::_readMetaDataJpg(file);
+			return NULL;
 		}
-		if (filename.lowered().endsWith(".jpt"))
+		hfile file;
+		file.open(filename);
+		return Image::readMetaDataFromStream(file, filename);
+	}
+
+	Image* Image::readMetaDataFromStream(hsbase& stream, chstr logicalExtension)
+	{
+		if (logicalExtension.lowered().endsWith(".png"))
 		{
-			file.open(filename);
-			return Image::_readMetaDataJpt(file);
+			return Image::_readMetaDataPng(stream);
 		}
-#if _IMAGE_PVR
-		if (filename.lowered().endsWith(".pvr"))
+		if (logicalExtension.lowered().endsWith(".jpg") || logicalExtension.lowered().endsWith(".jpeg"))
 		{
-			file.open(filename);
-			return Image::_readMetaDataPvr(file);
+			return Image::_readMetaDataJpg(stream);
+		}
+		if (logicalExtension.lowered().endsWith(".jpt"))
+		{
+			return Image::_readMetaDataJpt(stream);
+		}
+#ifdef _IMAGE_PVR
+		if (logicalExtension.lowered().endsWith(".pvr"))
+		{
+			return Image::_readMetaDataPvr(stream);
 		}
 #endif
 		foreach_m (Image* (*)(hsbase&), it, Image::customLoaders)
 		{
-			if (filename.lowered().endsWith(it->first.lowered()))
+			if (logicalExtension.lowered().endsWith(it->first.lowered()))
 			{
-				file.open(filename);
-				return (*it->second)(file);
+				return (*it->second)(stream);
 			}
 		}
 		return NULL;
 	}
 
-	Image* Image::readMetaDataFromFile(chstr filename)
+	harray<Image*> Image::readMetaDataFromResources(harray<hstr> filenames)
 	{
-		hfile file;
-		if (filename.lowered().endsWith(".png"))
+		return Image::_readMetaData(filenames, true);
+	}
+
+	harray<Image*> Image::readMetaDataFromFiles(harray<hstr> filenames)
+	{
+		return Image::_readMetaData(filenames, false);
+	}
+
+	// filenames are escaped so tabs and line breaks in them can't break up the lines of the index
+	static hstr _escapeMetaDataField(chstr value)
+	{
+		return value.replaced("\\", "\\\\").replaced("\t", "\\t").replaced("\n", "\\n").replaced("\r", "\\r");
+	}
+
+	static hstr _unescapeMetaDataField(chstr value)
+	{
+		hstr result;
+		const char* chars = value.cStr();
+		int size = value.size();
+		for_iter (i, 0, size)
 		{
-			file.open(filename);
-			return Image::_readMetaDataPng(file);
+			if (chars[i] == '\\' && i < size - 1)
+			{
+				++i;
+				switch (chars[i])
+				{
+				case 't':
+					result += '\t';
+					break;
+				case 'n':
+					result += '\n';
+					break;
+				case 'r':
+					result += '\r';
+					break;
+				default:
+					result += chars[i];
+					break;
+				}
+			}
+			else
+			{
+				result += chars[i];
+			}
 		}
-		if (filename.lowered().endsWith(".jpg") || filename.lowered().endsWith(".jpeg"))
+		return result;
+	}
+
+	bool Image::loadMetaDataIndex(chstr filename)
+	{
+		if (!hfile::exists(filename))
 		{
-			file.open(filename);
-			return Image::_readMetaDataJpg(file);
+			return false;
 		}
-		if (filename.lowered().endsWith(".jpt"))
+		harray<hstr> lines = hfile::hread(filename).split('\n', -1, true);
+		harray<hstr> data;
+		hstr name;
+		MetaDataIndexEntry* entry = NULL;
+		hmutex::ScopeLock lock(&Image::metaDataIndexMutex);
+		foreach (hstr, it, lines)
 		{
-			file.open(filename);
-			return Image::_readMetaDataJpt(file);
+			// source, filename, file size, modification time, width, height, format, internal format, compressed size
+			data = (*it).split('\t');
+			if (data.size() != 9 || (data[0] != "resource" && data[0] != "file"))
+			{
+				hlog::warn(logTag, "Invalid line in image metadata index: " + (*it));
+				continue;
+			}
+			hmap<hstr, MetaDataIndexEntry>& index = Image::_getMetaDataIndex(data[0] == "resource");
+			name = _unescapeMetaDataField(data[1]);
+			entry = &index[name];
+			if (entry->image == NULL)
+			{
+				entry->image = new Image();
+				entry->image->data = NULL;
+			}
+			entry->size = (int64_t)atoll(data[2].cStr());
+			entry->modificationTime = (int64_t)atoll(data[3].cStr());
+			entry->image->w = (int)data[4];
+			entry->image->h = (int)data[5];
+			entry->image->format = (Format)(int)data[6];
+			entry->image->internalFormat = (int)data[7];
+			entry->image->compressedSize = (int)data[8];
 		}
-#if _IMAGE_PVR
-		if (filename.lowered().endsWith(".pvr"))
+		return true;
+	}
+
+	bool Image::saveMetaDataIndex(chstr filename)
+	{
+		harray<hstr> lines;
+		Image* image = NULL;
+		hmutex::ScopeLock lock(&Image::metaDataIndexMutex);
+		for_iter (i, 0, 2)
 		{
-			file.open(filename);
-			return Image::_readMetaDataPvr(file);
+			hmap<hstr, MetaDataIndexEntry>& index = Image::_getMetaDataIndex(i == 0);
+			foreach_m (MetaDataIndexEntry, it, index)
+			{
+				image = it->second.image;
+				lines += hsprintf("%s\t%s\t%lld\t%lld\t%d\t%d\t%d\t%d\t%d", (i == 0 ? "resource" : "file"), _escapeMetaDataField(it->first).cStr(),
+					(long long)it->second.size, (long long)it->second.modificationTime, image->w, image->h, (int)image->format, image->internalFormat,
+					image->compressedSize);
+			}
+		}
+		lock.release();
+		hfile::hwrite(filename, lines.joined("\n"));
+		return hfile::exists(filename);
+	}
+
+	void Image::clearMetaDataIndex()
+	{
+		hmutex::ScopeLock lock(&Image::metaDataIndexMutex);
+		foreach_m (MetaDataIndexEntry, it, Image::resourceMetaDataIndex)
+		{
+			delete it->second.image;
+		}
+		Image::resourceMetaDataIndex.clear();
+		foreach_m (MetaDataIndexEntry, it, Image::fileMetaDataIndex)
+		{
+			delete it->second.image;
+		}
+		Image::fileMetaDataIndex.clear();
+	}
+
+	hmap<hstr, Image::MetaDataIndexEntry>& Image::_getMetaDataIndex(bool fromResources)
+	{
+		return (fromResources ? Image::resourceMetaDataIndex : Image::fileMetaDataIndex);
+	}
+
+	void Image::_getMetaDataStamp(chstr filename, bool fromResources, int64_t& size, int64_t& modificationTime)
+	{
+		hltypes::FileInfo info = (fromResources ? hresource::hinfo(filename) : hfile::hinfo(filename));
+		size = info.size;
+		modificationTime = info.modificationTime;
+	}
+
+	Image* Image::_findIndexedMetaData(chstr filename, bool fromResources)
+	{
+		hmutex::ScopeLock lock(&Image::metaDataIndexMutex);
+		if (!Image::_getMetaDataIndex(fromResources).hasKey(filename))
+		{
+			return NULL;
+		}
+		lock.release();
+		int64_t size = 0;
+		int64_t modificationTime = 0;
+		Image::_getMetaDataStamp(filename, fromResources, size, modificationTime);
+		lock.acquire(&Image::metaDataIndexMutex);
+		hmap<hstr, MetaDataIndexEntry>& index = Image::_getMetaDataIndex(fromResources);
+		if (!index.hasKey(filename))
+		{
+			return NULL;
+		}
+		MetaDataIndexEntry& entry = index[filename];
+		// the file was changed or replaced since its metadata was read
+		if (entry.size != size || entry.modificationTime != modificationTime)
+		{
+			return NULL;
+		}
+		Image* image = new Image();
+		image->data = NULL;
+		image->w = entry.image->w;
+		image->h = entry.image->h;
+		image->format = entry.image->format;
+		image->internalFormat = entry.image->internalFormat;
+		image->compressedSize = entry.image->compressedSize;
+		return image;
+	}
+
+	struct MetaDataOperation
+	{
+		hstr* filenames;
+		bool fromResources;
+		Image** images;
+		int64_t* sizes;
+		int64_t* modificationTimes;
+	};
+
+	harray<Image*> Image::_readMetaData(harray<hstr> filenames, bool fromResources)
+	{
+		harray<Image*> result;
+		if (filenames.size() == 0)
+		{
+			return result;
+		}
+		MetaDataOperation operation;
+		operation.filenames = &filenames[0];
+		operation.fromResources = fromResources;
+		operation.images = new Image*[filenames.size()];
+		memset(operation.images, 0, filenames.size() * sizeof(Image*));
+		operation.sizes = new int64_t[filenames.size()];
+		operation.modificationTimes = new int64_t[filenames.size()];
+		bool success = true;
+		if (!ImageParallel::executeConcurrently(META_DATA_READER_THREADS, filenames.size(), &Image::_processMetaDataBand, &operation, success))
+		{
+			Image::_processMetaDataBand(&operation, 0, filenames.size());
+		}
+		MetaDataIndexEntry* entry = NULL;
+		hmutex::ScopeLock lock(&Image::metaDataIndexMutex);
+		hmap<hstr, MetaDataIndexEntry>& index = Image::_getMetaDataIndex(fromResources);
+		for_iter (i, 0, filenames.size())
+		{
+			result += operation.images[i];
+			if (operation.images[i] != NULL)
+			{
+				entry = &index[filenames[i]];
+				if (entry->image == NULL)
+				{
+					entry->image = new Image();
+					entry->image->data = NULL;
+				}
+				entry->size = operation.sizes[i];
+				entry->modificationTime = operation.modificationTimes[i];
+				entry->image->w = operation.images[i]->w;
+				entry->image->h = operation.images[i]->h;
+				entry->image->format = operation.images[i]->format;
+				entry->image->internalFormat = operation.images[i]->internalFormat;
+				entry->image->compressedSize = operation.images[i]->compressedSize;
+			}
+		}
+		delete[] operation.images;
+		delete[] operation.sizes;
+		delete[] operation.modificationTimes;
+		return result;
+	}
+
+	bool Image::_processMetaDataBand(void* args, int first, int count)
+	{
+		MetaDataOperation* operation = (MetaDataOperation*)args;
+		for_iter (i, first, first + count)
+		{
+			// taken before reading so a change during reading invalidates the entry rather than hiding the change
+			Image::_getMetaDataStamp(operation->filenames[i], operation->fromResources, operation->sizes[i], operation->modificationTimes[i]);
+			if (operation->fromResources)
+			{
+				operation->images[i] = Image::readMetaDataFromResource(operation->filenames[i]);
+			}
+			else
+			{
+				operation->images[i] = Image::readMetaDataFromFile(operation->filenames[i]);
+			}
+		}
+		return true;
+	}
+
+	bool Image::_isSupportedExtension(chstr filename)
+	{
+		hstr extension = filename.lowered();
+		if (extension.endsWith(".png") || extension.endsWith(".jpg") || extension.endsWith(".jpeg") || extension.endsWith(".jpt"))
+		{
+			return true;
+		}
+#ifdef _IMAGE_PVR
+		if (extension.endsWith(".pvr"))
+		{
+			return true;
 		}
 #endif
 		foreach_m (Image* (*)(hsbase&), it, Image::customLoaders)
 		{
-			if (filename.lowered().endsWith(it->first.lowered()))
+			if (extension.endsWith(it->first.lowered()))
 			{
-				file.open(filename);
-				return (*it->second)(file);
+				return true;
 			}
 		}
-		return NULL;
+		return false;
 	}
 
-	Image* Image::readMetaDataFromStream(hsbase& stream, chstr logicalExtension)
+	Image* Image::_create(hsbase* stream, unsigned char* data, int size, chstr logicalExtension, const DecodeOptions& options)
 	{
+		Image* image = NULL;
+		// PNG and JPEG are reduced and converted while decoding
 		if (logicalExtension.lowered().endsWith(".png"))
 		{
-			return Image::_readMetaDataPng(stream);
+			image = (stream != NULL ? Image::_loadPng(*stream, (int)stream->size(), options) : Image::_loadPng(data, size, options));
 		}
-		if (logicalExtension.lowered().endsWith(".jpg") || logicalExtension.lowered().endsWith(".jpeg"))
+		else if (logicalExtension.lowered().endsWith(".jpg") || logicalExtension.lowered().endsWith(".jpeg"))
 		{
-			return Image::_readMetaDataJpg(stream);
+			image = (stream != NULL ? Image::_loadJpg(*stream, (int)stream->size(), options) : Image::_loadJpg(data, size, options));
 		}
-		if (logicalExtension.lowered().endsWith(".jpt"))
+		else
 		{
-			return Image::_readMetaDataJpt(stream);
+			image = (stream != NULL ? Image::createFromStream(*stream, logicalExtension) : Image::createFromMemory(data, size, logicalExtension));
 		}
-#ifdef _IMAGE_PVR
-		if (logicalExtension.lowered().endsWith(".pvr"))
+		if (image != NULL)
 		{
-			return Image::_readMetaDataPvr(stream);
+			image = Image::_fitReduced(image, options.maxWidth, options.maxHeight, options.getFormat(image->format));
 		}
-#endif
-		foreach_m (Image* (*)(hsbase&), it, Image::customLoaders)
+		return image;
+	}
+
+	Image* Image::_fitReduced(Image* image, int maxWidth, int maxHeight, Image::Format format)
+	{
+		if (image == NULL)
 		{
-			if (logicalExtension.lowered().endsWith(it->first.lowered()))
+			return NULL;
+		}
+		int w = 0;
+		int h = 0;
+		Image::getReducedSize(image->w, image->h, maxWidth, maxHeight, w, h);
+		if (w != image->w || h != image->h)
+		{
+			if (image->internalFormat != 0)
 			{
-				return (*it->second)(stream);
+				hlog::warn(logTag, "Cannot reduce the size of an image with a compressed format!");
+			}
+			else
+			{
+				unsigned char* data = new unsigned char[w * h * image->getBpp()];
+				if (Image::writeStretch(0, 0, image->w, image->h, 0, 0, w, h, image->data, image->w, image->h, image->format, data, w, h, image->format))
+				{
+					delete[] image->data;
+					image->data = data;
+					image->w = w;
+					image->h = h;
+				}
+				else
+				{
+					delete[] data;
+				}
 			}
 		}
-		return NULL;
+		// compressed data can't be converted
+		if (format != FORMAT_INVALID && image->internalFormat == 0 && Image::needsConversion(image->format, format))
+		{
+			unsigned char* data = NULL;
+			if (Image::convertToFormat(image->w, image->h, image->data, image->format, &data, format))
+			{
+				delete[] image->data;
+				image->format = format;
+				image->data = data;
+			}
+		}
+		return image;
 	}
 
 	int Image::getFormatBpp(Image::Format format)
@@ -638,6 +995,280 @@ namespace april
 		return 0;
 	}
 
+	void Image::getReducedSize(int w, int h, int maxWidth, int maxHeight, int& reducedWidth, int& reducedHeight)
+	{
+		bool limitWidth = (maxWidth > 0 && w > maxWidth);
+		bool limitHeight = (maxHeight > 0 && h > maxHeight);
+		if (limitWidth && limitHeight)
+		{
+			// only the dimension that requires the larger reduction is limited, the other one follows the aspect ratio
+			if ((int64_t)maxWidth * h <= (int64_t)maxHeight * w)
+			{
+				limitHeight = false;
+			}
+			else
+			{
+				limitWidth = false;
+			}
+		}
+		if (limitWidth)
+		{
+			reducedHeight = hmax((int)(((int64_t)h * maxWidth + w / 2) / w), 1);
+			reducedWidth = maxWidth;
+		}
+		else if (limitHeight)
+		{
+			reducedWidth = hmax((int)(((int64_t)w * maxHeight + h / 2) / h), 1);
+			reducedHeight = maxHeight;
+		}
+		else
+		{
+			reducedWidth = w;
+			reducedHeight = h;
+		}
+	}
+
+	// resampling uses 16.16 fixed point coordinates, Q14 filter weights and Q7 intermediate values
+	static int _makeResampleTable(int srcStart, int srcSize, int destSize, int** indices, short** weights)
+	{
+		// large downscales use an area filter, otherwise bilinear filtering is used
+		bool box = (srcSize >= destSize * 2);
+		int taps = (box ? (srcSize + destSize - 1) / destSize + 1 : 2);
+		*indices = new int[destSize * taps];
+		*weights = new short[destSize * taps];
+		// taps never leave the source rect, pixels outside of it may not be initialized
+		int srcLast = srcStart + srcSize - 1;
+		int64_t position = 0;
+		int index = 0;
+		int fraction = 0;
+		if (!box)
+		{
+			int64_t step = ((int64_t)srcSize << 16) / destSize;
+			for_iter (i, 0, destSize)
+			{
+				position = ((int64_t)srcStart << 16) + i * step;
+				index = (int)(position >> 16);
+				fraction = (int)(position & 0xFFFF) >> (16 - RESAMPLE_WEIGHT_BITS);
+				(*indices)[i * 2] = index;
+				(*indices)[i * 2 + 1] = hmin(index + 1, srcLast);
+				(*weights)[i * 2] = (short)(RESAMPLE_ONE - fraction);
+				(*weights)[i * 2 + 1] = (short)fraction;
+			}
+			return taps;
+		}
+		int64_t start = 0;
+		int64_t end = 0;
+		int64_t coverage = 0;
+		int weight = 0;
+		int total = 0;
+		int last = 0;
+		for_iter (i, 0, destSize)
+		{
+			start = ((int64_t)srcStart << 16) + ((int64_t)i * srcSize << 16) / destSize;
+			end = ((int64_t)srcStart << 16) + ((int64_t)(i + 1) * srcSize << 16) / destSize;
+			last = (int)(start >> 16);
+			total = 0;
+			for_iter (t, 0, taps)
+			{
+				index = (int)(start >> 16) + t;
+				coverage = hmin(end, (int64_t)(index + 1) << 16) - hmax(start, (int64_t)index << 16);
+				weight = 0;
+				if (coverage > 0)
+				{
+					weight = (int)(coverage * RESAMPLE_ONE / (end - start));
+					last = index;
+				}
+				// unused taps repeat the last covered pixel with a weight of 0
+				(*indices)[i * taps + t] = last;
+				(*weights)[i * taps + t] = (short)weight;
+				total += weight;
+			}
+			// rounding leftovers go to the first tap so the weights always add up exactly
+			(*weights)[i * taps] += (short)(RESAMPLE_ONE - total);
+		}
+		return taps;
+	}
+
+	static void _resampleRow(unsigned char* src, int bpp, int w, int* indices, short* weights, int taps, short* dest)
+	{
+		unsigned char* p0 = NULL;
+		unsigned char* p1 = NULL;
+		int w0 = 0;
+		int w1 = 0;
+		int value = 0;
+		if (taps == 2)
+		{
+			for_iter (x, 0, w)
+			{
+				p0 = &src[indices[x * 2]];
+				p1 = &src[indices[x * 2 + 1]];
+				w0 = weights[x * 2];
+				w1 = weights[x * 2 + 1];
+				for_iter (c, 0, bpp)
+				{
+					dest[c] = (short)((p0[c] * w0 + p1[c] * w1 + RESAMPLE_ROW_HALF) >> RESAMPLE_ROW_SHIFT);
+				}
+				dest += bpp;
+			}
+			return;
+		}
+		for_iter (x, 0, w)
+		{
+			for_iter (c, 0, bpp)
+			{
+				value = 0;
+				for_iter (t, 0, taps)
+				{
+					value += src[indices[x * taps + t] + c] * weights[x * taps + t];
+				}
+				dest[c] = (short)((value + RESAMPLE_ROW_HALF) >> RESAMPLE_ROW_SHIFT);
+			}
+			dest += bpp;
+		}
+	}
+
+	/// @brief Resampling filter tables of a stretch operation.
+	struct ResampleTables
+	{
+		int* xIndices;
+		short* xWeights;
+		int xTaps;
+		int* yIndices;
+		short* yWeights;
+		int yTaps;
+
+		ResampleTables(int sx, int sy, int sw, int sh, int dw, int dh, int bpp)
+		{
+			this->xTaps = _makeResampleTable(sx, sw, dw, &this->xIndices, &this->xWeights);
+			this->yTaps = _makeResampleTable(sy, sh, dh, &this->yIndices, &this->yWeights);
+			// horizontal indices are used as byte offsets within a row
+			for_iter (i, 0, dw * this->xTaps)
+			{
+				this->xIndices[i] *= bpp;
+			}
+		}
+
+		~ResampleTables()
+		{
+			delete[] this->xIndices;
+			delete[] this->xWeights;
+			delete[] this->yIndices;
+			delete[] this->yWeights;
+		}
+
+	};
+
+	/// @brief Arguments of an operation that is split into row bands.
+	struct BandOperation
+	{
+		enum Type
+		{
+			CONVERT,
+			WRITE,
+			STRETCH,
+			BLIT,
+			ROTATE_HUE,
+			SATURATE,
+			INVERT,
+			INSERT_ALPHA_MAP
+		};
+
+		Type type;
+		int sx;
+		int sy;
+		int sw;
+		int sh;
+		unsigned char* srcData;
+		int srcWidth;
+		int srcHeight;
+		Image::Format srcFormat;
+		int dx;
+		int dy;
+		int dw;
+		int dh;
+		unsigned char* destData;
+		int destWidth;
+		int destHeight;
+		Image::Format destFormat;
+		bool blend;
+		unsigned char alpha;
+		float value;
+		unsigned char median;
+		int ambiguity;
+		ResampleTables* tables;
+
+		BandOperation(Type type, int sx, int sy, int sw, int sh, unsigned char* srcData, int srcWidth, int srcHeight, Image::Format srcFormat)
+		{
+			this->type = type;
+			this->sx = sx;
+			this->sy = sy;
+			this->sw = sw;
+			this->sh = sh;
+			this->srcData = srcData;
+			this->srcWidth = srcWidth;
+			this->srcHeight = srcHeight;
+			this->srcFormat = srcFormat;
+			this->dx = 0;
+			this->dy = 0;
+			this->dw = sw;
+			this->dh = sh;
+			this->destData = NULL;
+			this->destWidth = 0;
+			this->destHeight = 0;
+			this->destFormat = srcFormat;
+			this->blend = false;
+			this->alpha = 255;
+			this->value = 0.0f;
+			this->median = 0;
+			this->ambiguity = 0;
+			this->tables = NULL;
+		}
+
+		void setDestination(int dx, int dy, unsigned char* destData, int destWidth, int destHeight, Image::Format destFormat)
+		{
+			this->dx = dx;
+			this->dy = dy;
+			this->destData = destData;
+			this->destWidth = destWidth;
+			this->destHeight = destHeight;
+			this->destFormat = destFormat;
+		}
+
+	};
+
+	bool Image::_processBand(void* args, int first, int count)
+	{
+		BandOperation* o = (BandOperation*)args;
+		int srcBpp = Image::getFormatBpp(o->srcFormat);
+		int destBpp = Image::getFormatBpp(o->destFormat);
+		unsigned char* dest = NULL;
+		switch (o->type)
+		{
+		case BandOperation::CONVERT:
+			dest = &o->destData[first * o->sw * destBpp];
+			return Image::convertToFormat(o->sw, count, &o->srcData[first * o->sw * srcBpp], o->srcFormat, &dest, o->destFormat, false);
+		case BandOperation::WRITE:
+			return Image::write(o->sx, o->sy + first, o->sw, count, o->dx, o->dy + first, o->srcData, o->srcWidth, o->srcHeight, o->srcFormat,
+				o->destData, o->destWidth, o->destHeight, o->destFormat);
+		case BandOperation::STRETCH:
+			return Image::_stretch(o->sx, o->sy, o->sw, o->sh, o->dx, o->dy, o->dw, o->dh, o->srcData, o->srcWidth, o->srcHeight, o->srcFormat,
+				o->destData, o->destWidth, o->destHeight, o->destFormat, o->blend, o->alpha, o->tables, first, count);
+		case BandOperation::BLIT:
+			return Image::blit(o->sx, o->sy + first, o->sw, count, o->dx, o->dy + first, o->srcData, o->srcWidth, o->srcHeight, o->srcFormat,
+				o->destData, o->destWidth, o->destHeight, o->destFormat, o->alpha);
+		case BandOperation::ROTATE_HUE:
+			return Image::rotateHue(o->sx, o->sy + first, o->sw, count, o->value, o->srcData, o->srcWidth, o->srcHeight, o->srcFormat);
+		case BandOperation::SATURATE:
+			return Image::saturate(o->sx, o->sy + first, o->sw, count, o->value, o->srcData, o->srcWidth, o->srcHeight, o->srcFormat);
+		case BandOperation::INVERT:
+			return Image::invert(o->sx, o->sy + first, o->sw, count, o->srcData, o->srcWidth, o->srcHeight, o->srcFormat);
+		case BandOperation::INSERT_ALPHA_MAP:
+			return Image::insertAlphaMap(o->sw, count, &o->srcData[first * o->sw * srcBpp], o->srcFormat, &o->destData[first * o->sw * destBpp], o->destFormat,
+				o->median, o->ambiguity);
+		}
+		return false;
+	}
+
 	// image data manipulation functions
 
 	Color Image::getPixel(int x, int y, unsigned char* srcData, int srcWidth, int srcHeight, Format srcFormat)
@@ -782,312 +1413,81 @@ namespace april
 		{
 			return false;
 		}
-		int srcBpp = Image::getFormatBpp(srcFormat);
-		int destBpp = Image::getFormatBpp(destFormat);
-		if (srcFormat == FORMAT_ALPHA && destFormat != FORMAT_ALPHA)
+		BandOperation operation(BandOperation::WRITE, sx, sy, sw, sh, srcData, srcWidth, srcHeight, srcFormat);
+		operation.setDestination(dx, dy, destData, destWidth, destHeight, destFormat);
+		bool result = true;
+		if (ImageParallel::execute(sh, sw * sh, &Image::_processBand, &operation, result))
 		{
-			if (destBpp == 4)
-			{
-				if (CHECK_ALPHA_FORMAT(destFormat))
-				{
-					int x = 0;
-					int y = 0;
-					int da = -1;
-					Image::_getFormatIndices(destFormat, NULL, NULL, NULL, &da);
-					for_iterx (y, 0, sh)
-					{
-						for_iterx (x, 0, sw)
-						{
-							destData[((dx + x) + (dy + y) * destWidth) * destBpp + da] = srcData[((sx + x) + (sy + y) * srcWidth) * srcBpp];
-						}
-					}
-				}
-				return true;
-			}
-			return false;
+			return result;
 		}
-		unsigned char* p = &destData[(dx + dy * destWidth) * destBpp];
-		if (sx == 0 && dx == 0 && srcWidth == destWidth && sw == destWidth)
-		{
-			Image::convertToFormat(sw, sh, &srcData[(sx + sy * srcWidth) * srcBpp], srcFormat, &p, destFormat, false);
-		}
-		else
-		{
-			for_iter (j, 0, sh)
-			{
-				Image::convertToFormat(sw, 1, &srcData[(sx + (sy + j) * srcWidth) * srcBpp], srcFormat, &p, destFormat, false);
-				p += destWidth * destBpp;
-			}
-		}
-		return true;
-	}
-
-	bool Image::writeStretch(int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh, unsigned char* srcData, int srcWidth, int srcHeight, Format srcFormat,
-		unsigned char* destData, int destWidth, int destHeight, Format destFormat)
-	{
-		if (!Image::correctRect(sx, sy, sw, sh, srcWidth, srcHeight, dx, dy, dw, dh, destWidth, destHeight))
-		{
-			return false;
-		}
-		if (sw == dw && sh == dh)
-		{
-			return Image::write(sx, sy, sw, sh, dx, dh, srcData, srcWidth, srcHeight, srcFormat, destData, destWidth, destHeight, destFormat);
-		}
-		int bpp = Image::getFormatBpp(destFormat);
-		float fw = (float)sw / dw;
-		float fh = (float)sh / dh;
-		unsigned char* dest = NULL;
-		unsigned char* ctl;
-		unsigned char* ctr;
-		unsigned char* cbl;
-		unsigned char* cbr;
-		float srcX;
-		float srcY;
-		int x0;
-		int y0;
-		int x1;
-		int y1;
-		float rx0;
-		float ry0;
-		float rx1;
-		float ry1;
-		int x = 0;
-		int y = 0;
+		int srcBpp = Image::getFormatBpp(srcFormat);
+		int destBpp = Image::getFormatBpp(destFormat);
 		if (srcFormat == FORMAT_ALPHA && destFormat != FORMAT_ALPHA)
 		{
-			if (bpp == 4)
-			{
-				if (CHECK_ALPHA_FORMAT(destFormat))
-				{
-					int da = -1;
-					Image::_getFormatIndices(destFormat, NULL, NULL, NULL, &da);
-					for_iterx (y, 0, dh)
-					{
-						srcY = sy + y * fh;
-						y0 = (int)srcY;
-						ry0 = srcY - y0;
-						y1 = hmin(y0 + 1, srcHeight - 1);
-						ry1 = 1.0f - ry0;
-						for_iterx (x, 0, dw)
-						{
-							dest = &destData[((dx + x) + (dy + y) * destWidth) * bpp];
-							srcX = sx + x * fw;
-							x0 = (int)srcX;
-							rx0 = srcX - x0;
-							// linear interpolation
-							ctl = &srcData[(x0 + y0 * srcWidth) * bpp];
-							if (rx0 != 0.0f && ry0 != 0.0f)
-							{
-								x1 = hmin(x0 + 1, srcWidth - 1);
-								rx1 = 1.0f - rx0;
-								ctr = &srcData[(x1 + y0 * srcWidth) * bpp];
-								cbl = &srcData[(x0 + y1 * srcWidth) * bpp];
-								cbr = &srcData[(x1 + y1 * srcWidth) * bpp];
-								dest[da] = (unsigned char)(((ctl[0] * ry1 + cbl[0] * ry0) * rx1 + (ctr[0] * ry1 + cbr[0] * ry0) * rx0));
-							}
-							else if (rx0 != 0.0f)
-							{
-								x1 = hmin(x0 + 1, srcWidth - 1);
-								rx1 = 1.0f - rx0;
-								ctr = &srcData[(x1 + y0 * srcWidth) * bpp];
-								dest[da] = (unsigned char)((ctl[0] * rx1 + ctr[0] * rx0));
-							}
-							else if (ry0 != 0.0f)
-							{
-								cbl = &srcData[(x0 + y1 * srcWidth) * bpp];
-								dest[da] = (unsigned char)((ctl[0] * ry1 + cbl[0] * ry0));
-							}
-							else
-							{
-								dest[da] = ctl[0];
-							}
-						}
-					}
-				}
-				return true;
-			}
-			return false;
-		}
-		bool createNew = Image::needsConversion(srcFormat, destFormat);
-		if (createNew)
-		{
-			unsigned char* data = srcData;
-			srcData = new unsigned char[sw * sh * bpp];
-			if (!Image::write(sx, sy, sw, sh, 0, 0, data, srcWidth, srcHeight, srcFormat, srcData, sw, sh, destFormat))
-			{
-				delete[] srcData;
-				return false;
-			}
-			// changed size of data, needs to readjust
-			sx = 0;
-			sy = 0;
-			srcWidth = sw;
-			srcHeight = sh;
-		}
-		bool result = false;
-		if (bpp == 1)
-		{
-			for_iterx (y, 0, dh)
-			{
-				srcY = sy + y * fh;
-				y0 = (int)srcY;
-				ry0 = srcY - y0;
-				y1 = hmin(y0 + 1, srcHeight - 1);
-				ry1 = 1.0f - ry0;
-				for_iterx (x, 0, dw)
-				{
-					dest = &destData[((dx + x) + (dy + y) * destWidth) * bpp];
-					srcX = sx + x * fw;
-					x0 = (int)srcX;
-					rx0 = srcX - x0;
-					// linear interpolation
-					ctl = &srcData[(x0 + y0 * srcWidth) * bpp];
-					if (rx0 != 0.0f && ry0 != 0.0f)
-					{
-						x1 = hmin(x0 + 1, srcWidth - 1);
-						rx1 = 1.0f - rx0;
-						ctr = &srcData[(x1 + y0 * srcWidth) * bpp];
-						cbl = &srcData[(x0 + y1 * srcWidth) * bpp];
-						cbr = &srcData[(x1 + y1 * srcWidth) * bpp];
-						dest[0] = (unsigned char)(((ctl[0] * ry1 + cbl[0] * ry0) * rx1 + (ctr[0] * ry1 + cbr[0] * ry0) * rx0));
-					}
-					else if (rx0 != 0.0f)
-					{
-						x1 = hmin(x0 + 1, srcWidth - 1);
-						rx1 = 1.0f - rx0;
-						ctr = &srcData[(x1 + y0 * srcWidth) * bpp];
-						dest[0] = (unsigned char)((ctl[0] * rx1 + ctr[0] * rx0));
-					}
-					else if (ry0 != 0.0f)
-					{
-						cbl = &srcData[(x0 + y1 * srcWidth) * bpp];
-						dest[0] = (unsigned char)((ctl[0] * ry1 + cbl[0] * ry0));
-					}
-					else
-					{
-						dest[0] = ctl[0];
-					}
-				}
-			}
-			result = true;
-		}
-		else if (bpp == 3)
-		{
-			for_iterx (y, 0, dh)
+			if (destBpp == 4)
 			{
-				srcY = sy + y * fh;
-				y0 = (int)srcY;
-				ry0 = srcY - y0;
-				y1 = hmin(y0 + 1, srcHeight - 1);
-				ry1 = 1.0f - ry0;
-				for_iterx (x, 0, dw)
+				if (CHECK_ALPHA_FORMAT(destFormat))
 				{
-					dest = &destData[((dx + x) + (dy + y) * destWidth) * bpp];
-					srcX = sx + x * fw;
-					x0 = (int)srcX;
-					rx0 = srcX - x0;
-					// linear interpolation
-					ctl = &srcData[(x0 + y0 * srcWidth) * bpp];
-					if (rx0 != 0.0f && ry0 != 0.0f)
-					{
-						x1 = hmin(x0 + 1, srcWidth - 1);
-						rx1 = 1.0f - rx0;
-						ctr = &srcData[(x1 + y0 * srcWidth) * bpp];
-						cbl = &srcData[(x0 + y1 * srcWidth) * bpp];
-						cbr = &srcData[(x1 + y1 * srcWidth) * bpp];
-						dest[0] = (unsigned char)(((ctl[0] * ry1 + cbl[0] * ry0) * rx1 + (ctr[0] * ry1 + cbr[0] * ry0) * rx0));
-						dest[1] = (unsigned char)(((ctl[1] * ry1 + cbl[1] * ry0) * rx1 + (ctr[1] * ry1 + cbr[1] * ry0) * rx0));
-						dest[2] = (unsigned char)(((ctl[2] * ry1 + cbl[2] * ry0) * rx1 + (ctr[2] * ry1 + cbr[2] * ry0) * rx0));
-					}
-					else if (rx0 != 0.0f)
-					{
-						x1 = hmin(x0 + 1, srcWidth - 1);
-						rx1 = 1.0f - rx0;
-						ctr = &srcData[(x1 + y0 * srcWidth) * bpp];
-						dest[0] = (unsigned char)((ctl[0] * rx1 + ctr[0] * rx0));
-						dest[1] = (unsigned char)((ctl[1] * rx1 + ctr[1] * rx0));
-						dest[2] = (unsigned char)((ctl[2] * rx1 + ctr[2] * rx0));
-					}
-					else if (ry0 != 0.0f)
-					{
-						cbl = &srcData[(x0 + y1 * srcWidth) * bpp];
-						dest[0] = (unsigned char)((ctl[0] * ry1 + cbl[0] * ry0));
-						dest[1] = (unsigned char)((ctl[1] * ry1 + cbl[1] * ry0));
-						dest[2] = (unsigned char)((ctl[2] * ry1 + cbl[2] * ry0));
-					}
-					else
+					int x = 0;
+					int y = 0;
+					int da = -1;
+					Image::_getFormatIndices(destFormat, NULL, NULL, NULL, &da);
+					for_iterx (y, 0, sh)
 					{
-						dest[0] = ctl[0];
-						dest[1] = ctl[1];
-						dest[2] = ctl[2];
+						for_iterx (x, 0, sw)
+						{
+							destData[((dx + x) + (dy + y) * destWidth) * destBpp + da] = srcData[((sx + x) + (sy + y) * srcWidth) * srcBpp];
+						}
 					}
 				}
+				return true;
 			}
-			result = true;
+			return false;
+		}
+		unsigned char* p = &destData[(dx + dy * destWidth) * destBpp];
+		if (sx == 0 && dx == 0 && srcWidth == destWidth && sw == destWidth)
+		{
+			Image::convertToFormat(sw, sh, &srcData[(sx + sy * srcWidth) * srcBpp], srcFormat, &p, destFormat, false);
 		}
-		else if (bpp == 4)
+		else
 		{
-			for_iterx (y, 0, dh)
+			for_iter (j, 0, sh)
 			{
-				srcY = sy + y * fh;
-				y0 = (int)srcY;
-				ry0 = srcY - y0;
-				y1 = hmin(y0 + 1, srcHeight - 1);
-				ry1 = 1.0f - ry0;
-				for_iterx (x, 0, dw)
-				{
-					dest = &destData[((dx + x) + (dy + y) * destWidth) * bpp];
-					srcX = sx + x * fw;
-					x0 = (int)srcX;
-					rx0 = srcX - x0;
-					// linear interpolation
-					ctl = &srcData[(x0 + y0 * srcWidth) * bpp];
-					if (rx0 != 0.0f && ry0 != 0.0f)
-					{
-						x1 = hmin(x0 + 1, srcWidth - 1);
-						rx1 = 1.0f - rx0;
-						ctr = &srcData[(x1 + y0 * srcWidth) * bpp];
-						cbl = &srcData[(x0 + y1 * srcWidth) * bpp];
-						cbr = &srcData[(x1 + y1 * srcWidth) * bpp];
-						dest[0] = (unsigned char)(((ctl[0] * ry1 + cbl[0] * ry0) * rx1 + (ctr[0] * ry1 + cbr[0] * ry0) * rx0));
-						dest[1] = (unsigned char)(((ctl[1] * ry1 + cbl[1] * ry0) * rx1 + (ctr[1] * ry1 + cbr[1] * ry0) * rx0));
-						dest[2] = (unsigned char)(((ctl[2] * ry1 + cbl[2] * ry0) * rx1 + (ctr[2] * ry1 + cbr[2] * ry0) * rx0));
-						dest[3] = (unsigned char)(((ctl[3] * ry1 + cbl[3] * ry0) * rx1 + (ctr[3] * ry1 + cbr[3] * ry0) * rx0));
-					}
-					else if (rx0 != 0.0f)
-					{
-						x1 = hmin(x0 + 1, srcWidth - 1);
-						rx1 = 1.0f - rx0;
-						ctr = &srcData[(x1 + y0 * srcWidth) * bpp];
-						dest[0] = (unsigned char)((ctl[0] * rx1 + ctr[0] * rx0));
-						dest[1] = (unsigned char)((ctl[1] * rx1 + ctr[1] * rx0));
-						dest[2] = (unsigned char)((ctl[2] * rx1 + ctr[2] * rx0));
-						dest[3] = (unsigned char)((ctl[3] * rx1 + ctr[3] * rx0));
-					}
-					else if (ry0 != 0.0f)
-					{
-						cbl = &srcData[(x0 + y1 * srcWidth) * bpp];
-						dest[0] = (unsigned char)((ctl[0] * ry1 + cbl[0] * ry0));
-						dest[1] = (unsigned char)((ctl[1] * ry1 + cbl[1] * ry0));
-						dest[2] = (unsigned char)((ctl[2] * ry1 + cbl[2] * ry0));
-						dest[3] = (unsigned char)((ctl[3] * ry1 + cbl[3] * ry0));
-					}
-					else
-					{
-						dest[0] = ctl[0];
-						dest[1] = ctl[1];
-						dest[2] = ctl[2];
-						dest[3] = ctl[3];
-					}
-				}
+				Image::convertToFormat(sw, 1, &srcData[(sx + (sy + j) * srcWidth) * srcBpp], srcFormat, &p, destFormat, false);
+				p += destWidth * destBpp;
 			}
-			result = true;
 		}
-		if (createNew)
+		return true;
+	}
+
+	bool Image::writeStretch(int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh, unsigned char* srcData, int srcWidth, int srcHeight, Format srcFormat,
+		unsigned char* destData, int destWidth, int destHeight, Format destFormat)
+	{
+		if (!Image::correctRect(sx, sy, sw, sh, srcWidth, srcHeight, dx, dy, dw, dh, destWidth, destHeight))
+		{
+			return false;
+		}
+		if (sw == dw && sh == dh)
+		{
+			return Image::write(sx, sy, sw, sh, dx, dy, srcData, srcWidth, srcHeight, srcFormat, destData, destWidth, destHeight, destFormat);
+		}
+		int bpp = Image::getFormatBpp(srcFormat);
+		if (bpp == 0)
 		{
-			delete[] srcData;
+			return false;
 		}
-		return result;
+		ResampleTables tables(sx, sy, sw, sh, dw, dh, bpp);
+		BandOperation operation(BandOperation::STRETCH, sx, sy, sw, sh, srcData, srcWidth, srcHeight, srcFormat);
+		operation.setDestination(dx, dy, destData, destWidth, destHeight, destFormat);
+		operation.dw = dw;
+		operation.dh = dh;
+		operation.tables = &tables;
+		bool result = true;
+		if (ImageParallel::execute(dh, dw * dh, &Image::_processBand, &operation, result))
+		{
+			return result;
+		}
+		return Image::_stretch(sx, sy, sw, sh, dx, dy, dw, dh, srcData, srcWidth, srcHeight, srcFormat, destData, destWidth, destHeight, destFormat, false, 255, &tables, 0, dh);
 	}
 
 	bool Image::blit(int sx, int sy, int sw, int sh, int dx, int dy, unsigned char* srcData, int srcWidth, int srcHeight, Format srcFormat,
@@ -1107,6 +1507,14 @@ namespace april
 		{
 			return true;
 		}
+		BandOperation operation(BandOperation::BLIT, sx, sy, sw, sh, srcData, srcWidth, srcHeight, srcFormat);
+		operation.setDestination(dx, dy, destData, destWidth, destHeight, destFormat);
+		operation.alpha = alpha;
+		bool result = true;
+		if (ImageParallel::execute(sh, sw * sh, &Image::_processBand, &operation, result))
+		{
+			return result;
+		}
 		int srcBpp = Image::getFormatBpp(srcFormat);
 		if (srcBpp == 1)
 		{
@@ -1140,235 +1548,218 @@ namespace april
 		{
 			return false;
 		}
-		unsigned char* src = NULL;
-		unsigned char* dest = NULL;
-		unsigned char a1;
-		unsigned int c;
-		int x = 0;
-		int y = 0;
-		a1 = 255 - alpha;
+		int channels[4] = {BLEND_SKIP, BLEND_SKIP, BLEND_SKIP, BLEND_SKIP};
 		if (destBpp == 1)
 		{
-			for_iterx (y, 0, sh)
-			{
-				for_iterx (x, 0, sw)
-				{
-					src = &srcData[((sx + x) + (sy + y) * srcWidth) * srcBpp];
-					dest = &destData[((dx + x) + (dy + y) * destWidth) * destBpp];
-					dest[0] = (src[0] * alpha + dest[0] * a1) / 255;
-				}
-			}
-			return true;
+			channels[0] = 0;
 		}
-		int dr = -1;
-		int dg = -1;
-		int db = -1;
-		if (destBpp == 3 || !CHECK_ALPHA_FORMAT(destFormat)) // 3 BPP and 4 BPP without alpha
+		else
 		{
-			if (srcFormat != FORMAT_ALPHA)
+			int dr = -1;
+			int dg = -1;
+			int db = -1;
+			int da = -1;
+			if (destBpp == 3 || (destBpp == 4 && !CHECK_ALPHA_FORMAT(destFormat))) // 3 BPP and 4 BPP without alpha
 			{
-				Image::_getFormatIndices(destFormat, &dr, &dg, &db, NULL);
-				for_iterx (y, 0, sh)
+				if (srcFormat == FORMAT_ALPHA)
 				{
-					for_iterx (x, 0, sw)
-					{
-						src = &srcData[((sx + x) + (sy + y) * srcWidth) * srcBpp];
-						dest = &destData[((dx + x) + (dy + y) * destWidth) * destBpp];
-						c = src[0] * alpha;
-						dest[dr] = (c + dest[dr] * a1) / 255;
-						dest[dg] = (c + dest[dg] * a1) / 255;
-						dest[db] = (c + dest[db] * a1) / 255;
-					}
+					return true;
 				}
+				Image::_getFormatIndices(destFormat, &dr, &dg, &db, NULL);
+				channels[dr] = channels[dg] = channels[db] = 0;
 			}
-			return true;
-		}
-		int da = -1;
-		if (destBpp == 4) // 4 BPP with alpha
-		{
-			Image::_getFormatIndices(destFormat, &dr, &dg, &db, &da);
-			if (srcFormat != FORMAT_ALPHA)
+			else if (destBpp == 4) // 4 BPP with alpha
 			{
-				for_iterx (y, 0, sh)
+				Image::_getFormatIndices(destFormat, &dr, &dg, &db, &da);
+				if (srcFormat != FORMAT_ALPHA)
 				{
-					for_iterx (x, 0, sw)
-					{
-						src = &srcData[((sx + x) + (sy + y) * srcWidth) * srcBpp];
-						dest = &destData[((dx + x) + (dy + y) * destWidth) * destBpp];
-						c = src[0] * alpha;
-						dest[dr] = (c + dest[dr] * a1) / 255;
-						dest[dg] = (c + dest[dg] * a1) / 255;
-						dest[db] = (c + dest[db] * a1) / 255;
-						dest[da] = alpha + dest[da] * a1 / 255;
-					}
+					channels[dr] = channels[dg] = channels[db] = 0;
+					channels[da] = BLEND_OPAQUE;
+				}
+				else
+				{
+					channels[da] = 0;
 				}
 			}
 			else
 			{
-				for_iterx (y, 0, sh)
-				{
-					for_iterx (x, 0, sw)
-					{
-						src = &srcData[((sx + x) + (sy + y) * srcWidth) * srcBpp];
-						dest = &destData[((dx + x) + (dy + y) * destWidth) * destBpp];
-						dest[da] = (src[0] * alpha + dest[da] * a1) / 255;
-					}
-				}
+				return false;
 			}
-			return true;
 		}
-		return false;
+		Image::_blendRows(sw, sh, &srcData[(sx + sy * srcWidth) * srcBpp], srcWidth * srcBpp, srcBpp, -1,
+			&destData[(dx + dy * destWidth) * destBpp], destWidth * destBpp, destBpp, channels, alpha);
+		return true;
 	}
 
 	bool Image::_blitFrom3Bpp(int sx, int sy, int sw, int sh, int dx, int dy, unsigned char* srcData, int srcWidth, int srcHeight, Format srcFormat, unsigned char* destData, int destWidth, int destHeight, Format destFormat, unsigned char alpha)
 	{
 		static int srcBpp = 3;
 		int destBpp = Image::getFormatBpp(destFormat);
-		unsigned char* src = NULL;
-		unsigned char* dest = NULL;
-		unsigned char a1;
-		int x = 0;
-		int y = 0;
-		a1 = 255 - alpha;
+		int channels[4] = {BLEND_SKIP, BLEND_SKIP, BLEND_SKIP, BLEND_SKIP};
 		int sr = -1;
-		if (destBpp == 1)
-		{
-			Image::_getFormatIndices(srcFormat, &sr, NULL, NULL, NULL);
-			for_iterx (y, 0, sh)
-			{
-				for_iterx (x, 0, sw)
-				{
-					src = &srcData[((sx + x) + (sy + y) * srcWidth) * srcBpp];
-					dest = &destData[((dx + x) + (dy + y) * destWidth) * destBpp];
-					dest[0] = (src[sr] * alpha + dest[0] * a1) / 255;
-				}
-			}
-			return true;
-		}
 		int sg = -1;
 		int sb = -1;
 		Image::_getFormatIndices(srcFormat, &sr, &sg, &sb, NULL);
-		int dr = -1;
-		int dg = -1;
-		int db = -1;
-		if (destBpp == 3 || !CHECK_ALPHA_FORMAT(destFormat)) // 3 BPP and 4 BPP without alpha
+		if (destBpp == 1)
 		{
-			Image::_getFormatIndices(destFormat, &dr, &dg, &db, NULL);
-			for_iterx (y, 0, sh)
-			{
-				for_iterx (x, 0, sw)
-				{
-					src = &srcData[((sx + x) + (sy + y) * srcWidth) * srcBpp];
-					dest = &destData[((dx + x) + (dy + y) * destWidth) * destBpp];
-					dest[dr] = (src[sr] * alpha + dest[dr] * a1) / 255;
-					dest[dg] = (src[sg] * alpha + dest[dg] * a1) / 255;
-					dest[db] = (src[sb] * alpha + dest[db] * a1) / 255;
-				}
-			}
-			return true;
+			channels[0] = sr;
 		}
-		int da = -1;
-		if (destBpp == 4) // 4 BPP with alpha
+		else
 		{
-			Image::_getFormatIndices(destFormat, &dr, &dg, &db, &da);
-			for_iterx (y, 0, sh)
+			int dr = -1;
+			int dg = -1;
+			int db = -1;
+			int da = -1;
+			if (destBpp == 3 || (destBpp == 4 && !CHECK_ALPHA_FORMAT(destFormat))) // 3 BPP and 4 BPP without alpha
 			{
-				for_iterx (x, 0, sw)
-				{
-					src = &srcData[((sx + x) + (sy + y) * srcWidth) * srcBpp];
-					dest = &destData[((dx + x) + (dy + y) * destWidth) * destBpp];
-					dest[dr] = (src[sr] * alpha + dest[dr] * a1) / 255;
-					dest[dg] = (src[sg] * alpha + dest[dg] * a1) / 255;
-					dest[db] = (src[sb] * alpha + dest[db] * a1) / 255;
-					dest[da] = alpha + dest[da] * a1 / 255;
-				}
+				Image::_getFormatIndices(destFormat, &dr, &dg, &db, NULL);
 			}
-			return true;
+			else if (destBpp == 4) // 4 BPP with alpha
+			{
+				Image::_getFormatIndices(destFormat, &dr, &dg, &db, &da);
+				channels[da] = BLEND_OPAQUE;
+			}
+			else
+			{
+				return false;
+			}
+			channels[dr] = sr;
+			channels[dg] = sg;
+			channels[db] = sb;
 		}
-		return false;
+		Image::_blendRows(sw, sh, &srcData[(sx + sy * srcWidth) * srcBpp], srcWidth * srcBpp, srcBpp, -1,
+			&destData[(dx + dy * destWidth) * destBpp], destWidth * destBpp, destBpp, channels, alpha);
+		return true;
 	}
 	
 	bool Image::_blitFrom4Bpp(int sx, int sy, int sw, int sh, int dx, int dy, unsigned char* srcData, int srcWidth, int srcHeight, Format srcFormat, unsigned char* destData, int destWidth, int destHeight, Format destFormat, unsigned char alpha)
 	{
 		static int srcBpp = 4;
 		int destBpp = Image::getFormatBpp(destFormat);
-		unsigned char* src = NULL;
-		unsigned char* dest = NULL;
-		unsigned char a0;
-		unsigned char a1;
-		int x = 0;
-		int y = 0;
+		int channels[4] = {BLEND_SKIP, BLEND_SKIP, BLEND_SKIP, BLEND_SKIP};
 		int sr = -1;
+		int sg = -1;
+		int sb = -1;
 		int sa = -1;
+		Image::_getFormatIndices(srcFormat, &sr, &sg, &sb, &sa);
 		if (destBpp == 1)
 		{
-			Image::_getFormatIndices(srcFormat, &sr, NULL, NULL, &sa);
-			for_iterx (y, 0, sh)
+			channels[0] = sr;
+		}
+		else
+		{
+			int dr = -1;
+			int dg = -1;
+			int db = -1;
+			int da = -1;
+			if (destBpp == 3 || (destBpp == 4 && !CHECK_ALPHA_FORMAT(destFormat))) // 3 BPP and 4 BPP without alpha
 			{
-				for_iterx (x, 0, sw)
-				{
-					src = &srcData[((sx + x) + (sy + y) * srcWidth) * srcBpp];
-					dest = &destData[((dx + x) + (dy + y) * destWidth) * destBpp];
-					a0 = src[sa] * alpha / 255;
-					if (a0 > 0)
-					{
-						dest[0] = (src[sr] * a0 + dest[0] * (255 - a0)) / 255;
-					}
-				}
+				Image::_getFormatIndices(destFormat, &dr, &dg, &db, NULL);
 			}
-			return true;
+			else if (destBpp == 4) // 4 BPP with alpha
+			{
+				Image::_getFormatIndices(destFormat, &dr, &dg, &db, &da);
+				channels[da] = BLEND_OPAQUE;
+			}
+			else
+			{
+				return false;
+			}
+			channels[dr] = sr;
+			channels[dg] = sg;
+			channels[db] = sb;
 		}
-		int sg = -1;
-		int sb = -1;
-		Image::_getFormatIndices(srcFormat, &sr, &sg, &sb, &sa);
-		int dr = -1;
-		int dg = -1;
-		int db = -1;
-		if (destBpp == 3 || !CHECK_ALPHA_FORMAT(destFormat)) // 3 BPP and 4 BPP without alpha
+		Image::_blendRows(sw, sh, &srcData[(sx + sy * srcWidth) * srcBpp], srcWidth * srcBpp, srcBpp, sa,
+			&destData[(dx + dy * destWidth) * destBpp], destWidth * destBpp, destBpp, channels, alpha);
+		return true;
+	}
+
+	void Image::_blendRows(int w, int h, unsigned char* srcData, int srcStride, int srcBpp, int srcAlpha, unsigned char* destData, int destStride, int destBpp, int* channels, unsigned char alpha)
+	{
+		// the SIMD kernels handle the leading 16 pixel groups of every row, the rest is done here
+		int done = Image::_blendRowsSimd(w, h, srcData, srcStride, srcBpp, srcAlpha, destData, destStride, destBpp, channels, alpha);
+		if (done >= w)
+		{
+			return;
+		}
+		// blended channels are split into source channels and the one that gets an opaque alpha blended in
+		int count = 0;
+		int destIndices[4] = {0, 0, 0, 0};
+		int srcIndices[4] = {0, 0, 0, 0};
+		int opaque = -1;
+		for_iter (c, 0, destBpp)
 		{
-			Image::_getFormatIndices(destFormat, &dr, &dg, &db, NULL);
-			for_iterx (y, 0, sh)
+			if (channels[c] >= 0)
 			{
-				for_iterx (x, 0, sw)
-				{
-					src = &srcData[((sx + x) + (sy + y) * srcWidth) * srcBpp];
-					dest = &destData[((dx + x) + (dy + y) * destWidth) * destBpp];
-					a0 = src[sa] * alpha / 255;
-					if (a0 > 0)
-					{
-						a1 = 255 - a0;
-						dest[dr] = (src[sr] * a0 + dest[dr] * a1) / 255;
-						dest[dg] = (src[sg] * a0 + dest[dg] * a1) / 255;
-						dest[db] = (src[sb] * a0 + dest[db] * a1) / 255;
-					}
-				}
+				destIndices[count] = c;
+				srcIndices[count] = channels[c];
+				++count;
+			}
+			else if (channels[c] == BLEND_OPAQUE)
+			{
+				opaque = c;
 			}
-			return true;
 		}
-		int da = -1;
-		if (destBpp == 4) // 4 BPP with alpha
+		bool rgb = (count == 3);
+		int d0 = destIndices[0];
+		int d1 = destIndices[1];
+		int d2 = destIndices[2];
+		int s0 = srcIndices[0];
+		int s1 = srcIndices[1];
+		int s2 = srcIndices[2];
+		unsigned char* src = NULL;
+		unsigned char* dest = NULL;
+		unsigned int a0 = alpha;
+		unsigned int a1 = 0;
+		for_iter (j, 0, h)
 		{
-			Image::_getFormatIndices(destFormat, &dr, &dg, &db, &da);
-			for_iterx (y, 0, sh)
+			src = &srcData[j * srcStride + done * srcBpp];
+			dest = &destData[j * destStride + done * destBpp];
+			for_iter (i, done, w)
 			{
-				for_iterx (x, 0, sw)
+				if (srcAlpha >= 0)
+				{
+					a0 = DIV255(src[srcAlpha] * alpha);
+				}
+				if (a0 == 255) // fully opaque
+				{
+					if (rgb)
+					{
+						dest[d0] = src[s0];
+						dest[d1] = src[s1];
+						dest[d2] = src[s2];
+					}
+					else if (count > 0)
+					{
+						dest[d0] = src[s0];
+					}
+					if (opaque >= 0)
+					{
+						dest[opaque] = 255;
+					}
+				}
+				else if (a0 > 0) // fully transparent pixels remain untouched
 				{
-					src = &srcData[((sx + x) + (sy + y) * srcWidth) * srcBpp];
-					dest = &destData[((dx + x) + (dy + y) * destWidth) * destBpp];
-					a0 = src[sa] * alpha / 255;
-					if (a0 > 0)
+					a1 = 255 - a0;
+					if (rgb)
 					{
-						a1 = (255 - a0);
-						dest[dr] = (src[sr] * a0 + dest[dr] * a1) / 255;
-						dest[dg] = (src[sg] * a0 + dest[dg] * a1) / 255;
-						dest[db] = (src[sb] * a0 + dest[db] * a1) / 255;
-						dest[da] = a0 + dest[da] * a1 / 255;
+						dest[d0] = DIV255(src[s0] * a0 + dest[d0] * a1);
+						dest[d1] = DIV255(src[s1] * a0 + dest[d1] * a1);
+						dest[d2] = DIV255(src[s2] * a0 + dest[d2] * a1);
+					}
+					else if (count > 0)
+					{
+						dest[d0] = DIV255(src[s0] * a0 + dest[d0] * a1);
+					}
+					if (opaque >= 0)
+					{
+						dest[opaque] = a0 + DIV255(dest[opaque] * a1);
 					}
 				}
+				src += srcBpp;
+				dest += destBpp;
 			}
-			return true;
 		}
-		return false;
 	}
 
 	bool Image::blitStretch(int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh, unsigned char* srcData, int srcWidth, int srcHeight, Format srcFormat,
@@ -1380,15 +1771,103 @@ namespace april
 		}
 		if (sw == dw && sh == dh)
 		{
-			return Image::blit(sx, sy, sw, sh, dx, dh, srcData, srcWidth, srcHeight, srcFormat, destData, destWidth, destHeight, destFormat, alpha);
+			return Image::blit(sx, sy, sw, sh, dx, dy, srcData, srcWidth, srcHeight, srcFormat, destData, destWidth, destHeight, destFormat, alpha);
 		}
-		unsigned char* stretched = new unsigned char[dw * dh * Image::getFormatBpp(srcFormat)];
-		bool result = Image::writeStretch(sx, sy, sw, sh, 0, 0, dw, dh, srcData, srcWidth, srcHeight, srcFormat, stretched, dw, dh, srcFormat);
-		if (result)
+		// it's invisible anyway, so let's say it's successful
+		if (alpha == 0)
+		{
+			return true;
+		}
+		int bpp = Image::getFormatBpp(srcFormat);
+		if (bpp == 0)
+		{
+			return false;
+		}
+		ResampleTables tables(sx, sy, sw, sh, dw, dh, bpp);
+		BandOperation operation(BandOperation::STRETCH, sx, sy, sw, sh, srcData, srcWidth, srcHeight, srcFormat);
+		operation.setDestination(dx, dy, destData, destWidth, destHeight, destFormat);
+		operation.dw = dw;
+		operation.dh = dh;
+		operation.blend = true;
+		operation.alpha = alpha;
+		operation.tables = &tables;
+		bool result = true;
+		if (ImageParallel::execute(dh, dw * dh, &Image::_processBand, &operation, result))
+		{
+			return result;
+		}
+		return Image::_stretch(sx, sy, sw, sh, dx, dy, dw, dh, srcData, srcWidth, srcHeight, srcFormat, destData, destWidth, destHeight, destFormat, true, alpha, &tables, 0, dh);
+	}
+
+	bool Image::_stretch(int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh, unsigned char* srcData, int srcWidth, int srcHeight, Format srcFormat,
+		unsigned char* destData, int destWidth, int destHeight, Format destFormat, bool blend, unsigned char alpha, void* tables, int firstRow, int rowCount)
+	{
+		int bpp = Image::getFormatBpp(srcFormat);
+		ResampleTables* resampleTables = (ResampleTables*)tables;
+		int* xIndices = resampleTables->xIndices;
+		short* xWeights = resampleTables->xWeights;
+		int xTaps = resampleTables->xTaps;
+		int* yIndices = resampleTables->yIndices;
+		short* yWeights = resampleTables->yWeights;
+		int yTaps = resampleTables->yTaps;
+		// horizontally filtered source rows are cached in a ring since consecutive destination rows share most of them
+		int rowSize = dw * bpp;
+		short* rows = new short[rowSize * yTaps];
+		int* rowSources = new int[yTaps];
+		short** taps = new short*[yTaps];
+		memset(rowSources, -1, yTaps * sizeof(int));
+		bool direct = (!blend && srcFormat == destFormat);
+		unsigned char* stretched = (direct ? NULL : new unsigned char[rowSize]);
+		unsigned char* out = NULL;
+		int source = 0;
+		int slot = 0;
+		int done = 0;
+		int value = 0;
+		bool result = true;
+		for_iter (y, firstRow, firstRow + rowCount)
+		{
+			for_iter (t, 0, yTaps)
+			{
+				source = yIndices[y * yTaps + t];
+				slot = source % yTaps;
+				taps[t] = &rows[slot * rowSize];
+				if (rowSources[slot] != source)
+				{
+					_resampleRow(&srcData[source * srcWidth * bpp], bpp, dw, xIndices, xWeights, xTaps, taps[t]);
+					rowSources[slot] = source;
+				}
+			}
+			out = (direct ? &destData[(dx + (dy + y) * destWidth) * bpp] : stretched);
+			done = Image::_resampleColumnsSimd(rowSize, taps, &yWeights[y * yTaps], yTaps, RESAMPLE_SHIFT, out);
+			for_iter (i, done, rowSize)
+			{
+				value = 0;
+				for_iter (t, 0, yTaps)
+				{
+					value += taps[t][i] * yWeights[y * yTaps + t];
+				}
+				out[i] = (unsigned char)((value + RESAMPLE_HALF) >> RESAMPLE_SHIFT);
+			}
+			if (blend)
+			{
+				result = Image::blit(0, 0, dw, 1, dx, dy + y, stretched, dw, 1, srcFormat, destData, destWidth, destHeight, destFormat, alpha);
+			}
+			else if (!direct)
+			{
+				result = Image::write(0, 0, dw, 1, dx, dy + y, stretched, dw, 1, srcFormat, destData, destWidth, destHeight, destFormat);
+			}
+			if (!result)
+			{
+				break;
+			}
+		}
+		if (stretched != NULL)
 		{
-			result = Image::blit(0, 0, dw, dh, dx, dy, stretched, dw, dh, srcFormat, destData, destWidth, destHeight, destFormat, alpha);
+			delete[] stretched;
 		}
-		delete[] stretched;
+		delete[] taps;
+		delete[] rowSources;
+		delete[] rows;
 		return result;
 	}
 
@@ -1408,21 +1887,98 @@ namespace april
 		{
 			return true;
 		}
+		BandOperation operation(BandOperation::ROTATE_HUE, x, y, w, h, srcData, srcWidth, srcHeight, srcFormat);
+		operation.value = degrees;
+		bool result = true;
+		if (ImageParallel::execute(h, w * h, &Image::_processBand, &operation, result))
+		{
+			return result;
+		}
 		int sr = -1;
 		int sg = -1;
 		int sb = -1;
 		Image::_getFormatIndices(srcFormat, &sr, &sg, &sb, NULL);
-		float _h;
-		float _s;
-		float _l;
-		int i;
+		// rotating the hue keeps the lowest and highest channel value so only the middle value has to be calculated, the hue is a
+		// 16.16 fixed point position on a hue circle with a length of 6 * delta, the result is within 1 per channel of going through
+		// april::rgbToHsl() and april::hslToRgb() (they can round exact .5 values either way due to float precision)
+		int offset = (int)hround(range * 6.0f * 65536.0f);
+		unsigned char* p = NULL;
+		int r = 0;
+		int g = 0;
+		int b = 0;
+		int min = 0;
+		int max = 0;
+		int delta = 0;
+		int position = 0;
+		int sector = 0;
+		int middle = 0;
 		for_iter (dy, 0, h)
 		{
+			p = &srcData[(x + (y + dy) * srcWidth) * srcBpp];
 			for_iter (dx, 0, w)
 			{
-				i = ((x + dx) + (y + dy) * srcWidth) * srcBpp;
-				april::rgbToHsl(srcData[i + sr], srcData[i + sg], srcData[i + sb], &_h, &_s, &_l);
-				april::hslToRgb(hmodf(_h + range, 1.0f), _s, _l, &srcData[i + sr], &srcData[i + sg], &srcData[i + sb]);
+				r = p[sr];
+				g = p[sg];
+				b = p[sb];
+				max = hmax(hmax(r, g), b);
+				min = hmin(hmin(r, g), b);
+				delta = max - min;
+				if (delta > 0)
+				{
+					if (max == r)
+					{
+						position = (g >= b ? g - b : g - b + delta * 6);
+					}
+					else if (max == g)
+					{
+						position = b - r + delta * 2;
+					}
+					else
+					{
+						position = r - g + delta * 4;
+					}
+					position = (position << 16) + offset * delta;
+					if (position >= (delta * 6) << 16)
+					{
+						position -= (delta * 6) << 16;
+					}
+					sector = position / (delta << 16);
+					middle = (position - sector * (delta << 16) + 0x8000) >> 16;
+					switch (sector)
+					{
+					case 0:
+						p[sr] = max;
+						p[sg] = min + middle;
+						p[sb] = min;
+						break;
+					case 1:
+						p[sr] = max - middle;
+						p[sg] = max;
+						p[sb] = min;
+						break;
+					case 2:
+						p[sr] = min;
+						p[sg] = max;
+						p[sb] = min + middle;
+						break;
+					case 3:
+						p[sr] = min;
+						p[sg] = max - middle;
+						p[sb] = max;
+						break;
+					case 4:
+						p[sr] = min + middle;
+						p[sg] = min;
+						p[sb] = max;
+						break;
+					default:
+						p[sr] = max;
+						p[sg] = min;
+						p[sb] = max - middle;
+						break;
+					}
+				}
+				p += srcBpp;
 			}
 		}
 		return true;
@@ -1439,21 +1995,55 @@ namespace april
 		{
 			return true;
 		}
+		BandOperation operation(BandOperation::SATURATE, x, y, w, h, srcData, srcWidth, srcHeight, srcFormat);
+		operation.value = factor;
+		bool result = true;
+		if (ImageParallel::execute(h, w * h, &Image::_processBand, &operation, result))
+		{
+			return result;
+		}
 		int sr = -1;
 		int sg = -1;
 		int sb = -1;
 		Image::_getFormatIndices(srcFormat, &sr, &sg, &sb, NULL);
-		float _h;
-		float _s;
-		float _l;
-		int i;
+		// scaling the saturation scales the distance of each channel from the lightness by the same 16.16 fixed point factor, the result
+		// is within 1 per channel of going through april::rgbToHsl() and april::hslToRgb() (they can round exact .5 values either way
+		// due to float precision)
+		int scale = (int)hround(hclamp(factor, 0.0f, 510.0f) * 65536.0f);
+		unsigned char* p = NULL;
+		int r = 0;
+		int g = 0;
+		int b = 0;
+		int sum = 0;
+		int delta = 0;
+		int limit = 0;
 		for_iter (dy, 0, h)
 		{
+			p = &srcData[(x + (y + dy) * srcWidth) * srcBpp];
 			for_iter (dx, 0, w)
 			{
-				i = ((x + dx) + (y + dy) * srcWidth) * srcBpp;
-				april::rgbToHsl(srcData[i + sr], srcData[i + sg], srcData[i + sb], &_h, &_s, &_l);
-				april::hslToRgb(_h, hclamp(_s * factor, 0.0f, 1.0f), _l, &srcData[i + sr], &srcData[i + sg], &srcData[i + sb]);
+				r = p[sr];
+				g = p[sg];
+				b = p[sb];
+				delta = hmax(hmax(r, g), b) - hmin(hmin(r, g), b);
+				if (delta > 0)
+				{
+					sum = hmax(hmax(r, g), b) + hmin(hmin(r, g), b);
+					if (scale > 0)
+					{
+						// the saturation reaches 1 once the range of the channels hits 0 or 255
+						limit = hmin(scale, (hmin(sum, 510 - sum) << 16) / delta);
+						// 2 * lightness is used so everything stays integral
+						p[sr] = (unsigned char)(((sum << 16) + (r * 2 - sum) * limit + 0x10000) >> 17);
+						p[sg] = (unsigned char)(((sum << 16) + (g * 2 - sum) * limit + 0x10000) >> 17);
+						p[sb] = (unsigned char)(((sum << 16) + (b * 2 - sum) * limit + 0x10000) >> 17);
+					}
+					else // fully desaturated pixels use the lightness rounded down, the same as april::hslToRgb() does
+					{
+						p[sr] = p[sg] = p[sb] = (unsigned char)(sum >> 1);
+					}
+				}
+				p += srcBpp;
 			}
 		}
 		return true;
@@ -1465,6 +2055,12 @@ namespace april
 		{
 			return false;
 		}
+		BandOperation operation(BandOperation::INVERT, x, y, w, h, srcData, srcWidth, srcHeight, srcFormat);
+		bool result = true;
+		if (ImageParallel::execute(h, w * h, &Image::_processBand, &operation, result))
+		{
+			return result;
+		}
 		int i;
 		int srcBpp = Image::getFormatBpp(srcFormat);
 		if (srcBpp == 1)
@@ -1505,6 +2101,15 @@ namespace april
 		int srcBpp = Image::getFormatBpp(srcFormat);
 		if (srcBpp == 1 || srcBpp == 3 || srcBpp == 4)
 		{
+			BandOperation operation(BandOperation::INSERT_ALPHA_MAP, 0, 0, w, h, srcData, w, h, srcFormat);
+			operation.setDestination(0, 0, destData, w, h, destFormat);
+			operation.median = median;
+			operation.ambiguity = ambiguity;
+			bool result = true;
+			if (ImageParallel::execute(h, w * h, &Image::_processBand, &operation, result))
+			{
+				return result;
+			}
 			int destBpp = Image::getFormatBpp(destFormat);
 			int sr = -1;
 			Image::_getFormatIndices(srcFormat, &sr, NULL, NULL, NULL);
@@ -1571,6 +2176,33 @@ namespace april
 		{
 			return true;
 		}
+		int destBpp = Image::getFormatBpp(destFormat);
+		if ((srcBpp == 1 || srcBpp == 3 || srcBpp == 4) && (destBpp == 1 || destBpp == 3 || destBpp == 4) && ImageParallel::isAvailable(h, w * h))
+		{
+			// the bands need to write into the same buffer so it has to be created beforehand
+			bool createData = (*destData == NULL);
+			if (createData)
+			{
+				*destData = new unsigned char[w * h * destBpp];
+			}
+			BandOperation operation(BandOperation::CONVERT, 0, 0, w, h, srcData, w, h, srcFormat);
+			operation.setDestination(0, 0, *destData, w, h, destFormat);
+			bool result = true;
+			if (ImageParallel::execute(h, w * h, &Image::_processBand, &operation, result))
+			{
+				if (!result && createData)
+				{
+					delete[] *destData;
+					*destData = NULL;
+				}
+				return result;
+			}
+			if (createData)
+			{
+				delete[] *destData;
+				*destData = NULL;
+			}
+		}
 		if (srcBpp == 1)
 		{
 			if (Image::_convertFrom1Bpp(w, h, srcData, srcFormat, destData, destFormat))
@@ -1604,6 +2236,10 @@ namespace april
 		{
 			*destData = new unsigned char[w * h * destBpp];
 		}
+		if (Image::_convertSimd(w * h, srcData, srcFormat, *destData, destFormat))
+		{
+			return true;
+		}
 		if (destBpp == 1)
 		{
 			memcpy(*destData, srcData, w * h * destBpp);
@@ -1657,6 +2293,10 @@ namespace april
 		{
 			*destData = new unsigned char[w * h * destBpp];
 		}
+		if (Image::_convertSimd(w * h, srcData, srcFormat, *destData, destFormat))
+		{
+			return true;
+		}
 		int x = 0;
 		int y = 0;
 		if (destBpp == 1)
@@ -1736,6 +2376,10 @@ namespace april
 		{
 			*destData = new unsigned char[w * h * destBpp];
 		}
+		if (Image::_convertSimd(w * h, srcData, srcFormat, *destData, destFormat))
+		{
+			return true;
+		}
 		int x = 0;
 		int y = 0;
 		if (destBpp == 1)
@@ -6,6 +6,7 @@
 /// This program is free software; you can redistribute it and/or modify it under
 /// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
 
+#include <setjmp.h>
 #include <stdio.h>
 
 #include <hltypes/hlog.h>
@@ -22,67 +23,206 @@ extern "C"
 #include "april.h"
 #include "Image.h"
 
+#define APRIL_JPEG_BATCH_ROWS 16
+
+#define JPEG_MARKER_TEM 0x01
+#define JPEG_MARKER_SOF0 0xC0
+#define JPEG_MARKER_DHT 0xC4
+#define JPEG_MARKER_JPG 0xC8
+#define JPEG_MARKER_DAC 0xCC
+#define JPEG_MARKER_SOF15 0xCF
+#define JPEG_MARKER_RST0 0xD0
+#define JPEG_MARKER_RST7 0xD7
+#define JPEG_MARKER_SOI 0xD8
+#define JPEG_MARKER_EOI 0xD9
+#define JPEG_MARKER_SOS 0xDA
+#define JPEG_FRAME_HEADER_SIZE 5 // precision, height and width
+
 namespace april
 {
-	static bool hasError = false;
+	/// @brief Error state of a single decode so several images can be decoded in parallel.
+	struct JpegErrorManager
+	{
+		struct jpeg_error_mgr manager; // has to be first so libjpeg can use it as a regular error manager
+		jmp_buf jump;
+	};
 
 	static void onError(j_common_ptr cInfo)
 	{
 		char buffer[JMSG_LENGTH_MAX] = { '\0' };
 		(*cInfo->err->format_message)(cInfo, buffer);
 		hlog::error(logTag, buffer);
-		hasError = true;
+		// libjpeg can't continue after an error so control goes back to the decoding function
+		longjmp(((JpegErrorManager*)cInfo->err)->jump, 1);
+	}
+
+	static bool _getJpegColorSpace(Image::Format format, J_COLOR_SPACE& colorSpace)
+	{
+		switch (format)
+		{
+		case Image::FORMAT_RGB:			colorSpace = JCS_RGB;			return true;
+		case Image::FORMAT_GRAYSCALE:	colorSpace = JCS_GRAYSCALE;		return true;
+#ifdef JCS_EXTENSIONS
+		case Image::FORMAT_BGR:			colorSpace = JCS_EXT_BGR;		return true;
+		case Image::FORMAT_RGBX:		colorSpace = JCS_EXT_RGBX;		return true;
+		case Image::FORMAT_BGRX:		colorSpace = JCS_EXT_BGRX;		return true;
+		case Image::FORMAT_XRGB:		colorSpace = JCS_EXT_XRGB;		return true;
+		case Image::FORMAT_XBGR:		colorSpace = JCS_EXT_XBGR;		return true;
+#endif
+#ifdef JCS_ALPHA_EXTENSIONS
+		case Image::FORMAT_RGBA:		colorSpace = JCS_EXT_RGBA;		return true;
+		case Image::FORMAT_BGRA:		colorSpace = JCS_EXT_BGRA;		return true;
+		case Image::FORMAT_ARGB:		colorSpace = JCS_EXT_ARGB;		return true;
+		case Image::FORMAT_ABGR:		colorSpace = JCS_EXT_ABGR;		return true;
+#endif
+		default:
+			break;
+		}
+		return false;
 	}
 
-	Image* Image::_loadJpg(hsbase& stream, int size)
+	Image* Image::_loadJpg(hsbase& stream, int size, const DecodeOptions& options)
 	{
-		hasError = false;
 		// first read the whole data from the resource file
 		unsigned char* compressedData = new unsigned char[size];
 		stream.readRaw(compressedData, size);
+		Image* image = Image::_loadJpg(compressedData, size, options);
+		delete[] compressedData;
+		return image;
+	}
+
+	Image* Image::_loadJpg(unsigned char* data, int size, const DecodeOptions& options)
+	{
 		// read JPEG image from file data
 		struct jpeg_decompress_struct cInfo;
-		struct jpeg_error_mgr jErr;
-		cInfo.err = jpeg_std_error(&jErr);
-		cInfo.err->error_exit = &onError;
+		JpegErrorManager error;
+		cInfo.err = jpeg_std_error(&error.manager);
+		error.manager.error_exit = &onError;
 		jpeg_create_decompress(&cInfo);
-		jpeg_mem_src(&cInfo, compressedData, size);
-		jpeg_read_header(&cInfo, TRUE);
-		if (hasError)
+		unsigned char* volatile imageData = NULL; // volatile so it's still valid after longjmp()
+		if (setjmp(error.jump) != 0)
 		{
+			jpeg_destroy_decompress(&cInfo);
+			if (imageData != NULL)
+			{
+				delete[] imageData;
+			}
 			return NULL;
 		}
-		jpeg_start_decompress(&cInfo);
-		if (hasError)
+		jpeg_mem_src(&cInfo, data, size);
+		jpeg_read_header(&cInfo, TRUE);
+		// decoding directly into the requested format avoids an additional conversion pass
+		J_COLOR_SPACE colorSpace = JCS_RGB;
+		Image::Format format = options.getFormat(FORMAT_RGB);
+		if (format == FORMAT_INVALID || !_getJpegColorSpace(format, colorSpace))
 		{
-			jpeg_destroy_decompress(&cInfo);
-			return NULL;
+			format = FORMAT_RGB;
+			colorSpace = JCS_RGB;
+		}
+		cInfo.out_color_space = colorSpace;
+		int reducedWidth = cInfo.image_width;
+		int reducedHeight = cInfo.image_height;
+		Image::getReducedSize(cInfo.image_width, cInfo.image_height, options.maxWidth, options.maxHeight, reducedWidth, reducedHeight);
+		if (reducedWidth != (int)cInfo.image_width || reducedHeight != (int)cInfo.image_height)
+		{
+			// libjpeg scales in the DCT domain so the smallest scale that still covers the reduced size is decoded
+			cInfo.scale_denom = 8;
+			for (cInfo.scale_num = 1; cInfo.scale_num < 8; ++cInfo.scale_num)
+			{
+				jpeg_calc_output_dimensions(&cInfo);
+				if ((int)cInfo.output_width >= reducedWidth && (int)cInfo.output_height >= reducedHeight)
+				{
+					break;
+				}
+			}
 		}
-		unsigned char* imageData = new unsigned char[cInfo.output_width * cInfo.output_height * 3]; // JPEG is always RGB
-		unsigned char* ptr = NULL;
-		for_itert (unsigned int, i, 0, cInfo.output_height)
+		jpeg_start_decompress(&cInfo);
+		int rowSize = cInfo.output_width * Image::getFormatBpp(format);
+		imageData = new unsigned char[rowSize * cInfo.output_height];
+		// reading several rows at once reduces the per-call overhead of libjpeg
+		JSAMPROW rows[APRIL_JPEG_BATCH_ROWS];
+		int count = 0;
+		while (cInfo.output_scanline < cInfo.output_height)
 		{
-			ptr = imageData + i * cInfo.output_width * 3;
-			jpeg_read_scanlines(&cInfo, &ptr, 1);
-			if (hasError)
+			count = hmin((int)(cInfo.output_height - cInfo.output_scanline), APRIL_JPEG_BATCH_ROWS);
+			for_iter (i, 0, count)
 			{
-				jpeg_destroy_decompress(&cInfo);
-				delete[] compressedData;
-				return NULL;
+				rows[i] = imageData + (cInfo.output_scanline + i) * rowSize;
 			}
+			jpeg_read_scanlines(&cInfo, rows, count);
 		}
 		jpeg_finish_decompress(&cInfo);
 		jpeg_destroy_decompress(&cInfo);
-		delete[] compressedData;
 		// assign Image data
 		Image* image = new Image();
 		image->data = imageData;
 		image->w = cInfo.output_width;
 		image->h = cInfo.output_height;
-		image->format = Image::FORMAT_RGB; // JPEG is always RGB
+		image->format = format;
+		// the remaining difference to the reduced size is filtered properly
+		if (image->w != reducedWidth || image->h != reducedHeight)
+		{
+			unsigned char* reducedData = new unsigned char[reducedWidth * reducedHeight * Image::getFormatBpp(format)];
+			Image::writeStretch(0, 0, image->w, image->h, 0, 0, reducedWidth, reducedHeight, image->data, image->w, image->h, format, reducedData, reducedWidth, reducedHeight, format);
+			delete[] image->data;
+			image->data = reducedData;
+			image->w = reducedWidth;
+			image->h = reducedHeight;
+		}
 		return image;
 	}
 
+	bool Image::_decodeJpgColor(unsigned char* data, int size, unsigned char* destData, int destWidth, int destHeight, Image::Format destFormat)
+	{
+		int destBpp = Image::getFormatBpp(destFormat);
+		int red = 0;
+		int green = 1;
+		int blue = 2;
+		Image::_getFormatIndices(destFormat, &red, &green, &blue, NULL);
+		struct jpeg_decompress_struct cInfo;
+		JpegErrorManager error;
+		cInfo.err = jpeg_std_error(&error.manager);
+		error.manager.error_exit = &onError;
+		jpeg_create_decompress(&cInfo);
+		if (setjmp(error.jump) != 0)
+		{
+			jpeg_destroy_decompress(&cInfo);
+			return false;
+		}
+		jpeg_mem_src(&cInfo, data, size);
+		jpeg_read_header(&cInfo, TRUE);
+		cInfo.out_color_space = JCS_RGB;
+		jpeg_start_decompress(&cInfo);
+		// rows are allocated by libjpeg so they are freed by jpeg_destroy_decompress() even after an error
+		JSAMPARRAY rows = (*cInfo.mem->alloc_sarray)((j_common_ptr)&cInfo, JPOOL_IMAGE, cInfo.output_width * 3, APRIL_JPEG_BATCH_ROWS);
+		int w = hmin((int)cInfo.output_width, destWidth);
+		int y = 0;
+		int count = 0;
+		unsigned char* src = NULL;
+		unsigned char* dest = NULL;
+		while (cInfo.output_scanline < cInfo.output_height)
+		{
+			y = cInfo.output_scanline;
+			count = jpeg_read_scanlines(&cInfo, rows, APRIL_JPEG_BATCH_ROWS);
+			for_iter (j, 0, hmin(count, destHeight - y))
+			{
+				src = rows[j];
+				dest = &destData[(y + j) * destWidth * destBpp];
+				for_iter (x, 0, w)
+				{
+					dest[red] = src[0];
+					dest[green] = src[1];
+					dest[blue] = src[2];
+					src += 3;
+					dest += destBpp;
+				}
+			}
+		}
+		jpeg_finish_decompress(&cInfo);
+		jpeg_destroy_decompress(&cInfo);
+		return true;
+	}
+
 	Image* Image::_loadJpg(hsbase& stream)
 	{
 		return Image::_loadJpg(stream, (int)stream.size());
@@ -90,28 +230,86 @@ namespace april
 
 	Image* Image::_readMetaDataJpg(hsbase& stream, int size)
 	{
-		hasError = false;
-		// first read the whole data from the resource file
-		unsigned char* compressedData = new unsigned char[size];
-		stream.readRaw(compressedData, size);
+		// only the markers before the frame header are read, everything else is skipped
+		unsigned char bytes[JPEG_FRAME_HEADER_SIZE] = { 0 };
+		if (size < 2 || stream.readRaw(bytes, 2) != 2 || bytes[0] != 0xFF || bytes[1] != JPEG_MARKER_SOI)
+		{
+			hlog::error(logTag, "Not a JPEG file!");
+			return NULL;
+		}
+		int remaining = size - 2;
+		unsigned char marker = 0;
+		int length = 0;
+		while (remaining >= 4 && stream.readRaw(bytes, 2) == 2)
+		{
+			remaining -= 2;
+			if (bytes[0] != 0xFF)
+			{
+				break;
+			}
+			marker = bytes[1];
+			// markers can be padded with any number of 0xFF bytes
+			while (marker == 0xFF && remaining > 0 && stream.readRaw(&marker, 1) == 1)
+			{
+				--remaining;
+			}
+			if (marker == JPEG_MARKER_TEM || (marker >= JPEG_MARKER_RST0 && marker <= JPEG_MARKER_RST7)) // markers without a segment
+			{
+				continue;
+			}
+			if (marker == JPEG_MARKER_SOS || marker == JPEG_MARKER_EOI || remaining < 2 || stream.readRaw(bytes, 2) != 2)
+			{
+				break;
+			}
+			length = (bytes[0] << 8) + bytes[1] - 2;
+			remaining -= 2;
+			if (length < 0 || length > remaining)
+			{
+				break;
+			}
+			// SOF markers except DHT, JPG and DAC that share the same range
+			if (marker >= JPEG_MARKER_SOF0 && marker <= JPEG_MARKER_SOF15 && marker != JPEG_MARKER_DHT && marker != JPEG_MARKER_JPG && marker != JPEG_MARKER_DAC)
+			{
+				if (length < JPEG_FRAME_HEADER_SIZE || stream.readRaw(bytes, JPEG_FRAME_HEADER_SIZE) != JPEG_FRAME_HEADER_SIZE)
+				{
+					break;
+				}
+				// assign Image data
+				Image* image = new Image();
+				image->data = NULL;
+				image->w = (bytes[3] << 8) + bytes[4];
+				image->h = (bytes[1] << 8) + bytes[2];
+				image->format = Image::FORMAT_RGB; // JPEG is always RGB
+				return image;
+			}
+			stream.seek(length);
+			remaining -= length;
+		}
+		hlog::error(logTag, "JPEG frame header not found!");
+		return NULL;
+	}
+
+	Image* Image::_readMetaDataJpg(unsigned char* data, int size)
+	{
 		// read JPEG image from file data
 		struct jpeg_decompress_struct cInfo;
-		struct jpeg_error_mgr jErr;
-		cInfo.err = jpeg_std_error(&jErr);
-		cInfo.err->error_exit = &onError;
+		JpegErrorManager error;
+		cInfo.err = jpeg_std_error(&error.manager);
+		error.manager.error_exit = &onError;
 		jpeg_create_decompress(&cInfo);
-		jpeg_mem_src(&cInfo, compressedData, size);
-		jpeg_read_header(&cInfo, TRUE);
-		if (hasError)
+		if (setjmp(error.jump) != 0)
 		{
+			jpeg_destroy_decompress(&cInfo);
 			return NULL;
 		}
-		delete[] compressedData;
+		jpeg_mem_src(&cInfo, data, size);
+		jpeg_read_header(&cInfo, TRUE);
+		jpeg_destroy_decompress(&cInfo);
 		// assign Image data
 		Image* image = new Image();
 		image->data = NULL;
-		image->w = cInfo.output_width;
-		image->h = cInfo.output_height;
+		image->w = cInfo.image_width; // output dimensions aren't available before decompression starts
+		image->h = cInfo.image_height;
 		image->format = Image::FORMAT_RGB; // JPEG is always RGB
 		return image;
 	}
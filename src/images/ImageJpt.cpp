@@ -6,33 +6,93 @@
 /// This program is free software; you can redistribute it and/or modify it under
 /// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
 
+#include <hltypes/hltypesUtil.h>
 #include <hltypes/hsbase.h>
 #include <hltypes/hstream.h>
 
 #include "Image.h"
+#include "ImageParallel.h"
 
 namespace april
 {
+	struct JptDecoding
+	{
+		unsigned char* jpgData;
+		int jpgSize;
+		unsigned char* pngData;
+		int pngSize;
+		Image* image;
+	};
+
+	bool Image::_processJptPart(void* args, int first, int count)
+	{
+		JptDecoding* decoding = (JptDecoding*)args;
+		Image* image = decoding->image;
+		bool result = true;
+		for_iter (i, first, first + count)
+		{
+			// both parts write into different channels of the same pixels so they don't interfere with each other
+			if (i == 0)
+			{
+				result &= Image::_decodeJpgColor(decoding->jpgData, decoding->jpgSize, image->data, image->w, image->h, image->format);
+			}
+			else
+			{
+				result &= Image::_decodePngAlpha(decoding->pngData, decoding->pngSize, image->data, image->w, image->h, image->format);
+			}
+		}
+		return result;
+	}
+
 	Image* Image::_loadJpt(hsbase& stream)
 	{
-		Image* jpg = NULL;
-		Image* png = NULL;
-		unsigned char bytes[4] = { 0 };
-		// file header ("JPT" + 1 byte for version code)
-		stream.readRaw(bytes, 4);
-		// read JPEG
-		stream.readRaw(bytes, 4);
-		jpg = Image::_loadJpg(stream, bytes[0] + (bytes[1] << 8) + (bytes[2] << 16) + (bytes[3] << 24));
-		// read PNG
-		stream.readRaw(bytes, 4);
-		png = Image::_loadPng(stream, bytes[0] + (bytes[1] << 8) + (bytes[2] << 16) + (bytes[3] << 24));
-		png->format = FORMAT_ALPHA;
-		// combine
-		Image* image = Image::create(jpg->w, jpg->h, Color::Clear, FORMAT_RGBA);
-		image->write(0, 0, jpg->w, jpg->h, 0, 0, jpg);
-		image->write(0, 0, png->w, png->h, 0, 0, png);
-		delete jpg;
-		delete png;
+		int size = (int)(stream.size() - stream.position());
+		unsigned char* data = new unsigned char[size];
+		stream.readRaw(data, size);
+		Image* image = Image::_loadJpt(data, size);
+		delete[] data;
+		return image;
+	}
+
+	Image* Image::_loadJpt(unsigned char* data, int size)
+	{
+		// file header ("JPT" + 1 byte for version code) and JPEG size
+		if (size < 12)
+		{
+			return NULL;
+		}
+		unsigned char* bytes = &data[4];
+		int jpgSize = bytes[0] + (bytes[1] << 8) + (bytes[2] << 16) + (bytes[3] << 24);
+		if (jpgSize < 0 || jpgSize > size - 12)
+		{
+			return NULL;
+		}
+		bytes = &data[8 + jpgSize];
+		JptDecoding decoding;
+		decoding.jpgData = &data[8];
+		decoding.jpgSize = jpgSize;
+		decoding.pngData = &data[12 + jpgSize];
+		decoding.pngSize = hmin(bytes[0] + (bytes[1] << 8) + (bytes[2] << 16) + (bytes[3] << 24), size - 12 - jpgSize);
+		// the JPEG determines the size so the final image can be allocated right away and both parts are decoded directly into it
+		Image* image = Image::_readMetaDataJpg(decoding.jpgData, decoding.jpgSize);
+		if (image == NULL)
+		{
+			return NULL;
+		}
+		image->format = FORMAT_RGBA;
+		image->data = new unsigned char[image->getByteSize()];
+		decoding.image = image;
+		bool result = true;
+		// the parts are always decoded at the same time since each one alone takes a long time, even for small images
+		if (!ImageParallel::executeConcurrently(2, 2, &Image::_processJptPart, &decoding, result))
+		{
+			result = Image::_processJptPart(&decoding, 0, 2);
+		}
+		if (!result)
+		{
+			delete image;
+			return NULL;
+		}
 		return image;
 	}
 
@@ -41,13 +101,13 @@ namespace april
 		unsigned char bytes[4] = { 0 };
 		// file header ("JPT" + 1 byte for version code)
 		stream.readRaw(bytes, 4);
-		// skip JPEG
+		// the JPEG determines the size
 		stream.readRaw(bytes, 4);
-		stream.seek(bytes[0] + (bytes[1] << 8) + (bytes[2] << 16) + (bytes[3] << 24));
-		// read PNG
-		stream.readRaw(bytes, 4);
-		Image* image = Image::_readMetaDataPng(stream, bytes[0] + (bytes[1] << 8) + (bytes[2] << 16) + (bytes[3] << 24));
-		image->format = FORMAT_RGBA;
+		Image* image = Image::_readMetaDataJpg(stream, bytes[0] + (bytes[1] << 8) + (bytes[2] << 16) + (bytes[3] << 24));
+		if (image != NULL)
+		{
+			image->format = FORMAT_RGBA;
+		}
 		return image;
 	}
 
@@ -0,0 +1,177 @@
+/// @file
+/// @version 3.5
+/// 
+/// @section LICENSE
+/// 
+/// This program is free software; you can redistribute it and/or modify it under
+/// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
+
+#include <hltypes/harray.h>
+#include <hltypes/hltypesUtil.h>
+#include <hltypes/hthread.h>
+
+#include "april.h"
+#include "../Condition.h"
+#include "ImageParallel.h"
+
+#define BANDS_PER_THREAD 4
+
+namespace april
+{
+	Condition ImageParallel::condition;
+	bool ImageParallel::running = false;
+	harray<hthread*> ImageParallel::threads;
+	bool ImageParallel::workersRunning = true;
+	int ImageParallel::generation = 0;
+	int ImageParallel::freeWorkerSlots = 0;
+	int ImageParallel::busyWorkers = 0;
+	ImageParallel::BandFunction ImageParallel::function = NULL;
+	void* ImageParallel::args = NULL;
+	int ImageParallel::rows = 0;
+	int ImageParallel::bandSize = 0;
+	int ImageParallel::nextRow = 0;
+	bool ImageParallel::result = true;
+
+	bool ImageParallel::isAvailable(int rows, int pixels)
+	{
+		if (hmin(april::getImageProcessingThreads(), rows) <= 1 || pixels < april::getParallelImageProcessingThreshold())
+		{
+			return false;
+		}
+		Condition::ScopeLock lock(&ImageParallel::condition);
+		return !ImageParallel::running;
+	}
+
+	bool ImageParallel::execute(int rows, int pixels, BandFunction function, void* args, bool& result)
+	{
+		if (pixels < april::getParallelImageProcessingThreshold())
+		{
+			return false;
+		}
+		return ImageParallel::execute(rows, function, args, result);
+	}
+
+	bool ImageParallel::execute(int rows, BandFunction function, void* args, bool& result)
+	{
+		return ImageParallel::_execute(april::getImageProcessingThreads(), rows, function, args, result);
+	}
+
+	bool ImageParallel::executeConcurrently(int threads, int rows, BandFunction function, void* args, bool& result)
+	{
+		return ImageParallel::_execute(threads, rows, function, args, result);
+	}
+
+	bool ImageParallel::_execute(int threads, int rows, BandFunction function, void* args, bool& result)
+	{
+		int count = hmin(threads, rows);
+		if (count <= 1)
+		{
+			return false;
+		}
+		Condition::ScopeLock lock(&ImageParallel::condition);
+		if (ImageParallel::running) // an operation is already split up, this one is either nested in it or runs on another thread
+		{
+			return false;
+		}
+		ImageParallel::running = true;
+		ImageParallel::function = function;
+		ImageParallel::args = args;
+		ImageParallel::rows = rows;
+		// more bands than threads so uneven bands (e.g. mostly transparent blit rows) are balanced out
+		ImageParallel::bandSize = hmax((rows + count * BANDS_PER_THREAD - 1) / (count * BANDS_PER_THREAD), 1);
+		ImageParallel::nextRow = 0;
+		ImageParallel::result = true;
+		// workers are kept alive between operations, the calling thread is one of the threads processing bands
+		ImageParallel::workersRunning = true;
+		int size = count - 1 - ImageParallel::threads.size();
+		for_iter (i, 0, size)
+		{
+			ImageParallel::threads += new hthread(&ImageParallel::_work, "APRIL image worker");
+			ImageParallel::threads.last()->start();
+		}
+		++ImageParallel::generation;
+		ImageParallel::freeWorkerSlots = count - 1;
+		ImageParallel::condition.broadcast();
+		lock.release();
+		ImageParallel::_processBands(); // the calling thread does its share of the work as well
+		lock.acquire(&ImageParallel::condition);
+		// workers that didn't start yet don't join this operation anymore, there are no bands left
+		ImageParallel::freeWorkerSlots = 0;
+		while (ImageParallel::busyWorkers > 0)
+		{
+			ImageParallel::condition.wait();
+		}
+		result = ImageParallel::result;
+		ImageParallel::function = NULL;
+		ImageParallel::args = NULL;
+		ImageParallel::running = false;
+		return true;
+	}
+
+	void ImageParallel::destroy()
+	{
+		Condition::ScopeLock lock(&ImageParallel::condition);
+		ImageParallel::workersRunning = false;
+		ImageParallel::condition.broadcast();
+		lock.release();
+		foreach (hthread*, it, ImageParallel::threads)
+		{
+			(*it)->join();
+			delete (*it);
+		}
+		lock.acquire(&ImageParallel::condition);
+		ImageParallel::threads.clear();
+	}
+
+	void ImageParallel::_work(hthread* thread)
+	{
+		int generation = 0;
+		Condition::ScopeLock lock(&ImageParallel::condition);
+		while (ImageParallel::workersRunning)
+		{
+			// each worker joins an operation at most once and only as many workers join as the operation requested
+			if (ImageParallel::running && ImageParallel::freeWorkerSlots > 0 && generation != ImageParallel::generation)
+			{
+				generation = ImageParallel::generation;
+				--ImageParallel::freeWorkerSlots;
+				++ImageParallel::busyWorkers;
+				lock.release();
+				ImageParallel::_processBands();
+				lock.acquire(&ImageParallel::condition);
+				--ImageParallel::busyWorkers;
+				if (ImageParallel::busyWorkers == 0)
+				{
+					ImageParallel::condition.broadcast();
+				}
+				continue;
+			}
+			ImageParallel::condition.wait();
+		}
+	}
+
+	void ImageParallel::_processBands()
+	{
+		Condition::ScopeLock lock;
+		int first = 0;
+		int count = 0;
+		bool success = true;
+		while (true)
+		{
+			lock.acquire(&ImageParallel::condition);
+			if (!success)
+			{
+				ImageParallel::result = false;
+			}
+			first = ImageParallel::nextRow;
+			if (first >= ImageParallel::rows)
+			{
+				break;
+			}
+			count = hmin(ImageParallel::bandSize, ImageParallel::rows - first);
+			ImageParallel::nextRow += count;
+			lock.release();
+			success = (*ImageParallel::function)(ImageParallel::args, first, count);
+		}
+	}
+
+}
@@ -0,0 +1,93 @@
+/// @file
+/// @version 3.5
+/// 
+/// @section LICENSE
+/// 
+/// This program is free software; you can redistribute it and/or modify it under
+/// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
+/// 
+/// @section DESCRIPTION
+/// 
+/// Defines utilities for splitting large image operations into row bands processed on multiple threads.
+
+#ifndef APRIL_IMAGE_PARALLEL_H
+#define APRIL_IMAGE_PARALLEL_H
+
+#include <hltypes/harray.h>
+#include <hltypes/hthread.h>
+
+namespace april
+{
+	class Condition;
+
+	class ImageParallel
+	{
+	public:
+		/// @brief Processes the rows [first, first + count) of an operation.
+		typedef bool (*BandFunction)(void* args, int first, int count);
+
+		/// @brief Checks whether an operation is large enough to be split up and no other operation is currently split up.
+		/// @param[in] rows Number of rows in the operation.
+		/// @param[in] pixels Number of pixels in the operation.
+		/// @return True if the operation would be processed on multiple threads.
+		/// @note Allows callers to skip preparations for multi-threaded processing. execute() can still reject the operation.
+		static bool isAvailable(int rows, int pixels);
+		/// @brief Splits an operation into row bands and processes them on multiple threads.
+		/// @param[in] rows Number of rows in the operation.
+		/// @param[in] pixels Number of pixels in the operation.
+		/// @param[in] function Function that processes one band.
+		/// @param[in] args Operation arguments passed on to function.
+		/// @param[out] result Set to false if any of the bands failed.
+		/// @return True if the operation was processed, false if it should be processed serially by the caller.
+		/// @note Nested or concurrent calls are always rejected so the caller processes them serially.
+		static bool execute(int rows, int pixels, BandFunction function, void* args, bool& result);
+		/// @brief Splits an operation into row bands and processes them on multiple threads regardless of its size.
+		/// @param[in] rows Number of rows in the operation.
+		/// @param[in] function Function that processes one band.
+		/// @param[in] args Operation arguments passed on to function.
+		/// @param[out] result Set to false if any of the bands failed.
+		/// @return True if the operation was processed, false if it should be processed serially by the caller.
+		/// @note Meant for operations where each row is expensive on its own (e.g. reading a file).
+		static bool execute(int rows, BandFunction function, void* args, bool& result);
+		/// @brief Splits an operation into row bands and processes them on a fixed number of threads regardless of the image processing
+		/// thread setting.
+		/// @param[in] threads Number of threads, including the calling thread.
+		/// @param[in] rows Number of rows in the operation.
+		/// @param[in] function Function that processes one band.
+		/// @param[in] args Operation arguments passed on to function.
+		/// @param[out] result Set to false if any of the bands failed.
+		/// @return True if the operation was processed, false if it should be processed serially by the caller.
+		/// @note Meant for a few independent tasks that are worth running at the same time even on slow devices (e.g. the two parts of a
+		/// JPT file).
+		static bool executeConcurrently(int threads, int rows, BandFunction function, void* args, bool& result);
+		/// @brief Stops and joins the worker threads.
+		static void destroy();
+
+	protected:
+		static Condition condition;
+		static bool running;
+		static harray<hthread*> threads;
+		static bool workersRunning;
+		static int generation;
+		static int freeWorkerSlots;
+		static int busyWorkers;
+		static BandFunction function;
+		static void* args;
+		static int rows;
+		static int bandSize;
+		static int nextRow;
+		static bool result;
+
+		static bool _execute(int threads, int rows, BandFunction function, void* args, bool& result);
+		static void _work(hthread* thread);
+		static void _processBands();
+
+	private: // prevents inheritance and instantiation
+		ImageParallel() { }
+		~ImageParallel() { }
+
+	};
+
+}
+
+#endif
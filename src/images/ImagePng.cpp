@@ -7,10 +7,12 @@
 /// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
 
 #include <png.h>
+#include <string.h>
 #include <pngpriv.h>
 #include <pngstruct.h>
 
 #include <hltypes/hlog.h>
+#include <hltypes/hltypesUtil.h>
 #include <hltypes/hsbase.h>
 #include <hltypes/hstring.h>
 
@@ -18,6 +20,9 @@
 #include "Image.h"
 
 #define PNG_SIGNATURE_SIZE 8
+#define PNG_CHUNK_HEADER_SIZE 8
+#define PNG_IHDR_SIZE 13
+#define PNG_CRC_SIZE 4
 
 namespace april
 {
@@ -26,29 +31,27 @@ namespace april
 		((hsbase*)png->io_ptr)->readRaw(data, (int)size);
 	}
 
-	Image* Image::_loadPng(hsbase& stream, int size)
+	struct PngMemorySource
 	{
-		if (size < PNG_SIGNATURE_SIZE)
-		{
-			hlog::error(logTag, "Not a PNG file!");
-			return NULL;
-		}
-		png_byte signature[PNG_SIGNATURE_SIZE] = { '\0' };
-		stream.readRaw(signature, PNG_SIGNATURE_SIZE);
-		if (png_sig_cmp(signature, 0, PNG_SIGNATURE_SIZE))
+		unsigned char* data;
+		int size;
+		int position;
+	};
+
+	void _pngMemoryRead(png_structp png, png_bytep data, png_size_t size)
+	{
+		PngMemorySource* source = (PngMemorySource*)png->io_ptr;
+		if ((int)size > source->size - source->position)
 		{
-			hlog::error(logTag, "Not a PNG file!");
-			return NULL;
+			png_error(png, "Unexpected end of PNG data!");
 		}
-		stream.seek(-PNG_SIGNATURE_SIZE, hsbase::CURRENT);
-		png_structp pngPtr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
-		png_infop infoPtr = png_create_info_struct(pngPtr);
-		png_infop endInfo = png_create_info_struct(pngPtr);
-		setjmp(png_jmpbuf(pngPtr));
-		png_set_read_fn(pngPtr, &stream, &_pngZipRead);
-		png_read_info(pngPtr, infoPtr);
-		png_get_IHDR(pngPtr, infoPtr, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
-		png_set_interlace_handling(pngPtr);
+		memcpy(data, &source->data[source->position], size);
+		source->position += (int)size;
+	}
+
+	/// @return Number of channels after the transformations.
+	static int _setupPngTransforms(png_structp pngPtr, png_infop infoPtr)
+	{
 		int bpp = pngPtr->channels;
 		if (pngPtr->color_type == PNG_COLOR_TYPE_PALETTE)
 		{
@@ -69,48 +72,214 @@ namespace april
 		{
 			png_set_strip_16(pngPtr);
 		}
-		png_read_update_info(pngPtr, infoPtr);
-		int rowBytes = (int)png_get_rowbytes(pngPtr, infoPtr);
-		png_byte* imageData = new png_byte[rowBytes * pngPtr->height];
-		png_bytep* rowPointers = new png_bytep[pngPtr->height];
-		for_itert (unsigned int, i, 0, pngPtr->height)
-		{
-			rowPointers[i] = imageData + i * rowBytes;
-		}
-		png_read_image(pngPtr, rowPointers);
-		png_read_end(pngPtr, infoPtr);
-		// assign Image data
-		Image* image = new Image();
-		image->data = (unsigned char*)imageData;
-		image->w = pngPtr->width;
-		image->h = pngPtr->height;
+		return bpp;
+	}
+
+	static Image::Format _getPngFormat(int bpp)
+	{
 		switch (bpp)
 		{
 		case 4:
-			image->format = FORMAT_RGBA;
-			break;
+			return Image::FORMAT_RGBA;
 		case 3:
-			image->format = FORMAT_RGB;
-			break;
+			return Image::FORMAT_RGB;
 		case 1:
-			image->format = FORMAT_ALPHA;
-			break;
+			return Image::FORMAT_ALPHA;
 		default:
-			image->format = FORMAT_RGBA; // TODOaa - maybe palette should go here
 			break;
 		}
-		// clean up
-		png_destroy_read_struct(&pngPtr, &infoPtr, &endInfo);
-		delete[] rowPointers;
-		return image;
+		return Image::FORMAT_RGBA; // TODOaa - maybe palette should go here
 	}
 
-	Image* Image::_loadPng(hsbase& stream)
+	static Image::Format _setupPngOutputFormat(png_structp pngPtr, int bpp, Image::Format format)
 	{
-		return Image::_loadPng(stream, (int)stream.size());
+		bool bgr = false;
+		bool alphaFirst = false;
+		switch (format)
+		{
+		case Image::FORMAT_RGBA:	bgr = false;	alphaFirst = false;	break;
+		case Image::FORMAT_ARGB:	bgr = false;	alphaFirst = true;	break;
+		case Image::FORMAT_BGRA:	bgr = true;		alphaFirst = false;	break;
+		case Image::FORMAT_ABGR:	bgr = true;		alphaFirst = true;	break;
+		case Image::FORMAT_RGBX:	bgr = false;	alphaFirst = false;	break;
+		case Image::FORMAT_XRGB:	bgr = false;	alphaFirst = true;	break;
+		case Image::FORMAT_BGRX:	bgr = true;		alphaFirst = false;	break;
+		case Image::FORMAT_XBGR:	bgr = true;		alphaFirst = true;	break;
+		case Image::FORMAT_RGB:		bgr = false;	alphaFirst = false;	break;
+		case Image::FORMAT_BGR:		bgr = true;		alphaFirst = false;	break;
+		default:
+			return Image::FORMAT_INVALID;
+		}
+		int formatBpp = Image::getFormatBpp(format);
+		if (bpp == 3 && formatBpp == 4)
+		{
+			png_set_filler(pngPtr, 0xFF, alphaFirst ? PNG_FILLER_BEFORE : PNG_FILLER_AFTER);
+		}
+		else if (bpp == 4 && formatBpp == 3)
+		{
+			png_set_strip_alpha(pngPtr);
+		}
+		else if (bpp == 4 && alphaFirst)
+		{
+			png_set_swap_alpha(pngPtr);
+		}
+		if (bgr)
+		{
+			png_set_bgr(pngPtr);
+		}
+		return format;
 	}
 
-	Image* Image::_readMetaDataPng(hsbase& stream, int size)
+	/// @brief Reads all rows and averages blocks of factor x factor pixels.
+	static void _readPngRowsReduced(png_structp pngPtr, int bpp, int factor, png_bytep rowData, unsigned int* sums, unsigned char* destData)
+	{
+		int w = pngPtr->width;
+		int h = pngPtr->height;
+		int destWidth = (w + factor - 1) / factor;
+		int destRowSize = destWidth * bpp;
+		memset(sums, 0, destRowSize * sizeof(unsigned int));
+		png_bytep src = NULL;
+		unsigned int* sum = NULL;
+		unsigned char* dest = NULL;
+		int columns = 0;
+		int divisor = 0;
+		for_iter (y, 0, h)
+		{
+			png_read_row(pngPtr, rowData, NULL);
+			src = rowData;
+			sum = sums;
+			for_iter_step (x, 0, w, factor)
+			{
+				columns = hmin(factor, w - x);
+				for_iter (i, 0, columns)
+				{
+					for_iter (j, 0, bpp)
+					{
+						sum[j] += src[j];
+					}
+					src += bpp;
+				}
+				sum += bpp;
+			}
+			if ((y + 1) % factor == 0 || y == h - 1)
+			{
+				dest = &destData[(y / factor) * destRowSize];
+				sum = sums;
+				for_iter_step (x, 0, w, factor)
+				{
+					divisor = hmin(factor, w - x) * (y % factor + 1);
+					for_iter (j, 0, bpp)
+					{
+						dest[j] = (unsigned char)((sum[j] + divisor / 2) / divisor);
+						sum[j] = 0;
+					}
+					dest += bpp;
+					sum += bpp;
+				}
+			}
+		}
+	}
+
+	static unsigned char* _decodePng(void* source, png_rw_ptr readFunction, const Image::DecodeOptions& options, int& w, int& h, Image::Format& format)
+	{
+		png_structp pngPtr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+		png_infop infoPtr = png_create_info_struct(pngPtr);
+		png_infop endInfo = png_create_info_struct(pngPtr);
+		// volatile so they are still valid after longjmp()
+		png_byte* volatile imageData = NULL;
+		png_bytep* volatile rowPointers = NULL;
+		png_byte* volatile rowData = NULL;
+		unsigned int* volatile sums = NULL;
+		if (setjmp(png_jmpbuf(pngPtr)) != 0)
+		{
+			png_destroy_read_struct(&pngPtr, &infoPtr, &endInfo);
+			if (imageData != NULL)
+			{
+				delete[] imageData;
+			}
+			if (rowPointers != NULL)
+			{
+				delete[] rowPointers;
+			}
+			if (rowData != NULL)
+			{
+				delete[] rowData;
+			}
+			if (sums != NULL)
+			{
+				delete[] sums;
+			}
+			return NULL;
+		}
+		png_set_read_fn(pngPtr, source, readFunction);
+		png_read_info(pngPtr, infoPtr);
+		png_get_IHDR(pngPtr, infoPtr, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+		int passes = png_set_interlace_handling(pngPtr);
+		int bpp = _setupPngTransforms(pngPtr, infoPtr);
+		format = _getPngFormat(bpp);
+		// the color type decides whether the RGB or the RGBA layout was requested
+		Image::Format targetFormat = options.getFormat(format);
+		// libpng can rearrange the channels while decoding which avoids an additional conversion pass
+		if ((bpp == 3 || bpp == 4) && targetFormat != Image::FORMAT_INVALID && targetFormat != format)
+		{
+			Image::Format outputFormat = _setupPngOutputFormat(pngPtr, bpp, targetFormat);
+			if (outputFormat != Image::FORMAT_INVALID)
+			{
+				format = outputFormat;
+			}
+		}
+		png_read_update_info(pngPtr, infoPtr);
+		int rowBytes = (int)png_get_rowbytes(pngPtr, infoPtr);
+		w = pngPtr->width;
+		h = pngPtr->height;
+		int reducedWidth = w;
+		int reducedHeight = h;
+		Image::getReducedSize(w, h, options.maxWidth, options.maxHeight, reducedWidth, reducedHeight);
+		int factor = hmin(w / reducedWidth, h / reducedHeight);
+		bpp = rowBytes / w;
+		// interlaced images need all rows at once so they can only be reduced after decoding
+		if (factor > 1 && passes == 1)
+		{
+			w = (w + factor - 1) / factor;
+			h = (h + factor - 1) / factor;
+			imageData = new png_byte[w * h * bpp];
+			rowData = new png_byte[rowBytes];
+			sums = new unsigned int[w * bpp];
+			_readPngRowsReduced(pngPtr, bpp, factor, rowData, sums, imageData);
+			png_read_end(pngPtr, infoPtr);
+			// clean up
+			png_destroy_read_struct(&pngPtr, &infoPtr, &endInfo);
+			delete[] rowData;
+			delete[] sums;
+		}
+		else
+		{
+			imageData = new png_byte[rowBytes * h];
+			rowPointers = new png_bytep[h];
+			for_iter (i, 0, h)
+			{
+				rowPointers[i] = imageData + i * rowBytes;
+			}
+			png_read_image(pngPtr, rowPointers);
+			png_read_end(pngPtr, infoPtr);
+			// clean up
+			png_destroy_read_struct(&pngPtr, &infoPtr, &endInfo);
+			delete[] rowPointers;
+		}
+		// the remaining difference to the reduced size is filtered properly
+		if ((w != reducedWidth || h != reducedHeight) && bpp == Image::getFormatBpp(format))
+		{
+			unsigned char* reducedData = new unsigned char[reducedWidth * reducedHeight * bpp];
+			Image::writeStretch(0, 0, w, h, 0, 0, reducedWidth, reducedHeight, (unsigned char*)imageData, w, h, format, reducedData, reducedWidth, reducedHeight, format);
+			delete[] imageData;
+			imageData = reducedData;
+			w = reducedWidth;
+			h = reducedHeight;
+		}
+		return (unsigned char*)imageData;
+	}
+
+	Image* Image::_loadPng(hsbase& stream, int size, const DecodeOptions& options)
 	{
 		if (size < PNG_SIGNATURE_SIZE)
 		{
@@ -125,58 +294,204 @@ namespace april
 			return NULL;
 		}
 		stream.seek(-PNG_SIGNATURE_SIZE, hsbase::CURRENT);
+		Image* image = new Image();
+		image->data = _decodePng(&stream, &_pngZipRead, options, image->w, image->h, image->format);
+		if (image->data == NULL)
+		{
+			delete image;
+			return NULL;
+		}
+		return image;
+	}
+
+	Image* Image::_loadPng(unsigned char* data, int size, const DecodeOptions& options)
+	{
+		if (size < PNG_SIGNATURE_SIZE || png_sig_cmp(data, 0, PNG_SIGNATURE_SIZE))
+		{
+			hlog::error(logTag, "Not a PNG file!");
+			return NULL;
+		}
+		PngMemorySource source;
+		source.data = data;
+		source.size = size;
+		source.position = 0;
+		Image* image = new Image();
+		image->data = _decodePng(&source, &_pngMemoryRead, options, image->w, image->h, image->format);
+		if (image->data == NULL)
+		{
+			delete image;
+			return NULL;
+		}
+		return image;
+	}
+
+	bool Image::_decodePngAlpha(unsigned char* data, int size, unsigned char* destData, int destWidth, int destHeight, Image::Format destFormat)
+	{
+		if (size < PNG_SIGNATURE_SIZE || png_sig_cmp(data, 0, PNG_SIGNATURE_SIZE))
+		{
+			hlog::error(logTag, "Not a PNG file!");
+			return false;
+		}
+		int destBpp = Image::getFormatBpp(destFormat);
+		int alpha = destBpp - 1;
+		Image::_getFormatIndices(destFormat, NULL, NULL, NULL, &alpha);
+		PngMemorySource source;
+		source.data = data;
+		source.size = size;
+		source.position = 0;
 		png_structp pngPtr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
 		png_infop infoPtr = png_create_info_struct(pngPtr);
 		png_infop endInfo = png_create_info_struct(pngPtr);
-		setjmp(png_jmpbuf(pngPtr));
-		png_set_read_fn(pngPtr, &stream, &_pngZipRead);
+		// volatile so they are still valid after longjmp()
+		png_byte* volatile rowData = NULL;
+		png_bytep* volatile rowPointers = NULL;
+		if (setjmp(png_jmpbuf(pngPtr)) != 0)
+		{
+			png_destroy_read_struct(&pngPtr, &infoPtr, &endInfo);
+			if (rowData != NULL)
+			{
+				delete[] rowData;
+			}
+			if (rowPointers != NULL)
+			{
+				delete[] rowPointers;
+			}
+			return false;
+		}
+		png_set_read_fn(pngPtr, &source, &_pngMemoryRead);
 		png_read_info(pngPtr, infoPtr);
 		png_get_IHDR(pngPtr, infoPtr, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
-		png_set_interlace_handling(pngPtr);
-		int bpp = pngPtr->channels;
-		if (pngPtr->color_type == PNG_COLOR_TYPE_PALETTE)
+		int passes = png_set_interlace_handling(pngPtr);
+		int bpp = _setupPngTransforms(pngPtr, infoPtr);
+		png_read_update_info(pngPtr, infoPtr);
+		int rowBytes = (int)png_get_rowbytes(pngPtr, infoPtr);
+		int h = pngPtr->height;
+		// interlaced images need all rows at once, otherwise rows are processed one by one
+		if (passes > 1)
 		{
-			png_set_palette_to_rgb(pngPtr);
-			bpp = 3;
+			rowData = new png_byte[rowBytes * h];
+			rowPointers = new png_bytep[h];
+			for_iter (i, 0, h)
+			{
+				rowPointers[i] = rowData + i * rowBytes;
+			}
+			png_read_image(pngPtr, rowPointers);
 		}
-		if (pngPtr->color_type == PNG_COLOR_TYPE_GRAY_ALPHA && bpp > 1)
+		else
 		{
-			png_set_strip_alpha(pngPtr);
-			--bpp;
+			rowData = new png_byte[rowBytes];
 		}
-		if (png_get_valid(pngPtr, infoPtr, PNG_INFO_tRNS))
+		int w = hmin((int)pngPtr->width, destWidth);
+		png_bytep src = NULL;
+		unsigned char* dest = NULL;
+		for_iter (y, 0, h)
 		{
-			png_set_tRNS_to_alpha(pngPtr);
-			++bpp;
+			if (passes > 1)
+			{
+				src = rowPointers[y];
+			}
+			else
+			{
+				png_read_row(pngPtr, rowData, NULL);
+				src = rowData;
+			}
+			if (y < destHeight)
+			{
+				dest = &destData[y * destWidth * destBpp + alpha];
+				for_iter (x, 0, w)
+				{
+					*dest = *src;
+					src += bpp;
+					dest += destBpp;
+				}
+				for_iter (x, w, destWidth)
+				{
+					*dest = 255;
+					dest += destBpp;
+				}
+			}
 		}
-		if (pngPtr->bit_depth == 16)
+		for_iter (y, h, destHeight)
 		{
-			png_set_strip_16(pngPtr);
+			dest = &destData[y * destWidth * destBpp + alpha];
+			for_iter (x, 0, destWidth)
+			{
+				*dest = 255;
+				dest += destBpp;
+			}
 		}
-		png_read_update_info(pngPtr, infoPtr);
 		png_read_end(pngPtr, infoPtr);
-		// assign Image data
-		Image* image = new Image();
-		image->data = NULL;
-		image->w = pngPtr->width;
-		image->h = pngPtr->height;
-		switch (bpp)
+		png_destroy_read_struct(&pngPtr, &infoPtr, &endInfo);
+		delete[] rowData;
+		if (rowPointers != NULL)
 		{
-		case 4:
-			image->format = FORMAT_RGBA;
-			break;
-		case 3:
-			image->format = FORMAT_RGB;
-			break;
-		case 1:
-			image->format = FORMAT_ALPHA;
-			break;
+			delete[] rowPointers;
+		}
+		return true;
+	}
+
+	Image* Image::_loadPng(hsbase& stream)
+	{
+		return Image::_loadPng(stream, (int)stream.size());
+	}
+
+	Image* Image::_readMetaDataPng(hsbase& stream, int size)
+	{
+		// only the signature and the chunk headers before the image data are read
+		unsigned char header[PNG_SIGNATURE_SIZE + PNG_CHUNK_HEADER_SIZE + PNG_IHDR_SIZE + PNG_CRC_SIZE] = { '\0' };
+		if (size < (int)sizeof(header) || stream.readRaw(header, sizeof(header)) != sizeof(header) || png_sig_cmp(header, 0, PNG_SIGNATURE_SIZE))
+		{
+			hlog::error(logTag, "Not a PNG file!");
+			return NULL;
+		}
+		unsigned char* ihdr = &header[PNG_SIGNATURE_SIZE];
+		if (memcmp(&ihdr[4], "IHDR", 4) != 0)
+		{
+			hlog::error(logTag, "PNG file is missing the IHDR chunk!");
+			return NULL;
+		}
+		ihdr += PNG_CHUNK_HEADER_SIZE;
+		int bpp = 0;
+		switch (ihdr[9]) // color type
+		{
+		case PNG_COLOR_TYPE_GRAY:		bpp = 1;	break;
+		case PNG_COLOR_TYPE_RGB:		bpp = 3;	break;
+		case PNG_COLOR_TYPE_PALETTE:	bpp = 3;	break; // expanded to RGB when decoding
+		case PNG_COLOR_TYPE_GRAY_ALPHA:	bpp = 1;	break; // alpha is stripped when decoding
+		case PNG_COLOR_TYPE_RGB_ALPHA:	bpp = 4;	break;
 		default:
-			image->format = FORMAT_RGBA; // TODOaa - maybe palette should go here
-			break;
+			hlog::error(logTag, "Unknown PNG color type!");
+			return NULL;
 		}
-		// clean up
-		png_destroy_read_struct(&pngPtr, &infoPtr, &endInfo);
+		// transparency is expanded to alpha when decoding and the tRNS chunk always comes before the image data
+		int remaining = size - (int)sizeof(header);
+		unsigned char chunk[PNG_CHUNK_HEADER_SIZE] = { '\0' };
+		int length = 0;
+		while (remaining >= PNG_CHUNK_HEADER_SIZE && stream.readRaw(chunk, PNG_CHUNK_HEADER_SIZE) == PNG_CHUNK_HEADER_SIZE)
+		{
+			if (memcmp(&chunk[4], "tRNS", 4) == 0)
+			{
+				++bpp;
+				break;
+			}
+			if (memcmp(&chunk[4], "IDAT", 4) == 0 || memcmp(&chunk[4], "IEND", 4) == 0)
+			{
+				break;
+			}
+			length = (int)png_get_uint_32(chunk);
+			if (length < 0)
+			{
+				break;
+			}
+			remaining -= PNG_CHUNK_HEADER_SIZE + length + PNG_CRC_SIZE;
+			stream.seek(length + PNG_CRC_SIZE);
+		}
+		// assign Image data
+		Image* image = new Image();
+		image->data = NULL;
+		image->w = png_get_uint_32(ihdr);
+		image->h = png_get_uint_32(&ihdr[4]);
+		image->format = _getPngFormat(bpp);
 		return image;
 	}
 
@@ -0,0 +1,605 @@
+/// @file
+/// @version 3.5
+///
+/// @section LICENSE
+///
+/// This program is free software; you can redistribute it and/or modify it under
+/// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
+
+#include <string.h>
+
+#include <hltypes/hltypesUtil.h>
+
+#include "april.h"
+#include "Image.h"
+
+#if !defined(_NO_SIMD) && (defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__))
+#define _SIMD_X86
+#endif
+
+#ifdef _SIMD_X86
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define SIMD_TARGET(name)
+#else
+#include <cpuid.h>
+#define SIMD_TARGET(name) __attribute__((target(name)))
+#endif
+#endif
+
+// kernels work on groups of 16 pixels, anything smaller is not worth the setup
+#define SIMD_MIN_PIXELS 16
+
+namespace april
+{
+#ifdef _SIMD_X86
+	enum SimdLevel
+	{
+		SIMD_UNDEFINED = -1,
+		SIMD_NONE = 0,
+		SIMD_SSE2,
+		SIMD_SSSE3,
+		SIMD_AVX2
+	};
+
+	static int simdLevel = SIMD_UNDEFINED;
+
+	static void _cpuid(int leaf, int subleaf, unsigned int* regs)
+	{
+#ifdef _MSC_VER
+		int info[4] = {0};
+		__cpuidex(info, leaf, subleaf);
+		regs[0] = info[0];
+		regs[1] = info[1];
+		regs[2] = info[2];
+		regs[3] = info[3];
+#else
+		regs[0] = regs[1] = regs[2] = regs[3] = 0;
+		if ((int)__get_cpuid_max(0, NULL) >= leaf)
+		{
+			__cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+		}
+#endif
+	}
+
+	static unsigned int _getXcr0()
+	{
+#ifdef _MSC_VER
+		return (unsigned int)_xgetbv(0);
+#else
+		unsigned int eax = 0;
+		unsigned int edx = 0;
+		__asm__ __volatile__ ("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+		return eax;
+#endif
+	}
+
+	static int _detectSimdLevel()
+	{
+		int level = SIMD_NONE;
+		unsigned int regs[4] = {0};
+		_cpuid(0, 0, regs);
+		unsigned int maxLeaf = regs[0];
+		if (maxLeaf >= 1)
+		{
+			_cpuid(1, 0, regs);
+			if ((regs[3] & (1 << 26)) != 0) // SSE2
+			{
+				level = SIMD_SSE2;
+				if ((regs[2] & (1 << 9)) != 0) // SSSE3
+				{
+					level = SIMD_SSSE3;
+					// AVX2 also needs the OS to save YMM registers (OSXSAVE + AVX + XCR0 bits 1 and 2)
+					bool osAvx = ((regs[2] & (1 << 27)) != 0 && (regs[2] & (1 << 28)) != 0 && (_getXcr0() & 0x6) == 0x6);
+					if (osAvx && maxLeaf >= 7)
+					{
+						_cpuid(7, 0, regs);
+						if ((regs[1] & (1 << 5)) != 0) // AVX2
+						{
+							level = SIMD_AVX2;
+						}
+					}
+				}
+			}
+		}
+		return level;
+	}
+
+	static int _getSimdLevel()
+	{
+		// detection is idempotent so racing threads simply end up writing the same value
+		if (simdLevel == SIMD_UNDEFINED)
+		{
+			simdLevel = _detectSimdLevel();
+		}
+		int maxLevel = april::getMaxImageSimdLevel();
+		return (maxLevel >= 0 ? hmin(simdLevel, maxLevel) : simdLevel);
+	}
+
+	/// @note Byte-gathers a group of 16 pixels. Every destination register is assembled from all source registers that
+	/// contribute to it which covers every BPP combination (1, 3 and 4) with the same code.
+	SIMD_TARGET("ssse3") static int _swizzleSsse3(int count, unsigned char* srcData, int srcBpp, unsigned char* destData, int destBpp, int* indices)
+	{
+		unsigned char maskBytes[4][4][16];
+		unsigned char fillBytes[4][16];
+		bool used[4][4];
+		memset(maskBytes, 0x80, sizeof(maskBytes));
+		memset(fillBytes, 0, sizeof(fillBytes));
+		memset(used, 0, sizeof(used));
+		int g = 0;
+		int s = 0;
+		int channel = 0;
+		for_iter (d, 0, destBpp)
+		{
+			for_iter (b, 0, 16)
+			{
+				g = d * 16 + b;
+				channel = indices[g % destBpp];
+				if (channel < 0)
+				{
+					fillBytes[d][b] = 0xFF;
+				}
+				else
+				{
+					s = (g / destBpp) * srcBpp + channel;
+					maskBytes[d][s / 16][b] = (unsigned char)(s % 16);
+					used[d][s / 16] = true;
+				}
+			}
+		}
+		__m128i masks[4][4];
+		__m128i fills[4];
+		for_iter (d, 0, destBpp)
+		{
+			fills[d] = _mm_loadu_si128((__m128i*)fillBytes[d]);
+			for_iter (r, 0, srcBpp)
+			{
+				masks[d][r] = _mm_loadu_si128((__m128i*)maskBytes[d][r]);
+			}
+		}
+		__m128i in[4];
+		__m128i out;
+		int groups = count / SIMD_MIN_PIXELS;
+		for_iter (i, 0, groups)
+		{
+			for_iter (r, 0, srcBpp)
+			{
+				in[r] = _mm_loadu_si128((__m128i*)&srcData[r * 16]);
+			}
+			// all source registers are loaded before storing so in-place conversions of equal BPP are safe
+			for_iter (d, 0, destBpp)
+			{
+				out = fills[d];
+				for_iter (r, 0, srcBpp)
+				{
+					if (used[d][r])
+					{
+						out = _mm_or_si128(out, _mm_shuffle_epi8(in[r], masks[d][r]));
+					}
+				}
+				_mm_storeu_si128((__m128i*)&destData[d * 16], out);
+			}
+			srcData += srcBpp * 16;
+			destData += destBpp * 16;
+		}
+		return groups * SIMD_MIN_PIXELS;
+	}
+
+	SIMD_TARGET("avx2") static int _swizzle4BppAvx2(int count, unsigned char* srcData, unsigned char* destData, int* indices)
+	{
+		unsigned char maskBytes[32];
+		unsigned char fillBytes[32];
+		for_iter (b, 0, 32)
+		{
+			maskBytes[b] = (indices[b % 4] < 0 ? 0x80 : (unsigned char)(b / 4 % 4 * 4 + indices[b % 4]));
+			fillBytes[b] = (indices[b % 4] < 0 ? 0xFF : 0);
+		}
+		__m256i mask = _mm256_loadu_si256((__m256i*)maskBytes);
+		__m256i fill = _mm256_loadu_si256((__m256i*)fillBytes);
+		int groups = count / 8;
+		for_iter (i, 0, groups)
+		{
+			_mm256_storeu_si256((__m256i*)destData, _mm256_or_si256(_mm256_shuffle_epi8(_mm256_loadu_si256((__m256i*)srcData), mask), fill));
+			srcData += 32;
+			destData += 32;
+		}
+		_mm256_zeroupper();
+		return groups * 8;
+	}
+
+	/// @note Plain SSE2 has no byte shuffle so 4 BPP swizzles are done with 32 bit lane shifts and masks.
+	SIMD_TARGET("sse2") static int _swizzle4BppSse2(int count, unsigned char* srcData, unsigned char* destData, int* indices)
+	{
+		unsigned int fillValue = 0;
+		__m128i rightShifts[4];
+		__m128i leftShifts[4];
+		int channels = 0;
+		for_iter (c, 0, 4)
+		{
+			if (indices[c] < 0)
+			{
+				fillValue |= (0xFF << (c * 8));
+			}
+			else
+			{
+				rightShifts[channels] = _mm_cvtsi32_si128(indices[c] * 8);
+				leftShifts[channels] = _mm_cvtsi32_si128(c * 8);
+				++channels;
+			}
+		}
+		__m128i fill = _mm_set1_epi32((int)fillValue);
+		__m128i byteMask = _mm_set1_epi32(0xFF);
+		__m128i value;
+		__m128i out;
+		int groups = count / 4;
+		for_iter (i, 0, groups)
+		{
+			value = _mm_loadu_si128((__m128i*)srcData);
+			out = fill;
+			for_iter (c, 0, channels)
+			{
+				out = _mm_or_si128(out, _mm_sll_epi32(_mm_and_si128(_mm_srl_epi32(value, rightShifts[c]), byteMask), leftShifts[c]));
+			}
+			_mm_storeu_si128((__m128i*)destData, out);
+			srcData += 16;
+			destData += 16;
+		}
+		return groups * 4;
+	}
+
+	/// @note Blends groups of 16 pixels. Source bytes and the per-pixel alpha are gathered into the destination layout first
+	/// so the arithmetic is the same for every BPP combination. Division by 255 is done with an exact reciprocal multiply.
+	SIMD_TARGET("ssse3") static int _blendSsse3(int w, int h, unsigned char* srcData, int srcStride, int srcBpp, int srcAlpha, unsigned char* destData, int destStride, int destBpp, int* indices, bool* blended, unsigned char alpha)
+	{
+		int groups = w / SIMD_MIN_PIXELS;
+		unsigned char sourceBytes[4][4][16];
+		unsigned char alphaSourceBytes[4][16];
+		unsigned char alphaBytes[4][16];
+		unsigned char fillBytes[4][16];
+		unsigned char blendBytes[4][16];
+		bool used[4][4];
+		bool alphaUsed[4];
+		memset(sourceBytes, 0x80, sizeof(sourceBytes));
+		memset(alphaSourceBytes, 0x80, sizeof(alphaSourceBytes));
+		memset(alphaBytes, 0x80, sizeof(alphaBytes));
+		memset(fillBytes, 0, sizeof(fillBytes));
+		memset(blendBytes, 0, sizeof(blendBytes));
+		memset(used, 0, sizeof(used));
+		memset(alphaUsed, 0, sizeof(alphaUsed));
+		int g = 0;
+		int s = 0;
+		int pixel = 0;
+		int channel = 0;
+		for_iter (d, 0, destBpp)
+		{
+			for_iter (b, 0, 16)
+			{
+				g = d * 16 + b;
+				pixel = g / destBpp;
+				channel = g % destBpp;
+				if (blended[channel])
+				{
+					alphaBytes[d][b] = (unsigned char)pixel;
+					blendBytes[d][b] = 0xFF;
+				}
+				if (indices[channel] >= 0)
+				{
+					s = pixel * srcBpp + indices[channel];
+					sourceBytes[d][s / 16][b] = (unsigned char)(s % 16);
+					used[d][s / 16] = true;
+				}
+				else
+				{
+					fillBytes[d][b] = 0xFF;
+				}
+			}
+		}
+		if (srcAlpha >= 0)
+		{
+			for_iter (p, 0, 16)
+			{
+				s = p * srcBpp + srcAlpha;
+				alphaSourceBytes[s / 16][p] = (unsigned char)(s % 16);
+				alphaUsed[s / 16] = true;
+			}
+		}
+		__m128i sourceMasks[4][4];
+		__m128i alphaSourceMasks[4];
+		__m128i alphaMasks[4];
+		__m128i fills[4];
+		__m128i blends[4];
+		for_iter (d, 0, 4)
+		{
+			alphaSourceMasks[d] = _mm_loadu_si128((__m128i*)alphaSourceBytes[d]);
+			alphaMasks[d] = _mm_loadu_si128((__m128i*)alphaBytes[d]);
+			fills[d] = _mm_loadu_si128((__m128i*)fillBytes[d]);
+			blends[d] = _mm_loadu_si128((__m128i*)blendBytes[d]);
+			for_iter (r, 0, 4)
+			{
+				sourceMasks[d][r] = _mm_loadu_si128((__m128i*)sourceBytes[d][r]);
+			}
+		}
+		__m128i zero = _mm_setzero_si128();
+		__m128i ones = _mm_set1_epi8((char)0xFF);
+		__m128i multiplier = _mm_set1_epi16(alpha);
+		__m128i reciprocal = _mm_set1_epi16((short)0x8081);
+		__m128i constantAlpha = _mm_set1_epi8((char)alpha);
+		__m128i in[4];
+		__m128i a0;
+		__m128i low;
+		__m128i high;
+		__m128i color;
+		__m128i factor;
+		__m128i inverse;
+		__m128i dest;
+		bool opaque = false;
+		unsigned char* srcRow = NULL;
+		unsigned char* destRow = NULL;
+		for_iter (j, 0, h)
+		{
+			srcRow = &srcData[j * srcStride];
+			destRow = &destData[j * destStride];
+			for_iter (i, 0, groups)
+			{
+				for_iter (r, 0, srcBpp)
+				{
+					in[r] = _mm_loadu_si128((__m128i*)&srcRow[r * 16]);
+				}
+				a0 = constantAlpha;
+				if (srcAlpha >= 0)
+				{
+					a0 = zero;
+					for_iter (r, 0, srcBpp)
+					{
+						if (alphaUsed[r])
+						{
+							a0 = _mm_or_si128(a0, _mm_shuffle_epi8(in[r], alphaSourceMasks[r]));
+						}
+					}
+					low = _mm_srli_epi16(_mm_mulhi_epu16(_mm_mullo_epi16(_mm_unpacklo_epi8(a0, zero), multiplier), reciprocal), 7);
+					high = _mm_srli_epi16(_mm_mulhi_epu16(_mm_mullo_epi16(_mm_unpackhi_epi8(a0, zero), multiplier), reciprocal), 7);
+					a0 = _mm_packus_epi16(low, high);
+				}
+				// fully transparent spans are skipped, fully opaque spans are simply copied
+				if (_mm_movemask_epi8(_mm_cmpeq_epi8(a0, zero)) != 0xFFFF)
+				{
+					opaque = (_mm_movemask_epi8(_mm_cmpeq_epi8(a0, ones)) == 0xFFFF);
+					for_iter (d, 0, destBpp)
+					{
+						color = fills[d];
+						for_iter (r, 0, srcBpp)
+						{
+							if (used[d][r])
+							{
+								color = _mm_or_si128(color, _mm_shuffle_epi8(in[r], sourceMasks[d][r]));
+							}
+						}
+						dest = _mm_loadu_si128((__m128i*)&destRow[d * 16]);
+						if (opaque)
+						{
+							dest = _mm_or_si128(_mm_and_si128(color, blends[d]), _mm_andnot_si128(blends[d], dest));
+						}
+						else
+						{
+							factor = _mm_shuffle_epi8(a0, alphaMasks[d]);
+							inverse = _mm_xor_si128(factor, ones);
+							low = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(color, zero), _mm_unpacklo_epi8(factor, zero)),
+								_mm_mullo_epi16(_mm_unpacklo_epi8(dest, zero), _mm_unpacklo_epi8(inverse, zero)));
+							high = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(color, zero), _mm_unpackhi_epi8(factor, zero)),
+								_mm_mullo_epi16(_mm_unpackhi_epi8(dest, zero), _mm_unpackhi_epi8(inverse, zero)));
+							low = _mm_srli_epi16(_mm_mulhi_epu16(low, reciprocal), 7);
+							high = _mm_srli_epi16(_mm_mulhi_epu16(high, reciprocal), 7);
+							dest = _mm_packus_epi16(low, high);
+						}
+						_mm_storeu_si128((__m128i*)&destRow[d * 16], dest);
+					}
+				}
+				srcRow += srcBpp * 16;
+				destRow += destBpp * 16;
+			}
+		}
+		return groups * SIMD_MIN_PIXELS;
+	}
+
+	/// @note Vertical filter pass over 16 values at a time, pairs of taps are multiplied and added with a single pmaddwd.
+	SIMD_TARGET("sse2") static int _resampleColumnsSse2(int count, short** rows, short* weights, int taps, int shift, unsigned char* dest)
+	{
+		int groups = count / 16;
+		__m128i zero = _mm_setzero_si128();
+		__m128i half = _mm_set1_epi32(1 << (shift - 1));
+		__m128i shiftCount = _mm_cvtsi32_si128(shift);
+		__m128i acc[4];
+		__m128i a0;
+		__m128i a1;
+		__m128i b0;
+		__m128i b1;
+		__m128i factors;
+		int offset = 0;
+		for_iter (i, 0, groups)
+		{
+			offset = i * 16;
+			acc[0] = acc[1] = acc[2] = acc[3] = half;
+			for_iter_step (t, 0, taps, 2)
+			{
+				a0 = _mm_loadu_si128((__m128i*)&rows[t][offset]);
+				a1 = _mm_loadu_si128((__m128i*)&rows[t][offset + 8]);
+				if (t + 1 < taps)
+				{
+					b0 = _mm_loadu_si128((__m128i*)&rows[t + 1][offset]);
+					b1 = _mm_loadu_si128((__m128i*)&rows[t + 1][offset + 8]);
+					factors = _mm_set1_epi32((int)(((unsigned int)(unsigned short)weights[t + 1] << 16) | (unsigned short)weights[t]));
+				}
+				else
+				{
+					b0 = b1 = zero;
+					factors = _mm_set1_epi32((int)(unsigned short)weights[t]);
+				}
+				acc[0] = _mm_add_epi32(acc[0], _mm_madd_epi16(_mm_unpacklo_epi16(a0, b0), factors));
+				acc[1] = _mm_add_epi32(acc[1], _mm_madd_epi16(_mm_unpackhi_epi16(a0, b0), factors));
+				acc[2] = _mm_add_epi32(acc[2], _mm_madd_epi16(_mm_unpacklo_epi16(a1, b1), factors));
+				acc[3] = _mm_add_epi32(acc[3], _mm_madd_epi16(_mm_unpackhi_epi16(a1, b1), factors));
+			}
+			for_iter (j, 0, 4)
+			{
+				acc[j] = _mm_sra_epi32(acc[j], shiftCount);
+			}
+			_mm_storeu_si128((__m128i*)&dest[offset], _mm_packus_epi16(_mm_packs_epi32(acc[0], acc[1]), _mm_packs_epi32(acc[2], acc[3])));
+		}
+		return groups * 16;
+	}
+
+	static void _swizzleScalar(int count, unsigned char* srcData, int srcBpp, unsigned char* destData, int destBpp, int* indices)
+	{
+		unsigned char pixel[4];
+		for_iter (i, 0, count)
+		{
+			memcpy(pixel, &srcData[i * srcBpp], srcBpp);
+			for_iter (c, 0, destBpp)
+			{
+				destData[i * destBpp + c] = (indices[c] < 0 ? 0xFF : pixel[indices[c]]);
+			}
+		}
+	}
+#endif
+
+	int getImageSimdLevel()
+	{
+#ifdef _SIMD_X86
+		return _getSimdLevel();
+#else
+		return 0;
+#endif
+	}
+
+	bool Image::_convertSimd(int count, unsigned char* srcData, Format srcFormat, unsigned char* destData, Format destFormat)
+	{
+#ifdef _SIMD_X86
+		if (count < SIMD_MIN_PIXELS)
+		{
+			return false;
+		}
+		int level = _getSimdLevel();
+		if (level == SIMD_NONE)
+		{
+			return false;
+		}
+		int srcBpp = Image::getFormatBpp(srcFormat);
+		int destBpp = Image::getFormatBpp(destFormat);
+		if ((srcBpp != 1 && srcBpp != 3 && srcBpp != 4) || (destBpp != 1 && destBpp != 3 && destBpp != 4))
+		{
+			return false;
+		}
+		if (level < SIMD_SSSE3 && (srcBpp != 4 || destBpp != 4))
+		{
+			return false;
+		}
+		// the byte mapping is derived by running the scalar conversion on a single probe pixel so both paths can never
+		// disagree, bytes that come out as 0xFF without being in the source are constant fills (e.g. opaque alpha)
+		unsigned char probe[4] = {1, 2, 3, 4};
+		unsigned char result[4] = {0, 0, 0, 0};
+		unsigned char* probeResult = result;
+		bool converted = false;
+		if (srcBpp == 1)
+		{
+			converted = Image::_convertFrom1Bpp(1, 1, probe, srcFormat, &probeResult, destFormat);
+		}
+		else if (srcBpp == 3)
+		{
+			converted = Image::_convertFrom3Bpp(1, 1, probe, srcFormat, &probeResult, destFormat);
+		}
+		else
+		{
+			converted = Image::_convertFrom4Bpp(1, 1, probe, srcFormat, &probeResult, destFormat);
+		}
+		if (!converted)
+		{
+			return false;
+		}
+		int indices[4] = {-1, -1, -1, -1};
+		bool identity = (srcBpp == destBpp);
+		for_iter (c, 0, destBpp)
+		{
+			if (result[c] >= 1 && result[c] <= srcBpp)
+			{
+				indices[c] = result[c] - 1;
+			}
+			else if (result[c] != 0xFF)
+			{
+				return false;
+			}
+			if (indices[c] != c)
+			{
+				identity = false;
+			}
+		}
+		if (identity) // memcpy() in the scalar path is as fast as it gets
+		{
+			return false;
+		}
+		int done = 0;
+		if (srcBpp == 4 && destBpp == 4)
+		{
+			if (level >= SIMD_AVX2)
+			{
+				done = _swizzle4BppAvx2(count, srcData, destData, indices);
+			}
+			else if (level >= SIMD_SSSE3)
+			{
+				done = _swizzleSsse3(count, srcData, srcBpp, destData, destBpp, indices);
+			}
+			else
+			{
+				done = _swizzle4BppSse2(count, srcData, destData, indices);
+			}
+		}
+		else
+		{
+			done = _swizzleSsse3(count, srcData, srcBpp, destData, destBpp, indices);
+		}
+		if (done < count)
+		{
+			_swizzleScalar(count - done, &srcData[done * srcBpp], srcBpp, &destData[done * destBpp], destBpp, indices);
+		}
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	int Image::_blendRowsSimd(int w, int h, unsigned char* srcData, int srcStride, int srcBpp, int srcAlpha, unsigned char* destData, int destStride, int destBpp, int* channels, unsigned char alpha)
+	{
+#ifdef _SIMD_X86
+		if (w < SIMD_MIN_PIXELS || _getSimdLevel() < SIMD_SSSE3)
+		{
+			return 0;
+		}
+		int indices[4] = {-1, -1, -1, -1};
+		bool blended[4] = {false, false, false, false};
+		for_iter (c, 0, destBpp)
+		{
+			indices[c] = (channels[c] >= 0 ? channels[c] : -1);
+			blended[c] = (channels[c] != BLEND_SKIP);
+		}
+		return _blendSsse3(w, h, srcData, srcStride, srcBpp, srcAlpha, destData, destStride, destBpp, indices, blended, alpha);
+#else
+		return 0;
+#endif
+	}
+
+	int Image::_resampleColumnsSimd(int count, short** rows, short* weights, int taps, int shift, unsigned char* dest)
+	{
+#ifdef _SIMD_X86
+		if (count < 16 || _getSimdLevel() < SIMD_SSE2)
+		{
+			return 0;
+		}
+		return _resampleColumnsSse2(count, rows, weights, taps, shift, dest);
+#else
+		return 0;
+#endif
+	}
+
+}
@@ -7,7 +7,19 @@
 /// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
 
 #ifdef _UNIX
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sched.h>
+#endif
+#ifdef _SDL_WINDOW
+#include <SDL/SDL.h>
+#endif
+
 #include <gtypes/Vector2.h>
+#include <hltypes/harray.h>
 #include <hltypes/hlog.h>
 #include <hltypes/hltypesUtil.h>
 #include <hltypes/hstring.h>
@@ -18,17 +30,173 @@
 namespace april
 {
 	extern SystemInfo info;
-	
+
+#ifdef __linux__
+	static int64_t _readCgroupValue(const char* filename)
+	{
+		int64_t value = -1;
+		FILE* file = fopen(filename, "r");
+		if (file != NULL)
+		{
+			long long result = 0;
+			if (fscanf(file, "%lld", &result) == 1)
+			{
+				value = (int64_t)result;
+			}
+			fclose(file);
+		}
+		return value;
+	}
+
+	// cgroup v2 is listed as "0::<path>" while cgroup v1 lists the controllers, e.g. "4:cpu,cpuacct:<path>"
+	static bool _findCgroupPath(hstr& path, bool& v2)
+	{
+		FILE* file = fopen("/proc/self/cgroup", "r");
+		if (file == NULL)
+		{
+			return false;
+		}
+		bool found = false;
+		char line[1024] = {0};
+		harray<hstr> parts;
+		while (fgets(line, sizeof(line), file) != NULL)
+		{
+			parts = hstr(line).trimmed().split(":", 2);
+			if (parts.size() < 3)
+			{
+				continue;
+			}
+			if (parts[1] == "")
+			{
+				if (!found)
+				{
+					path = parts[2];
+					v2 = true;
+					found = true;
+				}
+			}
+			else if (parts[1].split(",").has("cpu")) // on hybrid setups the cpu controller is still in cgroup v1
+			{
+				path = parts[2];
+				v2 = false;
+				found = true;
+				break;
+			}
+		}
+		fclose(file);
+		return found;
+	}
+
+	// returns the number of cores the quota of a cgroup allows or -1 if it has no quota
+	static int _getCgroupCpuLimit(chstr directory, bool v2)
+	{
+		int64_t quota = -1;
+		int64_t period = 0;
+		if (v2) // "max" means no limit
+		{
+			FILE* file = fopen((directory + "/cpu.max").cStr(), "r");
+			if (file != NULL)
+			{
+				char value[32] = {0};
+				long long result = 0;
+				if (fscanf(file, "%31s %lld", value, &result) == 2 && strcmp(value, "max") != 0)
+				{
+					quota = (int64_t)atoll(value);
+					period = (int64_t)result;
+				}
+				fclose(file);
+			}
+		}
+		else // -1 means no limit
+		{
+			quota = _readCgroupValue((directory + "/cpu.cfs_quota_us").cStr());
+			period = _readCgroupValue((directory + "/cpu.cfs_period_us").cStr());
+		}
+		if (quota <= 0 || period <= 0)
+		{
+			return -1;
+		}
+		return (int)((quota + period - 1) / period);
+	}
+#endif
+
+	static int _getCpuCores()
+	{
+		int cores = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#ifdef __linux__
+		// the process can be restricted to only some cores (e.g. with taskset)
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		if (sched_getaffinity(0, sizeof(set), &set) == 0)
+		{
+			int count = CPU_COUNT(&set);
+			if (count > 0)
+			{
+				cores = (cores > 0 ? hmin(cores, count) : count);
+			}
+		}
+		// containers can limit the available CPU time with a cgroup quota
+		hstr path;
+		bool v2 = false;
+		if (!_findCgroupPath(path, v2))
+		{
+			path = "/";
+			v2 = (access("/sys/fs/cgroup/cgroup.controllers", F_OK) == 0);
+		}
+		hstr root = (v2 ? "/sys/fs/cgroup" : "/sys/fs/cgroup/cpu");
+		int index = 0;
+		// quotas of parent groups apply as well and without a cgroup namespace only the parents may be visible
+		while (true)
+		{
+			int count = _getCgroupCpuLimit(root + path, v2);
+			if (count > 0)
+			{
+				cores = (cores > 0 ? hmin(cores, count) : count);
+			}
+			if (path == "/" || path == "")
+			{
+				break;
+			}
+			index = path.rindexOf("/");
+			path = (index > 0 ? path.subString(0, index) : hstr("/"));
+		}
+#endif
+		return hmax(cores, 1);
+	}
+
 	SystemInfo getSystemInfo()
 	{
 		if (info.locale == "")
 		{
-			info.cpuCores = 1; // TODO
-			info.displayResolution.set(1024.0f, 768.0f); // TODO
-			info.displayDpi = 96.0f; // TODO
-			//info.ram = 1024; // TODO
+			info.cpuCores = _getCpuCores();
+			int64_t pages = (int64_t)sysconf(_SC_PHYS_PAGES);
+			int64_t pageSize = (int64_t)sysconf(_SC_PAGESIZE);
+			if (pages > 0 && pageSize > 0)
+			{
+				info.ram = (int)(pages * pageSize / 1048576);
+			}
+			info.displayResolution.set(1024.0f, 768.0f);
+			info.displayDpi = 96.0f;
 			info.locale = "en"; // TODO
 		}
+#ifdef _SDL_WINDOW
+		// the display can only be queried once SDL's video subsystem was initialized
+		if (SDL_WasInit(SDL_INIT_VIDEO) != 0)
+		{
+			SDL_DisplayMode mode;
+			if (SDL_GetDesktopDisplayMode(0, &mode) == 0)
+			{
+				info.displayResolution.set((float)mode.w, (float)mode.h);
+			}
+#if SDL_VERSION_ATLEAST(2, 0, 4)
+			float dpi = 0.0f;
+			if (SDL_GetDisplayDPI(0, &dpi, NULL, NULL) == 0 && dpi > 0.0f)
+			{
+				info.displayDpi = dpi;
+			}
+#endif
+		}
+#endif
 		return info;
 	}
 
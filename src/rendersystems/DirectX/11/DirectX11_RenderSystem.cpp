@@ -990,6 +990,7 @@ namespace april
 
 	void DirectX11_RenderSystem::render(RenderOperation renderOperation, PlainVertex* v, int nVertices, Color color)
 	{
+		this->_prepareDrawCall();
 		ColoredTexturedVertex* ctv = (nVertices <= VERTICES_BUFFER_COUNT) ? static_ctv : new ColoredTexturedVertex[nVertices];
 		unsigned int c = this->getNativeColorUInt(color);
 		for_iter (i, 0, nVertices)
@@ -1020,6 +1021,7 @@ namespace april
 
 	void DirectX11_RenderSystem::render(RenderOperation renderOperation, TexturedVertex* v, int nVertices, Color color)
 	{
+		this->_prepareDrawCall();
 		ColoredTexturedVertex* ctv = (nVertices <= VERTICES_BUFFER_COUNT) ? static_ctv : new ColoredTexturedVertex[nVertices];
 		unsigned int c = this->getNativeColorUInt(color);
 		for_iter (i, 0, nVertices)
@@ -1047,6 +1049,7 @@ namespace april
 
 	void DirectX11_RenderSystem::render(RenderOperation renderOperation, ColoredVertex* v, int nVertices)
 	{
+		this->_prepareDrawCall();
 		ColoredTexturedVertex* ctv = (nVertices <= VERTICES_BUFFER_COUNT) ? static_ctv : new ColoredTexturedVertex[nVertices];
 		for_iter (i, 0, nVertices)
 		{
@@ -1070,6 +1073,7 @@ namespace april
 
 	void DirectX11_RenderSystem::render(RenderOperation renderOperation, ColoredTexturedVertex* v, int nVertices)
 	{
+		this->_prepareDrawCall();
 		this->_setRenderOperation(renderOperation);
 		this->_updateVertexBuffer(nVertices, v);
 		this->_updateVertexShader();
@@ -1130,6 +1134,7 @@ namespace april
 	
 	void DirectX11_RenderSystem::presentFrame()
 	{
+		this->_finishFrameDrawCalls();
 		this->swapChain->Present(1, 0);
 		// has to use GetAddressOf(), because the parameter is a pointer to an array of render target views
 		this->d3dDeviceContext->OMSetRenderTargets(1, this->renderTargetView.GetAddressOf(), NULL);
@@ -694,6 +694,7 @@ namespace april
 	
 	void DirectX9_RenderSystem::render(RenderOperation renderOperation, PlainVertex* v, int nVertices)
 	{
+		this->_prepareDrawCall();
 		if (this->activeTexture != NULL)
 		{
 			this->setTexture(NULL);
@@ -704,6 +705,7 @@ namespace april
 
 	void DirectX9_RenderSystem::render(RenderOperation renderOperation, PlainVertex* v, int nVertices, Color color)
 	{
+		this->_prepareDrawCall();
 		if (this->activeTexture != NULL)
 		{
 			this->setTexture(NULL);
@@ -727,12 +729,14 @@ namespace april
 	
 	void DirectX9_RenderSystem::render(RenderOperation renderOperation, TexturedVertex* v, int nVertices)
 	{
+		this->_prepareDrawCall();
 		this->d3dDevice->SetFVF(TEX_FVF);
 		this->d3dDevice->DrawPrimitiveUP(dx9_render_ops[renderOperation], this->_numPrimitives(renderOperation, nVertices), v, sizeof(TexturedVertex));
 	}
 
 	void DirectX9_RenderSystem::render(RenderOperation renderOperation, TexturedVertex* v, int nVertices, Color color)
 	{
+		this->_prepareDrawCall();
 		unsigned int c = this->getNativeColorUInt(color);
 		ColoredTexturedVertex* ctv = (nVertices <= VERTICES_BUFFER_COUNT) ? static_ctv : new ColoredTexturedVertex[nVertices];
 		for_iter (i, 0, nVertices)
@@ -754,6 +758,7 @@ namespace april
 
 	void DirectX9_RenderSystem::render(RenderOperation renderOperation, ColoredVertex* v, int nVertices)
 	{
+		this->_prepareDrawCall();
 		if (this->activeTexture != NULL)
 		{
 			this->setTexture(NULL);
@@ -764,6 +769,7 @@ namespace april
 
 	void DirectX9_RenderSystem::render(RenderOperation renderOperation, ColoredTexturedVertex* v, int nVertices)
 	{
+		this->_prepareDrawCall();
 		this->d3dDevice->SetFVF(TEX_COLOR_FVF);
 		this->d3dDevice->DrawPrimitiveUP(dx9_render_ops[renderOperation], this->_numPrimitives(renderOperation, nVertices), v, sizeof(ColoredTexturedVertex));
 	}
@@ -857,6 +863,7 @@ namespace april
 	
 	void DirectX9_RenderSystem::presentFrame()
 	{
+		this->_finishFrameDrawCalls();
 		this->d3dDevice->EndScene();
 		HRESULT hr = this->d3dDevice->Present(NULL, NULL, NULL, NULL);
 		if (hr == D3DERR_DEVICELOST)
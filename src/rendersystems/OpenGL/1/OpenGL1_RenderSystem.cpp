@@ -36,11 +36,80 @@
 #include "Timer.h"
 #include "Window.h"
 
+#ifdef _WIN32
+// opengl32.dll only exports OpenGL 1.1 so the buffer object functions forward to the driver's implementation
+static PFNGLGENBUFFERSPROC _glGenBuffers = NULL;
+static PFNGLDELETEBUFFERSPROC _glDeleteBuffers = NULL;
+static PFNGLBINDBUFFERPROC _glBindBuffer = NULL;
+static PFNGLBUFFERDATAPROC _glBufferData = NULL;
+static PFNGLBUFFERSUBDATAPROC _glBufferSubData = NULL;
+static PFNGLMAPBUFFERRANGEPROC _glMapBufferRange = NULL;
+static PFNGLUNMAPBUFFERPROC _glUnmapBuffer = NULL;
+
+void APIENTRY glGenBuffers(GLsizei n, GLuint* buffers)
+{
+	_glGenBuffers(n, buffers);
+}
+
+void APIENTRY glDeleteBuffers(GLsizei n, const GLuint* buffers)
+{
+	_glDeleteBuffers(n, buffers);
+}
+
+void APIENTRY glBindBuffer(GLenum target, GLuint buffer)
+{
+	_glBindBuffer(target, buffer);
+}
+
+void APIENTRY glBufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage)
+{
+	_glBufferData(target, size, data, usage);
+}
+
+void APIENTRY glBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data)
+{
+	_glBufferSubData(target, offset, size, data);
+}
+
+void* APIENTRY glMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access)
+{
+	return _glMapBufferRange(target, offset, length, access);
+}
+
+GLboolean APIENTRY glUnmapBuffer(GLenum target)
+{
+	return _glUnmapBuffer(target);
+}
+
+static PROC _getBufferFunction(const char* name)
+{
+	PROC function = wglGetProcAddress(name);
+	if (function == NULL) // drivers without OpenGL 1.5 only have the ARB variants
+	{
+		function = wglGetProcAddress((hstr(name) + "ARB").cStr());
+	}
+	return function;
+}
+
+static bool _loadBufferFunctions()
+{
+	_glGenBuffers = (PFNGLGENBUFFERSPROC)_getBufferFunction("glGenBuffers");
+	_glDeleteBuffers = (PFNGLDELETEBUFFERSPROC)_getBufferFunction("glDeleteBuffers");
+	_glBindBuffer = (PFNGLBINDBUFFERPROC)_getBufferFunction("glBindBuffer");
+	_glBufferData = (PFNGLBUFFERDATAPROC)_getBufferFunction("glBufferData");
+	_glBufferSubData = (PFNGLBUFFERSUBDATAPROC)_getBufferFunction("glBufferSubData");
+	_glMapBufferRange = (PFNGLMAPBUFFERRANGEPROC)wglGetProcAddress("glMapBufferRange");
+	_glUnmapBuffer = (PFNGLUNMAPBUFFERPROC)_getBufferFunction("glUnmapBuffer");
+	return (_glGenBuffers != NULL && _glDeleteBuffers != NULL && _glBindBuffer != NULL && _glBufferData != NULL && _glBufferSubData != NULL);
+}
+#endif
+
 namespace april
 {
 	OpenGL1_RenderSystem::OpenGL1_RenderSystem() : OpenGL_RenderSystem()
 	{
 		this->name = APRIL_RS_OPENGL1;
+		this->pixelBufferObjects = false;
 #ifdef _WIN32
 		this->hRC = 0;
 #endif
@@ -123,6 +192,20 @@ namespace april
 					}
 				}
 			}
+#ifdef _WIN32
+			// only the vertex buffer object functions are loaded from the driver, pixel buffer objects stay disabled
+			if (extensions.contains("ARB_vertex_buffer_object") && _loadBufferFunctions())
+			{
+				this->vertexBufferObjects = true;
+				this->mapBufferRange = (extensions.contains("ARB_map_buffer_range") && _glMapBufferRange != NULL && _glUnmapBuffer != NULL);
+			}
+#else
+			this->pixelBufferObjects = (extensions.contains("ARB_pixel_buffer_object") || extensions.contains("EXT_pixel_buffer_object"));
+			this->vertexBufferObjects = extensions.contains("ARB_vertex_buffer_object");
+#ifndef __APPLE__
+			this->mapBufferRange = extensions.contains("ARB_map_buffer_range");
+#endif
+#endif
 		}
 		OpenGL_RenderSystem::_setupCaps();
 	}
@@ -33,6 +33,8 @@ namespace april
 		void assignWindow(Window* window);
 		
 	protected:
+		bool pixelBufferObjects;
+
 		void _setupDefaultParameters();
 		void _setupCaps();
 
@@ -7,12 +7,29 @@
 /// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
 
 #ifdef _OPENGL1
+#include <string.h>
+#include <hltypes/hlog.h>
+#include <hltypes/hplatform.h>
+#ifndef __APPLE__
+#include <gl/GL.h>
+#define GL_GLEXT_PROTOTYPES
+#include <gl/glext.h>
+#else
+#include <OpenGL/gl.h>
+#endif
+
+#include "april.h"
+#include "Image.h"
+#include "OpenGL1_RenderSystem.h"
 #include "OpenGL1_Texture.h"
 
+#define APRIL_OGL1_RENDERSYS ((OpenGL1_RenderSystem*)april::rendersys)
+
 namespace april
 {
-	OpenGL1_Texture::OpenGL1_Texture(bool fromResource) : OpenGL_Texture(fromResource)
+	OpenGL1_Texture::OpenGL1_Texture(bool fromResource) : OpenGL_Texture(fromResource), pixelBufferIndex(0), mappedPixelBuffer(NULL)
 	{
+		memset(this->pixelBuffers, 0, APRIL_OPENGL1_PIXEL_BUFFERS * sizeof(unsigned int));
 	}
 
 	OpenGL1_Texture::~OpenGL1_Texture()
@@ -20,6 +37,82 @@ namespace april
 		this->unload();
 	}
 
+	bool OpenGL1_Texture::_destroyInternalTexture()
+	{
+#ifndef _WIN32
+		if (this->pixelBuffers[0] != 0)
+		{
+			glDeleteBuffers(APRIL_OPENGL1_PIXEL_BUFFERS, this->pixelBuffers);
+			memset(this->pixelBuffers, 0, APRIL_OPENGL1_PIXEL_BUFFERS * sizeof(unsigned int));
+			this->mappedPixelBuffer = NULL;
+		}
+#endif
+		return OpenGL_Texture::_destroyInternalTexture();
+	}
+
+	Texture::Lock OpenGL1_Texture::_tryLockSystem(int x, int y, int w, int h)
+	{
+#ifndef _WIN32
+		// volatile textures are streamed through a ring of pixel buffer objects so the CPU doesn't have to wait for the GPU
+		if (this->type == TYPE_VOLATILE && this->format != Image::FORMAT_PALETTE && APRIL_OGL1_RENDERSYS->pixelBufferObjects && this->mappedPixelBuffer == NULL)
+		{
+			if (this->pixelBuffers[0] == 0)
+			{
+				glGenBuffers(APRIL_OPENGL1_PIXEL_BUFFERS, this->pixelBuffers);
+			}
+			Image::Format nativeFormat = april::rendersys->getNativeTextureFormat(this->format);
+			this->pixelBufferIndex = (this->pixelBufferIndex + 1) % APRIL_OPENGL1_PIXEL_BUFFERS;
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, this->pixelBuffers[this->pixelBufferIndex]);
+			// orphaning the old storage allows the driver to keep using it for a pending upload
+			glBufferData(GL_PIXEL_UNPACK_BUFFER, w * h * Image::getFormatBpp(nativeFormat), NULL, GL_STREAM_DRAW);
+			this->mappedPixelBuffer = (unsigned char*)glMapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			if (this->mappedPixelBuffer != NULL)
+			{
+				Lock lock;
+				lock.activateLock(0, 0, w, h, x, y, this->mappedPixelBuffer, w, h, nativeFormat);
+				lock.systemBuffer = lock.data;
+				return lock;
+			}
+		}
+#endif
+		return OpenGL_Texture::_tryLockSystem(x, y, w, h);
+	}
+
+	bool OpenGL1_Texture::_unlockSystem(Lock& lock, bool update)
+	{
+		if (lock.systemBuffer == NULL || lock.data != this->mappedPixelBuffer)
+		{
+			return OpenGL_Texture::_unlockSystem(lock, update);
+		}
+#ifndef _WIN32
+		this->mappedPixelBuffer = NULL;
+		if (update && this->firstUpload) // the texture has to be allocated before any sub-rectangle can be uploaded
+		{
+			this->_uploadPotSafeClearData();
+		}
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, this->pixelBuffers[this->pixelBufferIndex]);
+		// unmapping fails if the data store got lost in the meantime (e.g. due to a display mode change)
+		if (glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) != GL_TRUE)
+		{
+			// there is no copy of the data in RAM so the write has to be reported as failed
+			hlog::warnf(logTag, "Pixel buffer of texture '%s' was lost, the data was not uploaded!", this->_getInternalName().cStr());
+			lock.failed = true;
+			update = false;
+		}
+		else if (update)
+		{
+			this->_setCurrentTexture();
+			// data is read from the beginning of the bound pixel buffer object
+			glTexSubImage2D(GL_TEXTURE_2D, 0, lock.dx, lock.dy, lock.w, lock.h, this->glFormat, GL_UNSIGNED_BYTE, NULL);
+			this->_resetCurrentTexture();
+			this->firstUpload = false;
+		}
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+#endif
+		return update;
+	}
+
 }
 
 #endif
@@ -16,6 +16,8 @@
 
 #include "OpenGL_Texture.h"
 
+#define APRIL_OPENGL1_PIXEL_BUFFERS 3
+
 namespace april
 {
 	class OpenGL1_Texture : public OpenGL_Texture
@@ -24,6 +26,16 @@ namespace april
 		OpenGL1_Texture(bool fromResource);
 		~OpenGL1_Texture();
 
+	protected:
+		unsigned int pixelBuffers[APRIL_OPENGL1_PIXEL_BUFFERS];
+		int pixelBufferIndex;
+		unsigned char* mappedPixelBuffer;
+
+		bool _destroyInternalTexture();
+
+		Lock _tryLockSystem(int x, int y, int w, int h);
+		bool _unlockSystem(Lock& lock, bool update);
+
 	};
 
 }
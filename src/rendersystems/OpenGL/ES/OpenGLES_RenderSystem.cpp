@@ -62,6 +62,10 @@ namespace april
 			this->caps.npotTexturesLimited = true;
 #endif
 			this->caps.npotTextures = (extensions.contains("OES_texture_npot") || extensions.contains("ARB_texture_non_power_of_two"));
+			// buffer objects are core since OpenGL ES 1.1, but OpenGL ES 1.0 doesn't have them
+			hstr version = (const char*)glGetString(GL_VERSION);
+			this->vertexBufferObjects = (!version.contains("ES-CM 1.0") && !version.contains("ES-CL 1.0"));
+			this->elementIndexUint = extensions.contains("OES_element_index_uint");
 		}
 #ifdef _ANDROID // Android has problems with alpha textures in some implementations
 		this->caps.textureFormats /= Image::FORMAT_ALPHA;
@@ -0,0 +1,149 @@
+/// @file
+/// @version 3.5
+/// 
+/// @section LICENSE
+/// 
+/// This program is free software; you can redistribute it and/or modify it under
+/// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
+
+#ifdef _OPENGL
+#include <hltypes/hplatform.h>
+#if __APPLE__
+	#include <TargetConditionals.h>
+#endif
+#if TARGET_OS_IPHONE
+	#ifdef _OPENGLES1
+		#include <OpenGLES/ES1/gl.h>
+		#include <OpenGLES/ES1/glext.h>
+	#elif defined(_OPENGLES2)
+		#include <OpenGLES/ES2/gl.h>
+		#include <OpenGLES/ES2/glext.h>
+	#endif
+#elif defined(_OPENGLES)
+	#include <GLES/gl.h>
+#else
+	#ifndef __APPLE__
+		#include <gl/GL.h>
+		#define GL_GLEXT_PROTOTYPES
+		#include <gl/glext.h>
+	#else
+		#include <OpenGL/gl.h>
+	#endif
+#endif
+
+#include <hltypes/hlog.h>
+
+#include "april.h"
+#include "OpenGL_IndexBuffer.h"
+#include "OpenGL_RenderSystem.h"
+
+#define APRIL_OGL_RENDERSYS ((OpenGL_RenderSystem*)april::rendersys)
+
+namespace april
+{
+	static bool _narrowIndices(const unsigned int* indices, int count, unsigned short* narrowed)
+	{
+		for_iter (i, 0, count)
+		{
+			if (indices[i] > 0xFFFF)
+			{
+				return false;
+			}
+			narrowed[i] = (unsigned short)indices[i];
+		}
+		return true;
+	}
+
+	OpenGL_IndexBuffer::OpenGL_IndexBuffer() : IndexBuffer(), bufferId(0), narrowed(false)
+	{
+	}
+
+	OpenGL_IndexBuffer::~OpenGL_IndexBuffer()
+	{
+		this->_destroyInternalBuffer();
+	}
+
+	bool OpenGL_IndexBuffer::_createInternalBuffer(const void* data, int size)
+	{
+		APRIL_OGL_RENDERSYS->getCaps(); // buffer object support is determined together with the caps
+		// 32 bit indices that can't be used by the hardware are kept in RAM and rendered by gathering the vertices
+		if (!APRIL_OGL_RENDERSYS->vertexBufferObjects)
+		{
+			return false;
+		}
+		this->narrowed = (this->format == FORMAT_32_BIT && !APRIL_OGL_RENDERSYS->elementIndexUint);
+		unsigned short* narrowedData = NULL;
+		if (this->narrowed)
+		{
+			int count = size / sizeof(unsigned int);
+			narrowedData = new unsigned short[count];
+			if (!_narrowIndices((const unsigned int*)data, count, narrowedData))
+			{
+				hlog::warn(logTag, "Hardware does not support 32 bit indices and the indices do not fit into 16 bits, the index buffer will be rendered from RAM.");
+				delete[] narrowedData;
+				this->narrowed = false;
+				return false;
+			}
+			data = narrowedData;
+			size = count * sizeof(unsigned short);
+		}
+		glGenBuffers(1, &this->bufferId);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->bufferId);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, size, data, (this->usage == BU_DYNAMIC ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW));
+		GLenum glError = glGetError();
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+		if (narrowedData != NULL)
+		{
+			delete[] narrowedData;
+		}
+		if (glError == GL_OUT_OF_MEMORY)
+		{
+			hlog::warn(logTag, "Not enough VRAM for index buffer, keeping it in RAM.");
+			this->_destroyInternalBuffer();
+			this->narrowed = false;
+			return false;
+		}
+		this->vramSize = size;
+		return true;
+	}
+
+	bool OpenGL_IndexBuffer::_updateInternalBuffer(const void* data, int offset, int size)
+	{
+		unsigned short* narrowedData = NULL;
+		if (this->narrowed)
+		{
+			int count = size / sizeof(unsigned int);
+			narrowedData = new unsigned short[count];
+			if (!_narrowIndices((const unsigned int*)data, count, narrowedData))
+			{
+				hlog::error(logTag, "Cannot update index buffer, the hardware does not support 32 bit indices above 65535!");
+				delete[] narrowedData;
+				return false;
+			}
+			data = narrowedData;
+			offset /= 2;
+			size = count * sizeof(unsigned short);
+		}
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->bufferId);
+		glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, offset, size, data);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+		if (narrowedData != NULL)
+		{
+			delete[] narrowedData;
+		}
+		return true;
+	}
+
+	void OpenGL_IndexBuffer::_destroyInternalBuffer()
+	{
+		if (this->bufferId != 0)
+		{
+			glDeleteBuffers(1, &this->bufferId);
+			this->bufferId = 0;
+			this->vramSize = 0;
+		}
+	}
+
+}
+
+#endif
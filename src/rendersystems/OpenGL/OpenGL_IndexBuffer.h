@@ -0,0 +1,45 @@
+/// @file
+/// @version 3.5
+/// 
+/// @section LICENSE
+/// 
+/// This program is free software; you can redistribute it and/or modify it under
+/// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
+/// 
+/// @section DESCRIPTION
+/// 
+/// Defines an OpenGL index buffer.
+
+#ifdef _OPENGL
+#ifndef APRIL_OPENGL_INDEX_BUFFER_H
+#define APRIL_OPENGL_INDEX_BUFFER_H
+
+#include "IndexBuffer.h"
+
+namespace april
+{
+	class OpenGL_RenderSystem;
+
+	class OpenGL_IndexBuffer : public IndexBuffer
+	{
+	public:
+		friend class OpenGL_RenderSystem;
+
+		OpenGL_IndexBuffer();
+		~OpenGL_IndexBuffer();
+
+	protected:
+		unsigned int bufferId;
+		/// @brief 32 bit indices are stored as 16 bit in VRAM when the hardware doesn't support 32 bit indices.
+		bool narrowed;
+
+		bool _createInternalBuffer(const void* data, int size);
+		bool _updateInternalBuffer(const void* data, int offset, int size);
+		void _destroyInternalBuffer();
+
+	};
+
+}
+
+#endif
+#endif
@@ -47,13 +47,16 @@
 
 #include <gtypes/Rectangle.h>
 #include <hltypes/hlog.h>
+#include <hltypes/hltypesUtil.h>
 #include <hltypes/hstring.h>
 
 #include "april.h"
 #include "Color.h"
 #include "Image.h"
+#include "OpenGL_IndexBuffer.h"
 #include "OpenGL_RenderSystem.h"
 #include "OpenGL_Texture.h"
+#include "OpenGL_VertexBuffer.h"
 #include "Platform.h"
 #include "RenderState.h"
 #ifdef _WIN32_WINDOW
@@ -88,7 +91,8 @@ namespace april
 		glLoadMatrixf(identityMatrix.data);
 	}
 	
-	OpenGL_RenderSystem::OpenGL_RenderSystem() : RenderSystem(), activeTexture(NULL)
+	OpenGL_RenderSystem::OpenGL_RenderSystem() : RenderSystem(), activeTexture(NULL), vertexBufferObjects(false), mapBufferRange(false), elementIndexUint(true),
+		streamBuffer(0), streamBufferSize(0), streamBufferOffset(0)
 	{
 		this->state = new RenderState(); // TODOa
 #if defined(_WIN32) && !defined(_WINRT)
@@ -120,6 +124,13 @@ namespace april
 		{
 			return false;
 		}
+		if (this->streamBuffer != 0)
+		{
+			glDeleteBuffers(1, &this->streamBuffer);
+			this->streamBuffer = 0;
+		}
+		this->streamBufferSize = 0;
+		this->streamBufferOffset = 0;
 		this->activeTexture = NULL;
 		this->deviceState.reset();
 		this->currentState.reset();
@@ -218,6 +229,10 @@ namespace april
 		this->_setClientState(GL_COLOR_ARRAY, this->deviceState.colorEnabled);
 		glColor4f(this->deviceState.systemColor.r_f(), this->deviceState.systemColor.g_f(), this->deviceState.systemColor.b_f(), this->deviceState.systemColor.a_f());
 		glBindTexture(GL_TEXTURE_2D, this->deviceState.textureId);
+		if (this->vertexBufferObjects)
+		{
+			glBindBuffer(GL_ARRAY_BUFFER, this->deviceState.arrayBuffer);
+		}
 		this->currentState.textureFilter = april::Texture::FILTER_NEAREST;
 		this->currentState.textureAddressMode = april::Texture::ADDRESS_WRAP;
 		this->currentState.blendMode = april::BM_UNDEFINED;
@@ -265,6 +280,11 @@ namespace april
 
 	void OpenGL_RenderSystem::setTexture(Texture* texture)
 	{
+		// batched quads have to be rendered before the texture changes or its pending changes are uploaded
+		if (texture != this->activeTexture || (texture != NULL && texture->isDirty()))
+		{
+			this->flush();
+		}
 		this->activeTexture = (OpenGL_Texture*)texture;
 		if (this->activeTexture == NULL)
 		{
@@ -293,6 +313,10 @@ namespace april
 
 	void OpenGL_RenderSystem::setTextureBlendMode(BlendMode mode)
 	{
+		if (this->currentState.blendMode != mode)
+		{
+			this->flush();
+		}
 		this->currentState.blendMode = mode;
 	}
 	
@@ -315,6 +339,10 @@ namespace april
 	
 	void OpenGL_RenderSystem::setTextureColorMode(ColorMode textureColorMode, float factor)
 	{
+		if (this->currentState.colorMode != textureColorMode || this->currentState.colorModeFactor != factor)
+		{
+			this->flush();
+		}
 		this->currentState.colorMode = textureColorMode;
 		this->currentState.colorModeFactor = factor;
 	}
@@ -360,6 +388,10 @@ namespace april
 
 	void OpenGL_RenderSystem::setTextureFilter(Texture::Filter textureFilter)
 	{
+		if (this->currentState.textureFilter != textureFilter)
+		{
+			this->flush();
+		}
 		this->currentState.textureFilter = textureFilter;
 	}
 
@@ -384,6 +416,10 @@ namespace april
 
 	void OpenGL_RenderSystem::setTextureAddressMode(Texture::AddressMode textureAddressMode)
 	{
+		if (this->currentState.textureAddressMode != textureAddressMode)
+		{
+			this->flush();
+		}
 		this->currentState.textureAddressMode = textureAddressMode;
 	}
 
@@ -428,6 +464,7 @@ namespace april
 
 	void OpenGL_RenderSystem::clear(bool useColor, bool depth)
 	{
+		this->flush();
 		GLbitfield mask = 0;
 		if (useColor)
 		{
@@ -483,20 +520,37 @@ namespace april
 				_loadIdentity();
 			}
 			this->deviceState.textureId = this->currentState.textureId;
-			// TODO - you should memorize address and filter modes per texture in opengl to avoid unnecesarry calls
 			this->deviceState.textureAddressMode = Texture::ADDRESS_UNDEFINED;
 			this->deviceState.textureFilter = Texture::FILTER_UNDEFINED;
+			// address and filter modes are stored in the texture object so they are only set when they differ
+			if (this->activeTexture != NULL && this->activeTexture->textureId == this->deviceState.textureId)
+			{
+				this->deviceState.textureAddressMode = this->activeTexture->glAddressMode;
+				this->deviceState.textureFilter = this->activeTexture->glFilter;
+			}
 		}
 		// texture has to be bound first or else filter and address mode won't be applied afterwards
-		if (this->currentState.textureFilter != this->deviceState.textureFilter || this->deviceState.textureFilter == Texture::FILTER_UNDEFINED)
-		{
-			this->_setTextureFilter(this->currentState.textureFilter);
-			this->deviceState.textureFilter = this->currentState.textureFilter;
-		}
-		if (this->currentState.textureAddressMode != this->deviceState.textureAddressMode || this->deviceState.textureAddressMode == Texture::ADDRESS_UNDEFINED)
+		if (this->deviceState.textureId != 0)
 		{
-			this->_setTextureAddressMode(this->currentState.textureAddressMode);
-			this->deviceState.textureAddressMode = this->currentState.textureAddressMode;
+			OpenGL_Texture* texture = (this->activeTexture != NULL && this->activeTexture->textureId == this->deviceState.textureId ? this->activeTexture : NULL);
+			if (this->currentState.textureFilter != this->deviceState.textureFilter || this->deviceState.textureFilter == Texture::FILTER_UNDEFINED)
+			{
+				this->_setTextureFilter(this->currentState.textureFilter);
+				this->deviceState.textureFilter = this->currentState.textureFilter;
+				if (texture != NULL)
+				{
+					texture->glFilter = this->currentState.textureFilter;
+				}
+			}
+			if (this->currentState.textureAddressMode != this->deviceState.textureAddressMode || this->deviceState.textureAddressMode == Texture::ADDRESS_UNDEFINED)
+			{
+				this->_setTextureAddressMode(this->currentState.textureAddressMode);
+				this->deviceState.textureAddressMode = this->currentState.textureAddressMode;
+				if (texture != NULL)
+				{
+					texture->glAddressMode = this->currentState.textureAddressMode;
+				}
+			}
 		}
 		if (this->currentState.blendMode != this->deviceState.blendMode)
 		{
@@ -536,8 +590,22 @@ namespace april
 		enabled ? glEnableClientState(type) : glDisableClientState(type);
 	}
 
+	void OpenGL_RenderSystem::_bindArrayBuffer(unsigned int bufferId)
+	{
+		if (this->deviceState.arrayBuffer != bufferId)
+		{
+			glBindBuffer(GL_ARRAY_BUFFER, bufferId);
+			this->deviceState.arrayBuffer = bufferId;
+			// pointers refer to the buffer that was bound when they were set so they have to be set again
+			this->deviceState.strideVertex = -1;
+			this->deviceState.strideTexCoord = -1;
+			this->deviceState.strideColor = -1;
+		}
+	}
+
 	void OpenGL_RenderSystem::render(RenderOperation renderOperation, PlainVertex* v, int nVertices)
 	{
+		this->_prepareDrawCall();
 		this->currentState.textureId = 0;
 		this->currentState.textureCoordinatesEnabled = false;
 		this->currentState.colorEnabled = false;
@@ -554,7 +622,7 @@ namespace april
 		{
 			size = this->_limitPrimitives(renderOperation, hmin(nVertices - i, MAX_VERTEX_COUNT));
 #endif
-			this->_setVertexPointer(sizeof(PlainVertex), v);
+			this->_setVertexPointer(sizeof(PlainVertex), this->_streamVertices(v, sizeof(PlainVertex), size));
 			glDrawArrays(gl_render_ops[renderOperation], 0, size);
 #ifdef _ANDROID
 			v += size;
@@ -564,6 +632,7 @@ namespace april
 
 	void OpenGL_RenderSystem::render(RenderOperation renderOperation, PlainVertex* v, int nVertices, Color color)
 	{
+		this->_prepareDrawCall();
 		this->currentState.textureId = 0;
 		this->currentState.textureCoordinatesEnabled = false;
 		this->currentState.colorEnabled = false;
@@ -580,7 +649,7 @@ namespace april
 		{
 			size = this->_limitPrimitives(renderOperation, hmin(nVertices - i, MAX_VERTEX_COUNT));
 #endif
-			this->_setVertexPointer(sizeof(PlainVertex), v);
+			this->_setVertexPointer(sizeof(PlainVertex), this->_streamVertices(v, sizeof(PlainVertex), size));
 			glDrawArrays(gl_render_ops[renderOperation], 0, size);
 #ifdef _ANDROID
 			v += size;
@@ -590,6 +659,7 @@ namespace april
 	
 	void OpenGL_RenderSystem::render(RenderOperation renderOperation, TexturedVertex* v, int nVertices)
 	{
+		this->_prepareDrawCall();
 		this->currentState.textureCoordinatesEnabled = true;
 		this->currentState.colorEnabled = false;
 		this->currentState.systemColor.set(255, 255, 255, 255);
@@ -598,14 +668,16 @@ namespace april
 		// This kind of approach to render chunks of vertices is caused by problems on OpenGLES
 		// hardware that may allow only a certain amount of vertices to be rendered at the time.
 		// Apparently that number is 65536 on HTC Evo 3D so this is used for MAX_VERTEX_COUNT by default.
+		unsigned char* data = NULL;
 		int size = nVertices;
 #ifdef _ANDROID
 		for_iter_step (i, 0, nVertices, size)
 		{
 			size = this->_limitPrimitives(renderOperation, hmin(nVertices - i, MAX_VERTEX_COUNT));
 #endif
-			this->_setVertexPointer(sizeof(TexturedVertex), v);
-			this->_setTexCoordPointer(sizeof(TexturedVertex), &v->u);
+			data = (unsigned char*)this->_streamVertices(v, sizeof(TexturedVertex), size);
+			this->_setVertexPointer(sizeof(TexturedVertex), data);
+			this->_setTexCoordPointer(sizeof(TexturedVertex), data + ((unsigned char*)&v->u - (unsigned char*)v));
 			glDrawArrays(gl_render_ops[renderOperation], 0, size);
 #ifdef _ANDROID
 			v += size;
@@ -615,6 +687,7 @@ namespace april
 
 	void OpenGL_RenderSystem::render(RenderOperation renderOperation, TexturedVertex* v, int nVertices, Color color)
 	{
+		this->_prepareDrawCall();
 		this->currentState.textureCoordinatesEnabled = true;
 		this->currentState.colorEnabled = false;
 		this->currentState.systemColor = color;
@@ -623,14 +696,16 @@ namespace april
 		// This kind of approach to render chunks of vertices is caused by problems on OpenGLES
 		// hardware that may allow only a certain amount of vertices to be rendered at the time.
 		// Apparently that number is 65536 on HTC Evo 3D so this is used for MAX_VERTEX_COUNT by default.
+		unsigned char* data = NULL;
 		int size = nVertices;
 #ifdef _ANDROID
 		for_iter_step (i, 0, nVertices, size)
 		{
 			size = this->_limitPrimitives(renderOperation, hmin(nVertices - i, MAX_VERTEX_COUNT));
 #endif
-			this->_setVertexPointer(sizeof(TexturedVertex), v);
-			this->_setTexCoordPointer(sizeof(TexturedVertex), &v->u);
+			data = (unsigned char*)this->_streamVertices(v, sizeof(TexturedVertex), size);
+			this->_setVertexPointer(sizeof(TexturedVertex), data);
+			this->_setTexCoordPointer(sizeof(TexturedVertex), data + ((unsigned char*)&v->u - (unsigned char*)v));
 			glDrawArrays(gl_render_ops[renderOperation], 0, size);
 #ifdef _ANDROID
 			v += size;
@@ -640,6 +715,7 @@ namespace april
 
 	void OpenGL_RenderSystem::render(RenderOperation renderOperation, ColoredVertex* v, int nVertices)
 	{
+		this->_prepareDrawCall();
 		this->currentState.textureId = 0;
 		this->currentState.textureCoordinatesEnabled = false;
 		this->currentState.colorEnabled = true;
@@ -649,14 +725,16 @@ namespace april
 		// This kind of approach to render chunks of vertices is caused by problems on OpenGLES
 		// hardware that may allow only a certain amount of vertices to be rendered at the time.
 		// Apparently that number is 65536 on HTC Evo 3D so this is used for MAX_VERTEX_COUNT by default.
+		unsigned char* data = NULL;
 		int size = nVertices;
 #ifdef _ANDROID
 		for_iter_step (i, 0, nVertices, size)
 		{
 			size = this->_limitPrimitives(renderOperation, hmin(nVertices - i, MAX_VERTEX_COUNT));
 #endif
-			this->_setVertexPointer(sizeof(ColoredVertex), v);
-			this->_setColorPointer(sizeof(ColoredVertex), &v->color);
+			data = (unsigned char*)this->_streamVertices(v, sizeof(ColoredVertex), size);
+			this->_setVertexPointer(sizeof(ColoredVertex), data);
+			this->_setColorPointer(sizeof(ColoredVertex), data + ((unsigned char*)&v->color - (unsigned char*)v));
 			glDrawArrays(gl_render_ops[renderOperation], 0, size);
 #ifdef _ANDROID
 			v += size;
@@ -666,6 +744,7 @@ namespace april
 	
 	void OpenGL_RenderSystem::render(RenderOperation renderOperation, ColoredTexturedVertex* v, int nVertices)
 	{
+		this->_prepareDrawCall();
 		this->currentState.textureCoordinatesEnabled = true;
 		this->currentState.colorEnabled = true;
 		this->currentState.systemColor.set(255, 255, 255, 255);
@@ -673,15 +752,17 @@ namespace april
 		// This kind of approach to render chunks of vertices is caused by problems on OpenGLES
 		// hardware that may allow only a certain amount of vertices to be rendered at the time.
 		// Apparently that number is 65536 on HTC Evo 3D so this is used for MAX_VERTEX_COUNT by default.
+		unsigned char* data = NULL;
 		int size = nVertices;
 #ifdef _ANDROID
 		for_iter_step (i, 0, nVertices, size)
 		{
 			size = this->_limitPrimitives(renderOperation, hmin(nVertices - i, MAX_VERTEX_COUNT));
 #endif
-			this->_setVertexPointer(sizeof(ColoredTexturedVertex), v);
-			this->_setColorPointer(sizeof(ColoredTexturedVertex), &v->color);
-			this->_setTexCoordPointer(sizeof(ColoredTexturedVertex), &v->u);
+			data = (unsigned char*)this->_streamVertices(v, sizeof(ColoredTexturedVertex), size);
+			this->_setVertexPointer(sizeof(ColoredTexturedVertex), data);
+			this->_setColorPointer(sizeof(ColoredTexturedVertex), data + ((unsigned char*)&v->color - (unsigned char*)v));
+			this->_setTexCoordPointer(sizeof(ColoredTexturedVertex), data + ((unsigned char*)&v->u - (unsigned char*)v));
 			glDrawArrays(gl_render_ops[renderOperation], 0, size);
 #ifdef _ANDROID
 			v += size;
@@ -689,6 +770,163 @@ namespace april
 #endif
 	}
 	
+	void OpenGL_RenderSystem::render(RenderOperation renderOperation, VertexBuffer* vertexBuffer, int start, int nVertices, Color color)
+	{
+		((OpenGL_VertexBuffer*)vertexBuffer)->_restore();
+		if (((OpenGL_VertexBuffer*)vertexBuffer)->bufferId != 0)
+		{
+			if (start < 0 || nVertices < 0 || start + nVertices > vertexBuffer->getCount())
+			{
+				hlog::errorf(logTag, "Cannot render vertex buffer, range %d+%d is outside of %d vertices!", start, nVertices, vertexBuffer->getCount());
+				return;
+			}
+			this->_prepareDrawCall();
+			this->_setVertexFormatState(vertexBuffer->getFormat(), color);
+			this->_bindArrayBuffer(((OpenGL_VertexBuffer*)vertexBuffer)->bufferId);
+			// pointers are offsets into the bound buffer
+			this->_setVertexFormatPointers(vertexBuffer->getFormat(), NULL);
+			glDrawArrays(gl_render_ops[renderOperation], start, nVertices);
+			return;
+		}
+		RenderSystem::render(renderOperation, vertexBuffer, start, nVertices, color);
+	}
+
+	void OpenGL_RenderSystem::render(RenderOperation renderOperation, VertexBuffer* vertexBuffer, IndexBuffer* indexBuffer, int start, int nIndices, Color color)
+	{
+		OpenGL_IndexBuffer* glIndexBuffer = (OpenGL_IndexBuffer*)indexBuffer;
+		((OpenGL_VertexBuffer*)vertexBuffer)->_restore();
+		glIndexBuffer->_restore();
+		// 32 bit indices kept in RAM can't be used by the hardware, the vertices are gathered from RAM instead
+		bool indices32Bit = (indexBuffer->getFormat() == IndexBuffer::FORMAT_32_BIT && !glIndexBuffer->narrowed);
+		if (((OpenGL_VertexBuffer*)vertexBuffer)->bufferId != 0 && (glIndexBuffer->bufferId != 0 || !indices32Bit || this->elementIndexUint))
+		{
+			if (start < 0 || nIndices < 0 || start + nIndices > indexBuffer->getCount())
+			{
+				hlog::errorf(logTag, "Cannot render index buffer, range %d+%d is outside of %d indices!", start, nIndices, indexBuffer->getCount());
+				return;
+			}
+			this->_prepareDrawCall();
+			this->_setVertexFormatState(vertexBuffer->getFormat(), color);
+			this->_bindArrayBuffer(((OpenGL_VertexBuffer*)vertexBuffer)->bufferId);
+			this->_setVertexFormatPointers(vertexBuffer->getFormat(), NULL);
+			int offset = start * (indices32Bit ? sizeof(unsigned int) : sizeof(unsigned short));
+			if (glIndexBuffer->bufferId != 0)
+			{
+				glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, glIndexBuffer->bufferId);
+				glDrawElements(gl_render_ops[renderOperation], nIndices, (indices32Bit ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT), (const void*)(size_t)offset);
+				glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+			}
+			else // indices that didn't fit into VRAM are used directly from RAM
+			{
+				glDrawElements(gl_render_ops[renderOperation], nIndices, (indices32Bit ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT), &glIndexBuffer->data[offset]);
+			}
+			return;
+		}
+		RenderSystem::render(renderOperation, vertexBuffer, indexBuffer, start, nIndices, color);
+	}
+
+	void OpenGL_RenderSystem::_renderIndexed(RenderOperation renderOperation, VertexBuffer::Format format, unsigned char* v, int nVertices, const void* indices, IndexBuffer::Format indexFormat, int nIndices, Color color)
+	{
+		if (indexFormat == IndexBuffer::FORMAT_32_BIT && !this->elementIndexUint)
+		{
+			RenderSystem::_renderIndexed(renderOperation, format, v, nVertices, indices, indexFormat, nIndices, color);
+			return;
+		}
+		this->_prepareDrawCall();
+		this->_setVertexFormatState(format, color);
+		// the vertices are uploaded once and shared by all primitives, indices stay in client memory
+		this->_setVertexFormatPointers(format, (const unsigned char*)this->_streamVertices(v, VertexBuffer::getFormatStride(format), nVertices));
+		glDrawElements(gl_render_ops[renderOperation], nIndices, (indexFormat == IndexBuffer::FORMAT_32_BIT ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT), indices);
+	}
+
+	void OpenGL_RenderSystem::_setVertexFormatState(VertexBuffer::Format format, Color color)
+	{
+		bool textured = (format == VertexBuffer::FORMAT_TEXTURED || format == VertexBuffer::FORMAT_COLORED_TEXTURED);
+		bool colored = (format == VertexBuffer::FORMAT_COLORED || format == VertexBuffer::FORMAT_COLORED_TEXTURED);
+		if (!textured)
+		{
+			this->currentState.textureId = 0;
+		}
+		this->currentState.textureCoordinatesEnabled = textured;
+		this->currentState.colorEnabled = colored;
+		if (colored)
+		{
+			this->currentState.systemColor.set(255, 255, 255, 255);
+		}
+		else
+		{
+			this->currentState.systemColor = color;
+		}
+		this->_applyStateChanges();
+	}
+
+	void OpenGL_RenderSystem::_setVertexFormatPointers(VertexBuffer::Format format, const unsigned char* data)
+	{
+		bool textured = (format == VertexBuffer::FORMAT_TEXTURED || format == VertexBuffer::FORMAT_COLORED_TEXTURED);
+		bool colored = (format == VertexBuffer::FORMAT_COLORED || format == VertexBuffer::FORMAT_COLORED_TEXTURED);
+		// vertex members directly follow the members of the vertex base class
+		int stride = VertexBuffer::getFormatStride(format);
+		this->_setVertexPointer(stride, data);
+		this->_setColorPointer((colored ? stride : 0), (colored ? data + sizeof(PlainVertex) : NULL));
+		if (textured)
+		{
+			this->_setTexCoordPointer(stride, data + (colored ? sizeof(ColoredVertex) : sizeof(PlainVertex)));
+		}
+		else
+		{
+			this->_setTexCoordPointer(0, NULL);
+		}
+	}
+
+	const void* OpenGL_RenderSystem::_streamVertices(const void* data, int stride, int count)
+	{
+		if (!this->vertexBufferObjects || count <= 0)
+		{
+			// client-side vertex arrays are used without buffer objects
+			this->_bindArrayBuffer(0);
+			return data;
+		}
+		int size = stride * count;
+		int offset = (this->streamBufferOffset + 15) & ~15; // keeps every vertex format properly aligned
+		if (this->streamBuffer == 0)
+		{
+			glGenBuffers(1, &this->streamBuffer);
+			this->streamBufferSize = 0;
+		}
+		this->_bindArrayBuffer(this->streamBuffer);
+		if (offset + size > this->streamBufferSize)
+		{
+			// orphaning the old storage allows the driver to keep using it for pending draw calls
+			this->streamBufferSize = hmax(this->streamBufferSize, hmax(size, APRIL_OPENGL_STREAM_BUFFER_SIZE));
+#ifdef GL_STREAM_DRAW
+			glBufferData(GL_ARRAY_BUFFER, this->streamBufferSize, NULL, GL_STREAM_DRAW);
+#else // OpenGL ES 1.1 has no stream usage
+			glBufferData(GL_ARRAY_BUFFER, this->streamBufferSize, NULL, GL_DYNAMIC_DRAW);
+#endif
+			offset = 0;
+		}
+		bool uploaded = false;
+#if !defined(_OPENGLES) && !defined(__APPLE__)
+		if (this->mapBufferRange)
+		{
+			// this range hasn't been used since the last orphaning so there's no need to wait for the GPU
+			void* mapped = glMapBufferRange(GL_ARRAY_BUFFER, offset, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+			if (mapped != NULL)
+			{
+				memcpy(mapped, data, size);
+				// unmapping fails if the data store got lost in the meantime
+				uploaded = (glUnmapBuffer(GL_ARRAY_BUFFER) == GL_TRUE);
+			}
+		}
+#endif
+		if (!uploaded)
+		{
+			glBufferSubData(GL_ARRAY_BUFFER, offset, size, data);
+		}
+		this->streamBufferOffset = offset + size;
+		return (const void*)(size_t)offset;
+	}
+
 	void OpenGL_RenderSystem::_setModelviewMatrix(const gmat4& matrix)
 	{
 		this->currentState.modelviewMatrix = matrix;
@@ -714,6 +952,16 @@ namespace april
 		this->_applyStateChanges();
 	}
 
+	VertexBuffer* OpenGL_RenderSystem::_createVertexBuffer()
+	{
+		return new OpenGL_VertexBuffer();
+	}
+
+	IndexBuffer* OpenGL_RenderSystem::_createIndexBuffer()
+	{
+		return new OpenGL_IndexBuffer();
+	}
+
 	Image::Format OpenGL_RenderSystem::getNativeTextureFormat(Image::Format format)
 	{
 		switch (format)
@@ -773,6 +1021,7 @@ namespace april
 
 	Image* OpenGL_RenderSystem::takeScreenshot(Image::Format format)
 	{
+		this->flush();
 #ifdef _DEBUG
 		hlog::write(logTag, "Taking screenshot...");
 #endif
@@ -20,15 +20,21 @@
 #include "OpenGL_State.h"
 #include "RenderSystem.h"
 
+#define APRIL_OPENGL_STREAM_BUFFER_SIZE 4194304
+
 namespace april
 {
+	class OpenGL_IndexBuffer;
 	class OpenGL_Texture;
+	class OpenGL_VertexBuffer;
 	class Window;
 
 	class OpenGL_RenderSystem : public RenderSystem
 	{
 	public:
+		friend class OpenGL_IndexBuffer;
 		friend class OpenGL_Texture;
+		friend class OpenGL_VertexBuffer;
 
 		OpenGL_RenderSystem();
 		~OpenGL_RenderSystem();
@@ -62,6 +68,8 @@ namespace april
 		void render(RenderOperation renderOperation, TexturedVertex* v, int nVertices, Color color);
 		void render(RenderOperation renderOperation, ColoredVertex* v, int nVertices);
 		void render(RenderOperation renderOperation, ColoredTexturedVertex* v, int nVertices);
+		void render(RenderOperation renderOperation, VertexBuffer* vertexBuffer, int start, int nVertices, Color color = Color::White);
+		void render(RenderOperation renderOperation, VertexBuffer* vertexBuffer, IndexBuffer* indexBuffer, int start, int nIndices, Color color = Color::White);
 		
 		Image::Format getNativeTextureFormat(Image::Format format);
 		unsigned int getNativeColorUInt(const april::Color& color);
@@ -71,16 +79,34 @@ namespace april
 		OpenGL_State deviceState;
 		OpenGL_State currentState;
 		OpenGL_Texture* activeTexture;
+		bool vertexBufferObjects;
+		bool mapBufferRange;
+		bool elementIndexUint;
+		unsigned int streamBuffer;
+		int streamBufferSize;
+		int streamBufferOffset;
+
+		inline bool _isBatchingSupported() { return true; }
 
 		virtual void _setupDefaultParameters();
 		virtual void _applyStateChanges();
 		void _setClientState(unsigned int type, bool enabled);
+		void _bindArrayBuffer(unsigned int bufferId);
+		/// @brief Sets up the render state for rendering vertices of the given format.
+		void _setVertexFormatState(VertexBuffer::Format format, Color color);
+		/// @brief Sets up the vertex pointers for vertices of the given format.
+		/// @param[in] data Pointer returned by _streamVertices() or an offset into the bound vertex buffer.
+		void _setVertexFormatPointers(VertexBuffer::Format format, const unsigned char* data);
 		void _setModelviewMatrix(const gmat4& matrix);
 		void _setProjectionMatrix(const gmat4& matrix);
 
 		void _setupCaps();
 		void _setResolution(int w, int h, bool fullscreen);
 
+		VertexBuffer* _createVertexBuffer();
+		IndexBuffer* _createIndexBuffer();
+		void _renderIndexed(RenderOperation renderOperation, VertexBuffer::Format format, unsigned char* v, int nVertices, const void* indices, IndexBuffer::Format indexFormat, int nIndices, Color color);
+
 		virtual void _setTextureBlendMode(BlendMode textureBlendMode);
 		/// @note The parameter factor is only used when the color mode is LERP.
 		virtual void _setTextureColorMode(ColorMode textureColorMode, float factor = 1.0f);
@@ -91,6 +117,9 @@ namespace april
 		virtual void _setVertexPointer(int stride, const void* pointer) = 0;
 		virtual void _setTexCoordPointer(int stride, const void* pointer);
 		virtual void _setColorPointer(int stride, const void* pointer);
+		/// @brief Appends the vertices to the streaming vertex buffer if vertex buffer objects are available.
+		/// @return Pointer for the vertex, color and texture coordinate pointer functions, either the data itself or an offset into the streaming vertex buffer.
+		const void* _streamVertices(const void* data, int stride, int count);
 
 #if defined(_WIN32) && !defined(_WINRT)
 	public:
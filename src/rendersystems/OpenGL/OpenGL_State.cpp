@@ -42,6 +42,7 @@ namespace april
 		this->depthBuffer = false;
 		this->depthBufferWrite = false;
 		this->modeMatrix = 0;
+		this->arrayBuffer = 0;
 		this->strideVertex = 0;
 		this->pointerVertex = NULL;
 		this->strideTexCoord = 0;
@@ -41,6 +41,7 @@ namespace april
 		bool depthBuffer;
 		bool depthBufferWrite;
 		unsigned int modeMatrix;
+		unsigned int arrayBuffer;
 		int strideVertex;
 		const void* pointerVertex;
 		int strideTexCoord;
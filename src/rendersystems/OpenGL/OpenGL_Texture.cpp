@@ -7,6 +7,7 @@
 /// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
 
 #ifdef _OPENGL
+#include <string.h>
 #include <hltypes/hplatform.h>
 
 #ifdef __APPLE__
@@ -61,7 +62,7 @@ namespace april
 {
 	static bool _preventRecursion = false;
 
-	OpenGL_Texture::OpenGL_Texture(bool fromResource) : Texture(fromResource), textureId(0), glFormat(0), internalFormat(0), previousTextureId(0)
+	OpenGL_Texture::OpenGL_Texture(bool fromResource) : Texture(fromResource), textureId(0), glFormat(0), internalFormat(0), previousTextureId(0), glFilter(FILTER_UNDEFINED), glAddressMode(ADDRESS_UNDEFINED), stagingBuffer(NULL), stagingBufferSize(0)
 	{
 	}
 
@@ -78,6 +79,9 @@ namespace april
 			return false;
 		}
 		this->firstUpload = true;
+		// a new texture object uses the default GL parameters
+		this->glFilter = FILTER_UNDEFINED;
+		this->glAddressMode = ADDRESS_UNDEFINED;
 		// required first call of glTexImage2D() to prevent problems
 #if TARGET_OS_IPHONE
 		if (this->dataFormat == GL_COMPRESSED_RGBA_PVRTC_4BPPV1_IMG || this->dataFormat == GL_COMPRESSED_RGBA_PVRTC_2BPPV1_IMG)
@@ -93,6 +97,12 @@ namespace april
 		return true;
 	}
 	
+	bool OpenGL_Texture::_isUploadSlicingSupported()
+	{
+		// compressed data can only be uploaded as a whole
+		return (this->dataFormat == 0 && this->format != Image::FORMAT_PALETTE);
+	}
+
 	void OpenGL_Texture::_assignFormat()
 	{
 		switch (this->format)
@@ -159,10 +169,18 @@ namespace april
 		}
 		APRIL_OGL_RENDERSYS->deviceState.textureId = this->textureId;
 		glBindTexture(GL_TEXTURE_2D, this->textureId);
-		APRIL_OGL_RENDERSYS->deviceState.textureFilter = this->filter;
-		APRIL_OGL_RENDERSYS->_setTextureFilter(this->filter);
-		APRIL_OGL_RENDERSYS->deviceState.textureAddressMode = this->addressMode;
-		APRIL_OGL_RENDERSYS->_setTextureAddressMode(this->addressMode);
+		if (this->glFilter != this->filter)
+		{
+			APRIL_OGL_RENDERSYS->_setTextureFilter(this->filter);
+			this->glFilter = this->filter;
+		}
+		APRIL_OGL_RENDERSYS->deviceState.textureFilter = this->glFilter;
+		if (this->glAddressMode != this->addressMode)
+		{
+			APRIL_OGL_RENDERSYS->_setTextureAddressMode(this->addressMode);
+			this->glAddressMode = this->addressMode;
+		}
+		APRIL_OGL_RENDERSYS->deviceState.textureAddressMode = this->glAddressMode;
 	}
 
 	void OpenGL_Texture::_resetCurrentTexture()
@@ -171,31 +189,78 @@ namespace april
 		{
 			APRIL_OGL_RENDERSYS->deviceState.textureId = this->previousTextureId;
 			glBindTexture(GL_TEXTURE_2D, this->previousTextureId);
+			// the parameters of the previous texture object weren't changed so they don't have to be set again
 			APRIL_OGL_RENDERSYS->deviceState.textureFilter = this->previousFilter;
-			APRIL_OGL_RENDERSYS->_setTextureFilter(this->previousFilter);
 			APRIL_OGL_RENDERSYS->deviceState.textureAddressMode = this->perviousAddressMode;
-			APRIL_OGL_RENDERSYS->_setTextureAddressMode(this->perviousAddressMode);
 			this->previousTextureId = 0;
 		}
 	}
 
 	bool OpenGL_Texture::_destroyInternalTexture()
 	{
+		// batched quads can only use the active texture and have to be rendered before it's gone
+		if (APRIL_OGL_RENDERSYS->activeTexture == this)
+		{
+			APRIL_OGL_RENDERSYS->flush();
+			// the render state can't keep referencing this texture or it would be bound again later
+			APRIL_OGL_RENDERSYS->activeTexture = NULL;
+			APRIL_OGL_RENDERSYS->currentState.textureId = 0;
+		}
 		if (this->textureId != 0)
 		{
+			// the deleted name must not be bound again, GL reverts to the default texture when a bound texture is deleted
+			if (APRIL_OGL_RENDERSYS->currentState.textureId == this->textureId)
+			{
+				APRIL_OGL_RENDERSYS->currentState.textureId = 0;
+			}
+			if (APRIL_OGL_RENDERSYS->deviceState.textureId == this->textureId)
+			{
+				APRIL_OGL_RENDERSYS->deviceState.textureId = 0;
+				APRIL_OGL_RENDERSYS->deviceState.textureFilter = FILTER_UNDEFINED;
+				APRIL_OGL_RENDERSYS->deviceState.textureAddressMode = ADDRESS_UNDEFINED;
+			}
 			glDeleteTextures(1, &this->textureId);
 			this->textureId = 0;
+			this->glFilter = FILTER_UNDEFINED;
+			this->glAddressMode = ADDRESS_UNDEFINED;
+			if (this->stagingBuffer != NULL)
+			{
+				delete[] this->stagingBuffer;
+				this->stagingBuffer = NULL;
+				this->stagingBufferSize = 0;
+			}
 			return true;
 		}
 		return false;
 	}
 
+	unsigned char* OpenGL_Texture::_getStagingBuffer(int size)
+	{
+		if (size > this->stagingBufferSize)
+		{
+			if (this->stagingBuffer != NULL)
+			{
+				delete[] this->stagingBuffer;
+			}
+			this->stagingBuffer = new unsigned char[size];
+			this->stagingBufferSize = size;
+		}
+		return this->stagingBuffer;
+	}
+
 	Texture::Lock OpenGL_Texture::_tryLockSystem(int x, int y, int w, int h)
 	{
 		Lock lock;
 		Image::Format nativeFormat = april::rendersys->getNativeTextureFormat(this->format);
 		int gpuBpp = Image::getFormatBpp(nativeFormat);
-		lock.activateLock(0, 0, w, h, x, y, new unsigned char[w * h * gpuBpp], w, h, nativeFormat);
+		if (this->type == TYPE_VOLATILE)
+		{
+			lock.activateLock(0, 0, w, h, x, y, this->_getStagingBuffer(w * h * gpuBpp), w, h, nativeFormat);
+		}
+		else
+		{
+			lock.activateLock(0, 0, w, h, x, y, new unsigned char[w * h * gpuBpp], w, h, nativeFormat);
+		}
 		lock.systemBuffer = lock.data;
 		return lock;
 	}
@@ -228,7 +293,10 @@ namespace april
 				}
 				this->_resetCurrentTexture();
 			}
-			delete[] lock.data;
+			if (lock.data != this->stagingBuffer)
+			{
+				delete[] lock.data;
+			}
 			this->firstUpload = false;
 		}
 		return update;
@@ -278,11 +346,11 @@ namespace april
 
 	bool OpenGL_Texture::_uploadToGpu(int sx, int sy, int sw, int sh, int dx, int dy, unsigned char* srcData, int srcWidth, int srcHeight, Image::Format srcFormat)
 	{
+		// not loading here, callers either checked that the texture is loaded or are uploading the slices of an async load
 		if (this->format == Image::FORMAT_PALETTE)
 		{
 			return false;
 		}
-		this->load();
 		if (sx == 0 && dx == 0 && sy == 0 && dy == 0 && sw == this->width && srcWidth == this->width && sh == this->height && srcHeight == this->height)
 		{
 			this->_uploadPotSafeData(srcData);
@@ -298,16 +366,27 @@ namespace april
 				this->_setCurrentTexture();
 			}
 			int srcBpp = Image::getFormatBpp(srcFormat);
-			if (sx == 0 && dx == 0 && srcWidth == this->width && sw == this->width)
+			if (sw == srcWidth || sh == 1)
 			{
 				glTexSubImage2D(GL_TEXTURE_2D, 0, dx, dy, sw, sh, this->glFormat, GL_UNSIGNED_BYTE, &srcData[(sx + sy * srcWidth) * srcBpp]);
 			}
 			else
 			{
+#ifdef GL_UNPACK_ROW_LENGTH
+				// the rows of the sub-rectangle are read directly from the source
+				glPixelStorei(GL_UNPACK_ROW_LENGTH, srcWidth);
+				glTexSubImage2D(GL_TEXTURE_2D, 0, dx, dy, sw, sh, this->glFormat, GL_UNSIGNED_BYTE, &srcData[(sx + sy * srcWidth) * srcBpp]);
+				glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+#else
+				// no row length support, so the sub-rectangle is packed tightly in the staging buffer first
+				int rowSize = sw * srcBpp;
+				unsigned char* packedData = this->_getStagingBuffer(rowSize * sh);
 				for_iter (j, 0, sh)
 				{
-					glTexSubImage2D(GL_TEXTURE_2D, 0, dx, (dy + j), sw, 1, this->glFormat, GL_UNSIGNED_BYTE, &srcData[(sx + (sy + j) * srcWidth) * srcBpp]);
+					memcpy(&packedData[j * rowSize], &srcData[(sx + (sy + j) * srcWidth) * srcBpp], rowSize);
 				}
+				glTexSubImage2D(GL_TEXTURE_2D, 0, dx, dy, sw, sh, this->glFormat, GL_UNSIGNED_BYTE, packedData);
+#endif
 			}
 		}
 		this->_resetCurrentTexture();
@@ -35,6 +35,10 @@ namespace april
 		unsigned int previousTextureId;
 		Filter previousFilter;
 		AddressMode perviousAddressMode;
+		Filter glFilter; // filter that is currently set on the GL texture object
+		AddressMode glAddressMode; // address mode that is currently set on the GL texture object
+		unsigned char* stagingBuffer; // reused by volatile textures and packed uploads so streaming doesn't allocate on every write
+		int stagingBufferSize;
 
 		void _setCurrentTexture();
 		void _resetCurrentTexture();
@@ -42,6 +46,8 @@ namespace april
 		bool _createInternalTexture(unsigned char* data, int size, Type type);
 		bool _destroyInternalTexture();
 		void _assignFormat();
+		bool _isUploadSlicingSupported();
+		unsigned char* _getStagingBuffer(int size);
 
 		Lock _tryLockSystem(int x, int y, int w, int h);
 		bool _unlockSystem(Lock& lock, bool update);
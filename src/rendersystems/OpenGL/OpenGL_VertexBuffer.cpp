@@ -0,0 +1,97 @@
+/// @file
+/// @version 3.5
+/// 
+/// @section LICENSE
+/// 
+/// This program is free software; you can redistribute it and/or modify it under
+/// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
+
+#ifdef _OPENGL
+#include <hltypes/hplatform.h>
+#if __APPLE__
+	#include <TargetConditionals.h>
+#endif
+#if TARGET_OS_IPHONE
+	#ifdef _OPENGLES1
+		#include <OpenGLES/ES1/gl.h>
+		#include <OpenGLES/ES1/glext.h>
+	#elif defined(_OPENGLES2)
+		#include <OpenGLES/ES2/gl.h>
+		#include <OpenGLES/ES2/glext.h>
+	#endif
+#elif defined(_OPENGLES)
+	#include <GLES/gl.h>
+#else
+	#ifndef __APPLE__
+		#include <gl/GL.h>
+		#define GL_GLEXT_PROTOTYPES
+		#include <gl/glext.h>
+	#else
+		#include <OpenGL/gl.h>
+	#endif
+#endif
+
+#include <hltypes/hlog.h>
+
+#include "april.h"
+#include "OpenGL_VertexBuffer.h"
+#include "OpenGL_RenderSystem.h"
+
+#define APRIL_OGL_RENDERSYS ((OpenGL_RenderSystem*)april::rendersys)
+
+namespace april
+{
+	OpenGL_VertexBuffer::OpenGL_VertexBuffer() : VertexBuffer(), bufferId(0)
+	{
+	}
+
+	OpenGL_VertexBuffer::~OpenGL_VertexBuffer()
+	{
+		this->_destroyInternalBuffer();
+	}
+
+	bool OpenGL_VertexBuffer::_createInternalBuffer(const void* data, int size)
+	{
+		APRIL_OGL_RENDERSYS->getCaps(); // buffer object support is determined together with the caps
+		if (!APRIL_OGL_RENDERSYS->vertexBufferObjects)
+		{
+			return false;
+		}
+		glGenBuffers(1, &this->bufferId);
+		APRIL_OGL_RENDERSYS->_bindArrayBuffer(this->bufferId);
+		glBufferData(GL_ARRAY_BUFFER, size, data, (this->usage == BU_DYNAMIC ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW));
+		GLenum glError = glGetError();
+		if (glError == GL_OUT_OF_MEMORY)
+		{
+			hlog::warn(logTag, "Not enough VRAM for vertex buffer, keeping it in RAM.");
+			this->_destroyInternalBuffer();
+			return false;
+		}
+		return true;
+	}
+
+	bool OpenGL_VertexBuffer::_updateInternalBuffer(const void* data, int offset, int size)
+	{
+		APRIL_OGL_RENDERSYS->_bindArrayBuffer(this->bufferId);
+		glBufferSubData(GL_ARRAY_BUFFER, offset, size, data);
+		return true;
+	}
+
+	void OpenGL_VertexBuffer::_destroyInternalBuffer()
+	{
+		if (this->bufferId != 0)
+		{
+			// deleting a bound buffer unbinds it so the tracked state has to be updated
+			if (APRIL_OGL_RENDERSYS->deviceState.arrayBuffer == this->bufferId)
+			{
+				APRIL_OGL_RENDERSYS->_bindArrayBuffer(0);
+			}
+			glDeleteBuffers(1, &this->bufferId);
+			this->bufferId = 0;
+			this->vramSize = 0;
+		}
+	}
+
+}
+
+#endif
@@ -0,0 +1,43 @@
+/// @file
+/// @version 3.5
+/// 
+/// @section LICENSE
+/// 
+/// This program is free software; you can redistribute it and/or modify it under
+/// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
+/// 
+/// @section DESCRIPTION
+/// 
+/// Defines an OpenGL vertex buffer.
+
+#ifdef _OPENGL
+#ifndef APRIL_OPENGL_VERTEX_BUFFER_H
+#define APRIL_OPENGL_VERTEX_BUFFER_H
+
+#include "VertexBuffer.h"
+
+namespace april
+{
+	class OpenGL_RenderSystem;
+
+	class OpenGL_VertexBuffer : public VertexBuffer
+	{
+	public:
+		friend class OpenGL_RenderSystem;
+
+		OpenGL_VertexBuffer();
+		~OpenGL_VertexBuffer();
+
+	protected:
+		unsigned int bufferId;
+
+		bool _createInternalBuffer(const void* data, int size);
+		bool _updateInternalBuffer(const void* data, int offset, int size);
+		void _destroyInternalBuffer();
+
+	};
+
+}
+
+#endif
+#endif
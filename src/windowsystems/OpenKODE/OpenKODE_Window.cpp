@@ -90,6 +90,7 @@ namespace april
 			if (april::rendersys != NULL)
 			{
 				april::rendersys->unloadTextures();
+				april::rendersys->unloadBuffers();
 			}
 			break;
 		}